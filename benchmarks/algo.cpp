@@ -0,0 +1,11 @@
+#include "abc/bench.hpp"
+#include "abc/string.hpp"
+#include "abc/utils.hpp"
+
+ABC_BENCHMARK(algo_split)
+{
+    const abc::string line = "2024-01-01,12:00:00,info,network,connected,eth0,1500,ok";
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::algo::split(line, ','));
+    }
+}
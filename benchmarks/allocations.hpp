@@ -0,0 +1,27 @@
+#pragma once
+
+#include "abc/bench.hpp"
+
+#include <cstdint>
+
+///@return the allocations of the calling thread so far, counted by the operator new of abc_bench (main.cpp)
+uint64_t get_allocation_count();
+
+///@brief: reports the allocations per iteration of the batch it lives in as the "allocs" counter
+class allocation_counter {
+public:
+    explicit allocation_counter(abc::bench::state& state)
+        : m_state(state)
+        , m_start(get_allocation_count())
+    {
+    }
+    ~allocation_counter()
+    {
+        const double allocations = static_cast<double>(get_allocation_count() - m_start);
+        m_state.set_counter("allocs", allocations / static_cast<double>(m_state.get_iterations()));
+    }
+
+private:
+    abc::bench::state& m_state;
+    uint64_t           m_start;
+};
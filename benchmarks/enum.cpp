@@ -0,0 +1,25 @@
+#include "abc/bench.hpp"
+#include "abc/enum.hpp"
+
+namespace {
+ABC_ENUM(color, red, green, blue, cyan, magenta, yellow, black, white)
+}   // namespace
+ABC_ENUM_STRING_IMPL(, color);
+
+ABC_BENCHMARK(enum_to_string)
+{
+    size_t index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::to_string(static_cast<color>(index)));
+        index = (index + 1) % static_cast<size_t>(color::COUNT);
+    }
+}
+
+ABC_BENCHMARK(enum_format)
+{
+    size_t index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(ABC_FORMAT("color: {}", static_cast<color>(index)));
+        index = (index + 1) % static_cast<size_t>(color::COUNT);
+    }
+}
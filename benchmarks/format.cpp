@@ -0,0 +1,245 @@
+#include "allocations.hpp"
+
+#include "abc/bench.hpp"
+#include "abc/charconv.hpp"
+#include "abc/format.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// abc::format/to_string/from_string against the snprintf and strto* they replace, the abc side returns an
+// abc::string so its allocations are part of the cost
+
+ABC_BENCHMARK(format_to_string_int)
+{
+    const allocation_counter allocations(state);
+    int                      value = 1234567;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::to_string(value));
+        ++value;
+    }
+}
+
+ABC_BENCHMARK(format_snprintf_int)
+{
+    const allocation_counter allocations(state);
+    int                      value = 1234567;
+    char                     buffer[16];
+    for (auto _ : state) {
+        std::snprintf(buffer, sizeof(buffer), "%d", value);
+        abc::bench::do_not_optimize(buffer);
+        ++value;
+    }
+}
+
+ABC_BENCHMARK(format_to_string_double)
+{
+    const allocation_counter allocations(state);
+    double                   value = 1234.5678;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::to_string(value));
+        value += 0.25;
+    }
+}
+
+ABC_BENCHMARK(format_snprintf_double)
+{
+    const allocation_counter allocations(state);
+    double                   value = 1234.5678;
+    char                     buffer[32];
+    for (auto _ : state) {
+        std::snprintf(buffer, sizeof(buffer), "%g", value);
+        abc::bench::do_not_optimize(buffer);
+        value += 0.25;
+    }
+}
+
+ABC_BENCHMARK(format_mixed)
+{
+    const allocation_counter allocations(state);
+    const abc::string        name  = "request";
+    int                      value = 42;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(ABC_FORMAT("{} #{} took {:.2f} ms", name, value, 1.5));
+        ++value;
+    }
+}
+
+ABC_BENCHMARK(format_mixed_prepared)
+{
+    const allocation_counter   allocations(state);
+    const abc::string          name = "request";
+    const abc::prepared_format format("{} #{} took {:.2f} ms");
+    int                        value = 42;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(format(name, value, 1.5));
+        ++value;
+    }
+}
+
+ABC_BENCHMARK(format_snprintf_mixed)
+{
+    const allocation_counter allocations(state);
+    const abc::string        name  = "request";
+    int                      value = 42;
+    char                     buffer[64];
+    for (auto _ : state) {
+        std::snprintf(buffer, sizeof(buffer), "%s #%d took %.2f ms", name.c_str(), value, 1.5);
+        abc::bench::do_not_optimize(buffer);
+        ++value;
+    }
+}
+
+ABC_BENCHMARK(format_from_string_int)
+{
+    const allocation_counter allocations(state);
+    const abc::string        text = "1234567";
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::from_string<int>(text, 0));
+    }
+}
+
+ABC_BENCHMARK(format_strtol_int)
+{
+    const allocation_counter allocations(state);
+    const abc::string        text = "1234567";
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(std::strtol(text.c_str(), nullptr, 10));
+    }
+}
+
+ABC_BENCHMARK(format_from_string_double)
+{
+    const allocation_counter allocations(state);
+    const abc::string        text = "1234.5678";
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::from_string<double>(text, 0.0));
+    }
+}
+
+ABC_BENCHMARK(format_strtod_double)
+{
+    const allocation_counter allocations(state);
+    const abc::string        text = "1234.5678";
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(std::strtod(text.c_str(), nullptr));
+    }
+}
+
+// abc::to_chars/from_chars on varied values, the cases above repeat nearly the same digits
+
+namespace {
+constexpr size_t k_valueCount = 4096;   // power of 2, indices wrap with a mask
+
+const std::vector<int64_t>&
+get_random_integers()
+{
+    static const std::vector<int64_t> values = []() {
+        std::mt19937_64      rng(42);
+        std::vector<int64_t> result(k_valueCount);
+        for (int64_t& value : result) {
+            value = static_cast<int64_t>(rng()) >> (rng() % 64);
+        }
+        return result;
+    }();
+    return values;
+}
+
+const std::vector<double>&
+get_random_doubles()
+{
+    static const std::vector<double> values = []() {
+        std::mt19937_64                        rng(42);
+        std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+        std::vector<double>                    result(k_valueCount);
+        for (double& value : result) {
+            value = distribution(rng);
+        }
+        return result;
+    }();
+    return values;
+}
+
+const std::vector<abc::string>&
+get_random_double_texts()
+{
+    static const std::vector<abc::string> values = []() {
+        std::vector<abc::string> result;
+        for (double value : get_random_doubles()) {
+            result.push_back(abc::to_string(value));
+        }
+        return result;
+    }();
+    return values;
+}
+}   // namespace
+
+ABC_BENCHMARK(format_to_chars_int64)
+{
+    const std::vector<int64_t>& values = get_random_integers();
+    char                        buffer[32];
+    size_t                      index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::to_chars(buffer, buffer + sizeof(buffer), values[index]).ptr);
+        index = (index + 1) & (k_valueCount - 1);
+    }
+}
+
+ABC_BENCHMARK(format_snprintf_int64)
+{
+    const std::vector<int64_t>& values = get_random_integers();
+    char                        buffer[32];
+    size_t                      index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(
+            std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(values[index])));
+        index = (index + 1) & (k_valueCount - 1);
+    }
+}
+
+ABC_BENCHMARK(format_to_chars_double)
+{
+    const std::vector<double>& values = get_random_doubles();
+    char                       buffer[32];
+    size_t                     index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(abc::to_chars(buffer, buffer + sizeof(buffer), values[index]).ptr);
+        index = (index + 1) & (k_valueCount - 1);
+    }
+}
+
+ABC_BENCHMARK(format_snprintf_double_round_trip)
+{
+    const std::vector<double>& values = get_random_doubles();
+    char                       buffer[32];
+    size_t                     index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(std::snprintf(buffer, sizeof(buffer), "%.17g", values[index]));
+        index = (index + 1) & (k_valueCount - 1);
+    }
+}
+
+ABC_BENCHMARK(format_from_chars_double)
+{
+    const std::vector<abc::string>& texts = get_random_double_texts();
+    size_t                          index = 0;
+    for (auto _ : state) {
+        const abc::string& text  = texts[index];
+        double             value = 0;
+        abc::from_chars(text.data(), text.data() + text.size(), value);
+        abc::bench::do_not_optimize(value);
+        index = (index + 1) & (k_valueCount - 1);
+    }
+}
+
+ABC_BENCHMARK(format_strtod_random_double)
+{
+    const std::vector<abc::string>& texts = get_random_double_texts();
+    size_t                          index = 0;
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(std::strtod(texts[index].c_str(), nullptr));
+        index = (index + 1) & (k_valueCount - 1);
+    }
+}
@@ -0,0 +1,68 @@
+#include "abc/bench.hpp"
+#include "abc/log.hpp"
+
+#include <cstdio>
+
+// caller side cost of a log call: a disabled channel, a text record and a deferred record handed to the async
+// writer, which writes to /dev/null meanwhile
+
+namespace {
+abc::log::channel g_benchChannel("bench");
+
+///@brief: runs the async backend for the lifetime of a benchmark
+class async_log {
+public:
+    async_log()
+        : m_file(std::fopen("/dev/null", "w"))
+    {
+        abc::log::async_config config;
+        config.fd                 = m_file != nullptr ? fileno(m_file) : 2;
+        config.flushOnCrash       = false;
+        config.deferredBufferSize = 1 << 20;
+        abc::log::start_async(config);
+    }
+    ~async_log()
+    {
+        abc::log::stop_async();
+        if (m_file != nullptr) {
+            std::fclose(m_file);
+        }
+    }
+    async_log(const async_log&)            = delete;
+    async_log& operator=(const async_log&) = delete;
+
+private:
+    FILE* m_file;
+};
+}   // namespace
+
+ABC_BENCHMARK(log_disabled_channel)
+{
+    abc::log::set_level("bench", abc::log::level::off);
+    int value = 0;
+    for (auto _ : state) {
+        ABC_LOG_CHANNEL_INFO(g_benchChannel, "iteration {} value {}", value, value * 0.5);
+        ++value;
+    }
+    abc::log::reset_levels();
+}
+
+ABC_BENCHMARK(log_async_text)
+{
+    const async_log log;
+    int             value = 0;
+    for (auto _ : state) {
+        ABC_LOG_INFO("iteration {} value {}", value, value * 0.5);
+        ++value;
+    }
+}
+
+ABC_BENCHMARK(log_deferred)
+{
+    const async_log log;
+    int             value = 0;
+    for (auto _ : state) {
+        ABC_LOG_DEFERRED_INFO("iteration {} value {}", value, value * 0.5);
+        ++value;
+    }
+}
@@ -0,0 +1,66 @@
+#include "allocations.hpp"
+
+#include "abc/bench.hpp"
+
+#include <cstdlib>
+#include <new>
+
+// counts the allocations of each thread so the benchmarks can report them, both the abc and the std
+// alternatives pay the same thread local increment
+namespace {
+thread_local uint64_t t_allocations = 0;
+
+void*
+allocate(std::size_t size)
+{
+    ++t_allocations;
+    void* pointer = std::malloc(size != 0 ? size : 1);
+    if (pointer == nullptr) {
+        std::abort();
+    }
+    return pointer;
+}
+}   // namespace
+
+uint64_t
+get_allocation_count()
+{
+    return t_allocations;
+}
+
+void*
+operator new(std::size_t size)
+{
+    return allocate(size);
+}
+void*
+operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+void
+operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+void
+operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+void
+operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+void
+operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+int
+main(int argc, char** argv)
+{
+    return abc::bench::run_main(argc, argv);
+}
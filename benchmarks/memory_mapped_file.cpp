@@ -0,0 +1,130 @@
+#include "abc/bench.hpp"
+#include "abc/memory_mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// read bandwidth of a 16 MB file in the page cache, mapped or read with fread. The sequential and random
+// benchmarks touch the mapping once before timing, mapped_file_open_touch measures the page faults instead.
+
+namespace {
+constexpr size_t k_fileSize = size_t(16) << 20;
+constexpr size_t k_reads    = 4096;   // random reads per iteration
+
+class sample_file {
+public:
+    sample_file()
+    {
+        std::vector<uint64_t> values(k_fileSize / sizeof(uint64_t));
+        for (size_t i = 0; i < values.size(); ++i) {
+            values[i] = i * 0x9E3779B97F4A7C15ull;
+        }
+        std::FILE* file = std::fopen(get_path(), "wb");
+        if (file != nullptr) {
+            std::fwrite(values.data(), sizeof(uint64_t), values.size(), file);
+            std::fclose(file);
+        }
+    }
+    ~sample_file() { std::remove(get_path()); }
+
+    static const char* get_path() { return "abc_bench_mapped_file.tmp"; }
+};
+
+const char*
+get_sample_file()
+{
+    static const sample_file s_file;
+    return sample_file::get_path();
+}
+
+uint64_t
+sum(const uint8_t* data, size_t size)
+{
+    uint64_t total = 0;
+    for (size_t offset = 0; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+        uint64_t value;
+        std::memcpy(&value, data + offset, sizeof(value));
+        total += value;
+    }
+    return total;
+}
+
+void
+set_bandwidth(abc::bench::state& state, size_t bytesPerIteration)
+{
+    const double ns = static_cast<double>(
+        std::chrono::duration_cast<abc::chrono::nanoseconds>(state.get_elapsed_time()).count());
+    if (ns > 0.0) {
+        state.set_counter("GB/s", static_cast<double>(bytesPerIteration * state.get_iterations()) / ns);
+    }
+}
+}   // namespace
+
+ABC_BENCHMARK(mapped_file_sequential)
+{
+    const abc::memory_mapped_file file(get_sample_file(), 0, abc::memory_mapped_file::access_type::read,
+        abc::memory_mapped_file::cache_hint::sequential);
+    abc::bench::do_not_optimize(sum(file.getData(), file.mapped_size()));
+    for (auto _ : state) {
+        abc::bench::do_not_optimize(sum(file.getData(), file.mapped_size()));
+    }
+    set_bandwidth(state, file.mapped_size());
+}
+
+ABC_BENCHMARK(mapped_file_random)
+{
+    const abc::memory_mapped_file file(get_sample_file(), 0, abc::memory_mapped_file::access_type::read,
+        abc::memory_mapped_file::cache_hint::random);
+    const uint8_t* data  = file.getData();
+    const size_t   words = file.mapped_size() / sizeof(uint64_t);
+    abc::bench::do_not_optimize(sum(data, file.mapped_size()));
+    uint64_t seed = 1;
+    for (auto _ : state) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < k_reads; ++i) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            uint64_t value;
+            std::memcpy(&value, data + (seed >> 33) % words * sizeof(uint64_t), sizeof(value));
+            total += value;
+        }
+        abc::bench::do_not_optimize(total);
+    }
+    state.set_counter("ns/read",
+        static_cast<double>(std::chrono::duration_cast<abc::chrono::nanoseconds>(state.get_elapsed_time()).count())
+            / static_cast<double>(state.get_iterations() * k_reads));
+}
+
+ABC_BENCHMARK(mapped_file_fread_sequential)
+{
+    std::FILE* file = std::fopen(get_sample_file(), "rb");
+    if (file == nullptr) {
+        return;
+    }
+    std::vector<uint8_t> buffer(size_t(1) << 20);
+    for (auto _ : state) {
+        std::fseek(file, 0, SEEK_SET);
+        uint64_t total = 0;
+        size_t   size  = 0;
+        while ((size = std::fread(buffer.data(), 1, buffer.size(), file)) != 0) {
+            total += sum(buffer.data(), size);
+        }
+        abc::bench::do_not_optimize(total);
+    }
+    std::fclose(file);
+    set_bandwidth(state, k_fileSize);
+}
+
+ABC_BENCHMARK(mapped_file_open_touch)
+{
+    const char* path = get_sample_file();
+    for (auto _ : state) {
+        const abc::memory_mapped_file file(path);
+        const size_t                  pageSize = file.get_page_size();
+        uint64_t                      total    = 0;
+        for (size_t offset = 0; offset < file.mapped_size(); offset += pageSize) {
+            total += file[offset];
+        }
+        abc::bench::do_not_optimize(total);
+    }
+}
@@ -0,0 +1,98 @@
+#include "allocations.hpp"
+
+#include "abc/bench.hpp"
+#include "abc/core.hpp"
+#include "abc/pointer.hpp"
+
+#include <memory>
+
+// abc::unique_ptr allocates a control block besides the object so its lent_ptr can check the owner is alive,
+// it is compared with std::unique_ptr and std::make_shared; copies of a lent_ptr with copies of a shared_ptr
+
+namespace {
+struct payload {
+    explicit payload(int value)
+        : value(value)
+    {
+    }
+    int value;
+    int padding[3];
+};
+}   // namespace
+
+ABC_BENCHMARK(pointer_abc_unique_create)
+{
+    const allocation_counter allocations(state);
+    for (auto _ : state) {
+        abc::unique_ptr<payload> pointer = abc::make_unique<payload>(1);
+        abc::bench::do_not_optimize(pointer.get_raw_ptr());
+    }
+}
+
+ABC_BENCHMARK(pointer_std_unique_create)
+{
+    const allocation_counter allocations(state);
+    for (auto _ : state) {
+        std::unique_ptr<payload> pointer(new payload(1));
+        abc::bench::do_not_optimize(pointer.get());
+    }
+}
+
+ABC_BENCHMARK(pointer_std_shared_create)
+{
+    const allocation_counter allocations(state);
+    for (auto _ : state) {
+        std::shared_ptr<payload> pointer = std::make_shared<payload>(1);
+        abc::bench::do_not_optimize(pointer.get());
+    }
+}
+
+ABC_BENCHMARK(pointer_abc_unique_move)
+{
+    abc::unique_ptr<payload> first = abc::make_unique<payload>(1);
+    abc::unique_ptr<payload> second;
+    for (auto _ : state) {
+        second = std::move(first);
+        first  = std::move(second);
+        abc::bench::do_not_optimize(first.get_raw_ptr());
+    }
+}
+
+ABC_BENCHMARK(pointer_std_unique_move)
+{
+    std::unique_ptr<payload> first(new payload(1));
+    std::unique_ptr<payload> second;
+    for (auto _ : state) {
+        second = std::move(first);
+        first  = std::move(second);
+        abc::bench::do_not_optimize(first.get());
+    }
+}
+
+ABC_BENCHMARK(pointer_abc_lend)
+{
+    const abc::unique_ptr<payload> owner = abc::make_unique<payload>(1);
+    for (auto _ : state) {
+        const abc::lent_ptr<payload> lent = abc::lend(owner);
+        abc::bench::do_not_optimize(lent->value);
+    }
+}
+
+ABC_BENCHMARK(pointer_abc_lent_copy)
+{
+    const abc::unique_ptr<payload> owner = abc::make_unique<payload>(1);
+    const abc::lent_ptr<payload>   lent  = owner;
+    for (auto _ : state) {
+        const abc::lent_ptr<payload> copy = lent;
+        abc::bench::do_not_optimize(copy->value);
+    }
+}
+
+ABC_BENCHMARK(pointer_std_shared_copy)
+{
+    const std::shared_ptr<payload> owner = std::make_shared<payload>(1);
+    for (auto _ : state) {
+        const std::shared_ptr<payload> copy = owner;
+        abc::bench::do_not_optimize(copy->value);
+    }
+}
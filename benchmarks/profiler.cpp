@@ -0,0 +1,75 @@
+#include "abc/bench.hpp"
+#include "abc/profiler.hpp"
+
+#include <thread>
+#include <vector>
+
+// cost of a profiled zone: a tick and a tock around nothing, per call site and for runtime tags. The multi
+// threaded benchmark runs k_calls zones on each of k_threads threads per iteration, thread start included.
+
+namespace {
+constexpr unsigned k_threads = 4;
+constexpr unsigned k_calls   = 10000;
+
+void
+profile_zones(unsigned calls)
+{
+    for (unsigned i = 0; i < calls; ++i) {
+        ABC_PROFILE_BEGIN(bench_profiler_thread);
+        ABC_PROFILE_END(bench_profiler_thread);
+    }
+}
+}   // namespace
+
+ABC_BENCHMARK(profiler_tick_tock)
+{
+    for (auto _ : state) {
+        ABC_PROFILE_BEGIN(bench_profiler_tick_tock);
+        ABC_PROFILE_END(bench_profiler_tick_tock);
+    }
+}
+
+ABC_BENCHMARK(profiler_scope)
+{
+    for (auto _ : state) {
+        ABC_PROFILE_SCOPE(bench_profiler_scope);
+        abc::bench::clobber_memory();
+    }
+}
+
+ABC_BENCHMARK(profiler_nested_scope)
+{
+    for (auto _ : state) {
+        ABC_PROFILE_SCOPE(bench_profiler_outer);
+        {
+            ABC_PROFILE_SCOPE(bench_profiler_inner);
+            abc::bench::clobber_memory();
+        }
+    }
+}
+
+ABC_BENCHMARK(profiler_tick_tock_string_tag)
+{
+    abc::detail::profiler& profiler = abc::detail::profiler::GetInstance();
+    const abc::string      tag      = "bench_profiler_string_tag";
+    for (auto _ : state) {
+        profiler.tick(tag);
+        profiler.tock(tag);
+    }
+}
+
+ABC_BENCHMARK(profiler_tick_tock_threads)
+{
+    for (auto _ : state) {
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < k_threads; ++i) {
+            threads.emplace_back(profile_zones, k_calls);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    state.set_counter("ns/zone",
+        static_cast<double>(std::chrono::duration_cast<abc::chrono::nanoseconds>(state.get_elapsed_time()).count())
+            / static_cast<double>(state.get_iterations() * k_threads * k_calls));
+}
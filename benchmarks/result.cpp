@@ -0,0 +1,138 @@
+#include "allocations.hpp"
+
+#include "abc/bench.hpp"
+#include "abc/core.hpp"
+#include "abc/optional.hpp"
+#include "abc/result.hpp"
+
+// cost of returning an abc::result or abc::optional through a few calls, against a plain return code. The
+// callees are not inlined so every level really builds and checks its return value.
+
+#if defined(_MSC_VER)
+#    define ABC_BENCH_NOINLINE __declspec(noinline)
+#else
+#    define ABC_BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+namespace {
+enum class parse_code { invalid, overflow };
+using parse_error  = abc::error<parse_code>;
+using parse_result = abc::result<int, parse_error>;
+
+ABC_BENCH_NOINLINE parse_result
+parse_leaf(int value)
+{
+    if (value < 0) {
+        return parse_error(parse_code::invalid, "negative value");
+    }
+    return parse_result(value);
+}
+
+ABC_BENCH_NOINLINE parse_result
+parse_middle(int value)
+{
+    parse_result result = parse_leaf(value);
+    if (result != abc::success) {
+        return parse_error(parse_code::overflow, "parse_leaf failed");
+    }
+    return parse_result(result.get_payload() + 1);
+}
+
+ABC_BENCH_NOINLINE parse_result
+parse_top(int value)
+{
+    parse_result result = parse_middle(value);
+    if (result != abc::success) {
+        return parse_error(parse_code::overflow, "parse_middle failed");
+    }
+    return parse_result(result.get_payload() + 1);
+}
+
+ABC_BENCH_NOINLINE bool
+parse_leaf_code(int value, int& out)
+{
+    out = value;
+    return value >= 0;
+}
+
+ABC_BENCH_NOINLINE bool
+parse_top_code(int value, int& out)
+{
+    int leaf = 0;
+    if (!parse_leaf_code(value, leaf)) {
+        return false;
+    }
+    out = leaf + 2;
+    return true;
+}
+
+ABC_BENCH_NOINLINE abc::optional<int>
+find_leaf(int value)
+{
+    if (value < 0) {
+        return abc::optional<int>();
+    }
+    return abc::optional<int>(value);
+}
+
+ABC_BENCH_NOINLINE abc::optional<int>
+find_top(int value)
+{
+    const abc::optional<int> leaf = find_leaf(value);
+    if (!leaf) {
+        return abc::optional<int>();
+    }
+    return abc::optional<int>(*leaf + 2);
+}
+}   // namespace
+
+ABC_BENCHMARK(result_success)
+{
+    const allocation_counter allocations(state);
+    int                      value = 0;
+    for (auto _ : state) {
+        parse_result result = parse_top(value);
+        abc::bench::do_not_optimize(result.get_payload());
+        value = (value + 1) & 0xffff;
+    }
+}
+
+ABC_BENCHMARK(result_error)
+{
+    const allocation_counter allocations(state);
+    for (auto _ : state) {
+        parse_result result = parse_top(-1);
+        abc::bench::do_not_optimize(result != abc::success);
+    }
+}
+
+ABC_BENCHMARK(result_return_code)
+{
+    int value = 0;
+    for (auto _ : state) {
+        int out = 0;
+        abc::bench::do_not_optimize(parse_top_code(value, out));
+        abc::bench::do_not_optimize(out);
+        value = (value + 1) & 0xffff;
+    }
+}
+
+ABC_BENCHMARK(optional_value)
+{
+    const allocation_counter allocations(state);
+    int                      value = 0;
+    for (auto _ : state) {
+        const abc::optional<int> found = find_top(value);
+        abc::bench::do_not_optimize(*found);
+        value = (value + 1) & 0xffff;
+    }
+}
+
+ABC_BENCHMARK(optional_none)
+{
+    const allocation_counter allocations(state);
+    for (auto _ : state) {
+        const abc::optional<int> found = find_top(-1);
+        abc::bench::do_not_optimize(static_cast<bool>(found));
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "abc/function.hpp"
+#include "abc/string.hpp"
+#include "abc/timer.hpp"
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace abc {
+namespace bench {
+///////////////////////////////////////////////////////////////////////////////
+
+///@brief: makes the compiler assume value is read, so the computation of value is not optimized away
+template <typename T>
+inline typename std::enable_if<std::is_trivially_copyable<T>::value && sizeof(T) <= sizeof(void*)>::type
+do_not_optimize(const T& value)
+{
+#if defined(_MSC_VER)
+    const volatile char* escape = reinterpret_cast<const volatile char*>(&value);
+    static_cast<void>(*escape);
+    _ReadWriteBarrier();
+#else
+    __asm__ __volatile__("" : : "r,m"(value) : "memory");
+#endif
+}
+template <typename T>
+inline typename std::enable_if<!std::is_trivially_copyable<T>::value || (sizeof(T) > sizeof(void*))>::type
+do_not_optimize(const T& value)
+{
+#if defined(_MSC_VER)
+    const volatile char* escape = reinterpret_cast<const volatile char*>(&value);
+    static_cast<void>(*escape);
+    _ReadWriteBarrier();
+#else
+    __asm__ __volatile__("" : : "m"(value) : "memory");
+#endif
+}
+
+///@brief: makes the compiler assume all memory is read and written, pending stores have to be done
+inline void
+clobber_memory()
+{
+#if defined(_MSC_VER)
+    _ReadWriteBarrier();
+#else
+    __asm__ __volatile__("" : : : "memory");
+#endif
+}
+
+///@brief: user value reported next to the timings, i.e. allocations per iteration or bytes per second
+struct counter {
+    abc::string name;
+    double      value = 0.0;
+};
+
+///@brief: handed to a benchmark body, which runs the measured code once per iteration of the range for:
+///            for (auto _ : state) { ... }
+///        Per iteration setup goes between pause_timing and resume_timing, each costs two clock reads.
+class state {
+public:
+    struct iterator {
+        struct value {
+            ~value() {}   // not trivial, `for (auto _ : state)` does not warn about an unused variable
+        };
+
+        state*   m_state;
+        uint64_t m_remaining;
+
+        bool operator!=(const iterator&)
+        {
+            if (m_remaining != 0) {
+                return true;
+            }
+            m_state->finish();
+            return false;
+        }
+        iterator& operator++()
+        {
+            --m_remaining;
+            return *this;
+        }
+        value operator*() const { return value(); }
+    };
+
+    explicit state(uint64_t iterations)
+        : m_iterations(iterations)
+    {
+    }
+
+    iterator begin()
+    {
+        m_start = chrono::timer::now();
+        return iterator{this, m_iterations};
+    }
+    iterator end() { return iterator{this, 0}; }
+
+    void pause_timing() { m_elapsed += chrono::timer::now() - m_start; }
+    void resume_timing() { m_start = chrono::timer::now(); }
+
+    uint64_t         get_iterations() const { return m_iterations; }
+    chrono::duration get_elapsed_time() const { return m_elapsed; }
+
+    ///@brief: sets a counter of this batch, the last measured batch is reported
+    void set_counter(const abc::string& name, double value)
+    {
+        for (counter& entry : m_counters) {
+            if (entry.name == name) {
+                entry.value = value;
+                return;
+            }
+        }
+        m_counters.push_back(counter{name, value});
+    }
+    const std::vector<counter>& get_counters() const { return m_counters; }
+
+private:
+    void finish() { m_elapsed += chrono::timer::now() - m_start; }
+
+    uint64_t             m_iterations;
+    chrono::time_point   m_start;
+    chrono::duration     m_elapsed = chrono::duration(0);
+    std::vector<counter> m_counters;
+};
+
+struct benchmark {
+    abc::string                 name;
+    abc::function<void(state&)> body;
+};
+
+///@return true, so registration can initialize a static
+bool                          register_benchmark(const abc::string& name, abc::function<void(state&)> body);
+const std::vector<benchmark>& get_benchmarks();
+
+struct options {
+    abc::string          filter;                                       // substring of the names to run
+    unsigned             repetitions = 10;                             // measured batches
+    chrono::milliseconds minBatchTime{10};                             // iterations grow until a batch lasts that long
+    chrono::milliseconds warmupTime{50};
+};
+
+///@brief: nanoseconds per iteration over the repeated batches
+struct result {
+    abc::string name;
+    uint64_t    iterations  = 0;   // per batch
+    unsigned    repetitions = 0;
+    double      medianNs    = 0.0;
+    double      madNs       = 0.0;   // median absolute deviation, robust to the outliers of a noisy machine
+    double      minNs       = 0.0;
+    double      maxNs       = 0.0;
+
+    std::vector<counter> counters;
+};
+
+///@brief: fills median, mad, min and max from the per iteration times of every batch
+void   compute_statistics(std::vector<double> nanoseconds, result& out);
+result run(const benchmark& benchmark, const options& options);
+
+enum class output_format { console, json, csv };
+abc::string format_results(const std::vector<result>& results, output_format format);
+///@brief: reads results written as json or csv by format_results, counters are not read back
+///@return false when the file cannot be read
+bool read_results(const abc::string& path, std::vector<result>& out);
+
+struct comparison {
+    abc::string name;
+    double      baselineNs = 0.0;
+    double      currentNs  = 0.0;
+    double      change     = 0.0;     // relative, 0.1 is 10% slower
+    bool        regression = false;   // slower by more than the threshold and by more than the noise
+};
+std::vector<comparison> compare(const std::vector<result>& baseline, const std::vector<result>& current,
+    double threshold = 0.05);
+
+///@brief: command line of abc_bench, see --help
+int run_main(int argc, char** argv);
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace bench
+}   // namespace abc
+
+#define ABC_BENCHMARK_CONCAT_IMPL2(A, B) A##B
+#define ABC_BENCHMARK_CONCAT_IMPL(A, B)  ABC_BENCHMARK_CONCAT_IMPL2(A, B)
+///@brief: defines and registers a benchmark, the body follows with `state` in scope:
+///            ABC_BENCHMARK(format_int) { for (auto _ : state) { ... } }
+#define ABC_BENCHMARK(NAME)                                                                                \
+    static void       ABC_BENCHMARK_CONCAT_IMPL(abc_benchmark_, NAME)(abc::bench::state&);                 \
+    static const bool ABC_BENCHMARK_CONCAT_IMPL(abc_benchmarkRegistered_, NAME) =                          \
+        abc::bench::register_benchmark(#NAME, &ABC_BENCHMARK_CONCAT_IMPL(abc_benchmark_, NAME));           \
+    static void       ABC_BENCHMARK_CONCAT_IMPL(abc_benchmark_, NAME)(abc::bench::state & state)
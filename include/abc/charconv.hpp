@@ -0,0 +1,275 @@
+#pragma once
+
+#include "abc/core.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>   //memcpy
+#include <limits>
+#include <system_error>   //errc
+#include <type_traits>
+
+namespace abc {
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: locale-independent, allocation-free numeric conversions mimicking <charconv>
+///        to_chars(float/double) prints a representation that round-trips (Grisu2), shortest in nearly all
+///        cases but a digit longer for a few values, or the printf %e/%f/%g layout at a given precision,
+///        rounded half to even from the exact binary value, from_chars parses 8 digits at a time (SWAR) and
+///        rounds with Clinger/Eisel-Lemire, strtod only for the rare inputs neither can decide.
+struct to_chars_result {
+    char*     ptr;
+    std::errc ec;
+};
+struct from_chars_result {
+    const char* ptr;
+    std::errc   ec;
+};
+
+enum class chars_format {
+    scientific = 1,   // %e
+    fixed      = 2,   // %f
+    general    = 3,   // %g
+};
+
+to_chars_result to_chars(char* first, char* last, double value);
+to_chars_result to_chars(char* first, char* last, float value);
+inline to_chars_result
+to_chars(char* first, char* last, long double value)
+{
+    return to_chars(first, last, static_cast<double>(value));
+}
+///@brief: a negative precision is 6, as with printf
+to_chars_result to_chars(char* first, char* last, double value, chars_format format, int precision);
+to_chars_result to_chars(char* first, char* last, float value, chars_format format, int precision);
+inline to_chars_result
+to_chars(char* first, char* last, long double value, chars_format format, int precision)
+{
+    return to_chars(first, last, static_cast<double>(value), format, precision);
+}
+
+from_chars_result from_chars(const char* first, const char* last, double& value);
+from_chars_result from_chars(const char* first, const char* last, float& value);
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+namespace charconv {
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T, typename TResult>
+using enable_if_integer_t =
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, TResult>::type;
+
+///@brief: buffer size that fits any value of T
+template <typename T, bool IS_FLOATING_POINT = std::is_floating_point<T>::value> struct max_chars {
+    static constexpr size_t value = std::numeric_limits<T>::digits10 + 3;
+};
+template <typename T> struct max_chars<T, true> {
+    static constexpr size_t value = 32;
+};
+
+// "00010203...99"
+extern const char k_digitPairs[201];
+
+///@brief: to_chars with a precision, alternate is printf's '#': the point is always written and %g keeps
+///        its trailing zeros
+to_chars_result to_chars_precision(char* first, char* last, double value, chars_format format, int precision,
+    bool alternate);
+
+inline unsigned
+count_digits(uint64_t value)
+{
+    unsigned count = 1;
+    for (;;) {
+        if (value < 10) {
+            return count;
+        }
+        if (value < 100) {
+            return count + 1;
+        }
+        if (value < 1000) {
+            return count + 2;
+        }
+        if (value < 10000) {
+            return count + 3;
+        }
+        value /= 10000u;
+        count += 4;
+    }
+}
+
+///@brief: writes the digits of value backwards, two at a time, ending right before end
+inline void
+write_digits(char* end, uint64_t value)
+{
+    while (value >= 100) {
+        const size_t index = static_cast<size_t>(value % 100) * 2;
+        value /= 100;
+        *--end = k_digitPairs[index + 1];
+        *--end = k_digitPairs[index];
+    }
+    if (value < 10) {
+        *--end = static_cast<char>('0' + value);
+    } else {
+        const size_t index = static_cast<size_t>(value) * 2;
+        *--end             = k_digitPairs[index + 1];
+        *--end             = k_digitPairs[index];
+    }
+}
+
+template <typename T>
+constexpr bool
+is_negative(T value, std::true_type /*signed*/)
+{
+    return value < 0;
+}
+template <typename T>
+constexpr bool
+is_negative(T /*value*/, std::false_type /*signed*/)
+{
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// SWAR digit parsing, 8 ascii digits loaded as a little-endian 64bit word
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define ABC_CHARCONV_SWAR 0
+#else
+#define ABC_CHARCONV_SWAR 1
+#endif
+
+inline uint64_t
+read_8_chars(const char* str)
+{
+    uint64_t value;
+    std::memcpy(&value, str, sizeof(value));
+    return value;
+}
+
+inline bool
+is_8_digits(uint64_t value)
+{
+    return (((value & 0xF0F0F0F0F0F0F0F0ull) | (((value + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))
+        == 0x3333333333333333ull);
+}
+
+inline uint32_t
+parse_8_digits(uint64_t value)
+{
+    const uint64_t mask = 0x000000FF000000FFull;
+    const uint64_t mul1 = 0x000F424000000064ull;   // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ull;   // 1 + (10000 << 32)
+    value -= 0x3030303030303030ull;
+    value = (value * 10) + (value >> 8);
+    value = (((value & mask) * mul1) + (((value >> 16) & mask) * mul2)) >> 32;
+    return static_cast<uint32_t>(value);
+}
+
+inline bool
+is_digit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+///@brief: parses up to 19 digits (never overflows), returns the number of digits consumed
+inline unsigned
+parse_digits(const char*& it, const char* last, uint64_t& value, unsigned maxDigits)
+{
+    unsigned count = 0;
+#if ABC_CHARCONV_SWAR
+    while (count + 8 <= maxDigits && last - it >= 8 && is_8_digits(read_8_chars(it))) {
+        value = value * 100000000u + parse_8_digits(read_8_chars(it));
+        it += 8;
+        count += 8;
+    }
+#endif
+    while (count < maxDigits && it != last && is_digit(*it)) {
+        value = value * 10 + static_cast<unsigned>(*it - '0');
+        ++it;
+        ++count;
+    }
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace charconv
+}   // namespace detail
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+detail::charconv::enable_if_integer_t<T, to_chars_result>
+to_chars(char* first, char* last, T value)
+{
+    using unsigned_t = typename std::make_unsigned<T>::type;
+
+    unsigned_t unsignedValue = static_cast<unsigned_t>(value);
+    if (detail::charconv::is_negative(value, std::is_signed<T>())) {
+        if (first == last) {
+            return to_chars_result{last, std::errc::value_too_large};
+        }
+        *first++ = '-';
+        // negate in the unsigned domain, so the minimum value does not overflow
+        unsignedValue = static_cast<unsigned_t>(unsigned_t(0) - unsignedValue);
+    }
+
+    const unsigned digits = detail::charconv::count_digits(unsignedValue);
+    if (last - first < static_cast<ptrdiff_t>(digits)) {
+        return to_chars_result{last, std::errc::value_too_large};
+    }
+    detail::charconv::write_digits(first + digits, unsignedValue);
+    return to_chars_result{first + digits, std::errc()};
+}
+
+template <typename T>
+detail::charconv::enable_if_integer_t<T, from_chars_result>
+from_chars(const char* first, const char* last, T& value)
+{
+    using unsigned_t = typename std::make_unsigned<T>::type;
+
+    const char* it       = first;
+    const bool  negative = std::is_signed<T>::value && it != last && *it == '-';
+    if (negative) {
+        ++it;
+    }
+
+    const char* digitsBegin = it;
+    while (it != last && *it == '0') {
+        ++it;
+    }
+    const bool hasLeadingZeros = it != digitsBegin;
+
+    uint64_t       parsed = 0;
+    const unsigned digits = detail::charconv::parse_digits(it, last, parsed, 19);
+    if (digits == 0 && !hasLeadingZeros) {
+        return from_chars_result{first, std::errc::invalid_argument};
+    }
+
+    bool overflow = false;
+    if (it != last && detail::charconv::is_digit(*it)) {
+        // 20th digit, only valid if it still fits in 64 bits
+        const unsigned digit = static_cast<unsigned>(*it - '0');
+        overflow             = parsed > (std::numeric_limits<uint64_t>::max() - digit) / 10;
+        parsed               = parsed * 10 + digit;
+        ++it;
+        while (it != last && detail::charconv::is_digit(*it)) {
+            overflow = true;
+            ++it;
+        }
+    }
+
+    const uint64_t maxMagnitude = negative ? uint64_t(std::numeric_limits<unsigned_t>::max() / 2) + 1
+                                           : uint64_t(std::numeric_limits<T>::max());
+    if (overflow || parsed > maxMagnitude) {
+        return from_chars_result{it, std::errc::result_out_of_range};
+    }
+
+    const unsigned_t magnitude = static_cast<unsigned_t>(parsed);
+    value                      = static_cast<T>(negative ? unsigned_t(unsigned_t(0) - magnitude) : magnitude);
+    return from_chars_result{it, std::errc()};
+}
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace abc
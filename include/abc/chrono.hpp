@@ -1,6 +1,17 @@
 #pragma once
 
+#include "abc/platform/platform.hpp"
+
 #include <chrono>
+#include <cstdint>
+
+#if defined(ABC_PLATFORM_ARCHITECTURE_AMD64) || defined(ABC_PLATFORM_ARCHITECTURE_X86)
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#    else
+#        include <x86intrin.h>
+#    endif
+#endif
 
 namespace abc {
 namespace chrono {
@@ -21,10 +32,74 @@ public:
     using clock_t::now;
 };
 
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+///@brief: ticks to nanoseconds conversion, measured once against the steady clock
+struct tsc_calibration {
+    bool     useTsc      = false;   // false without an invariant counter, now() then reads the steady clock
+    uint64_t baseTicks   = 0;
+    int64_t  baseNs      = 0;       // steady clock nanoseconds at baseTicks
+    uint64_t nsPerTick32 = 0;       // 32.32 fixed point
+    double   ticksPerNs  = 0.0;
+};
+
+const tsc_calibration& get_tsc_calibration();
+
+inline uint64_t
+read_tsc()
+{
+#if defined(ABC_PLATFORM_ARCHITECTURE_AMD64) || defined(ABC_PLATFORM_ARCHITECTURE_X86)
+    return __rdtsc();
+#elif defined(ABC_PLATFORM_ARCHITECTURE_ARM64) && !defined(_MSC_VER)
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return 0;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+
+///@brief: steady clock reading the time stamp counter (rdtsc on x86, cntvct_el0 on ARM64) without a system
+///        call. The counter is calibrated against std::chrono::steady_clock on the first call, which takes
+///        a few milliseconds; without an invariant counter (or on other architectures) it is the steady clock.
+///        Use it through fast_clock, tsc_timer or ABC_PROFILER_TSC_CLOCK.
+struct tsc_clock {
+    using rep                       = int64_t;
+    using period                    = std::nano;
+    using duration                  = std::chrono::nanoseconds;
+    using time_point                = std::chrono::time_point<tsc_clock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now()
+    {
+        static const detail::tsc_calibration& calibration = detail::get_tsc_calibration();
+        if (!calibration.useTsc) {
+            return time_point(std::chrono::duration_cast<duration>(
+                std::chrono::steady_clock::now().time_since_epoch()));
+        }
+        // 32.32 fixed point split so the product does not overflow for centuries of ticks
+        const uint64_t delta = detail::read_tsc() - calibration.baseTicks;
+        const uint64_t ns    = (delta >> 32) * calibration.nsPerTick32
+                            + (((delta & 0xFFFFFFFFu) * calibration.nsPerTick32) >> 32);
+        return time_point(duration(calibration.baseNs + static_cast<rep>(ns)));
+    }
+
+    ///@return false when now() falls back to the steady clock
+    static bool is_invariant() { return detail::get_tsc_calibration().useTsc; }
+    ///@return counter frequency in ticks per nanosecond, 0 when not used
+    static double get_frequency() { return detail::get_tsc_calibration().ticksPerNs; }
+};
+
 using clock      = ClockBase<std::chrono::high_resolution_clock>;
 using duration   = clock::duration_t;
 using time_point = clock::time_point_t;
 
+using fast_clock = ClockBase<tsc_clock>;
+
 using nanoseconds  = std::chrono::nanoseconds;
 using microseconds = std::chrono::microseconds;
 using milliseconds = std::chrono::milliseconds;
@@ -69,27 +69,31 @@ template <size_t N> struct is_param_string<char[N]> {
 }   // namespace assert
 }   // namespace abc
 
-/// Log
-#define ABC_LOG_ERROR_IMPL(MSG, ...)                                                                                   \
-    do {                                                                                                               \
-        std::cerr << abc::format("[ERROR][{}:{}] {}", __FILE__, __LINE__, abc::format(MSG, __VA_ARGS__)) << std::endl; \
-    } while (0)
-
-#define ABC_LOG_WARNING_IMPL(MSG, ...)                                                                     \
-    do {                                                                                                   \
-        std::cerr << abc::format("[WARNING][{}:{}] {}", __FILE__, __LINE__, abc::format(MSG, __VA_ARGS__)) \
-                  << std::endl;                                                                            \
-    } while (0)
-
-#define ABC_LOG_DEBUG_IMPL(MSG, ...)                                                                                   \
-    do {                                                                                                               \
-        std::cerr << abc::format("[DEBUG][{}:{}] {}", __FILE__, __LINE__, abc::format(MSG, __VA_ARGS__)) << std::endl; \
+/// Log, see abc/log.hpp for the asynchronous backend
+#if defined(ABC_LOG_DEFERRED_MODE)
+// every call site is registered once and formatted by the writer thread, messages must be string literals
+#define ABC_LOG_CHANNEL_IMPL(CHANNEL, LEVEL, MSG, ...) ABC_LOG_DEFERRED_CHANNEL_IMPL(CHANNEL, LEVEL, MSG, ##__VA_ARGS__)
+#define ABC_LOG_ERROR_IMPL(MSG, ...)   ABC_LOG_DEFERRED_IMPL(abc::log::level::error, MSG, ##__VA_ARGS__)
+#define ABC_LOG_WARNING_IMPL(MSG, ...) ABC_LOG_DEFERRED_IMPL(abc::log::level::warning, MSG, ##__VA_ARGS__)
+#define ABC_LOG_DEBUG_IMPL(MSG, ...)   ABC_LOG_DEFERRED_IMPL(abc::log::level::debug, MSG, ##__VA_ARGS__)
+#define ABC_LOG_INFO_IMPL(MSG, ...)    ABC_LOG_DEFERRED_IMPL(abc::log::level::info, MSG, ##__VA_ARGS__)
+#else
+#define ABC_LOG_CHANNEL_IMPL(CHANNEL, LEVEL, MSG, ...)                                    \
+    do {                                                                                  \
+        if ((CHANNEL).is_enabled(LEVEL)) {                                                \
+            abc::log::detail::write_line(LEVEL, __FILE__, __LINE__, MSG, ##__VA_ARGS__); \
+        }                                                                                 \
     } while (0)
 
-#define ABC_LOG_INFO_IMPL(MSG, ...)                                                                                   \
-    do {                                                                                                              \
-        std::cerr << abc::format("[INFO][{}:{}] {}", __FILE__, __LINE__, abc::format(MSG, __VA_ARGS__)) << std::endl; \
-    } while (0)
+#define ABC_LOG_ERROR_IMPL(MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(abc::log::get_root_channel(), abc::log::level::error, MSG, ##__VA_ARGS__)
+#define ABC_LOG_WARNING_IMPL(MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(abc::log::get_root_channel(), abc::log::level::warning, MSG, ##__VA_ARGS__)
+#define ABC_LOG_DEBUG_IMPL(MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(abc::log::get_root_channel(), abc::log::level::debug, MSG, ##__VA_ARGS__)
+#define ABC_LOG_INFO_IMPL(MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(abc::log::get_root_channel(), abc::log::level::info, MSG, ##__VA_ARGS__)
+#endif
 
 /// Assertions
 #define ABC_ASSERT_IMPL(condition, ...)                                                        \
@@ -109,6 +113,7 @@ template <size_t N> struct is_param_string<char[N]> {
 #define ABC_FAIL_IMPL(...)                                                                      \
     do {                                                                                        \
         abc::string msg = abc::format<abc::string>(__VA_ARGS__);                                \
+        abc::log::flush();                                                                      \
         std::cerr << "FAIL: " << msg << "[" << __FILE__ << ":" << __LINE__ << "]" << std::endl; \
         ABC_BREAK();                                                                            \
     } while (false)
@@ -125,6 +130,9 @@ template <size_t N> struct is_param_string<char[N]> {
 #define ABC_LOG_WARNING(MSG, ...) ABC_LOG_WARNING_IMPL(MSG, ##__VA_ARGS__)
 #define ABC_LOG_INFO(MSG, ...)    ABC_LOG_INFO_IMPL(MSG, ##__VA_ARGS__)
 #define ABC_LOG_DEBUG(MSG, ...)   ABC_LOG_DEBUG_IMPL(MSG, ##__VA_ARGS__)
+
+#define ABC_LOG_CHANNEL_DEBUG(CHANNEL, MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(CHANNEL, abc::log::level::debug, MSG, ##__VA_ARGS__)
 #else
 #define ABC_ASSERT(...)
 #define ABC_FAIL(...)
@@ -135,11 +143,23 @@ template <size_t N> struct is_param_string<char[N]> {
 #define ABC_LOG_WARNING(MSG, ...) ABC_LOG_WARNING_IMPL(MSG, ##__VA_ARGS__)
 #define ABC_LOG_INFO(MSG, ...)    ABC_LOG_INFO_IMPL(MSG, ##__VA_ARGS__)
 #define ABC_LOG_DEBUG(...)
+
+#define ABC_LOG_CHANNEL_DEBUG(...)
 #endif
 
+/// Channel logging, CHANNEL is an abc::log::channel: disabled levels cost one relaxed load, arguments
+/// are not evaluated
+#define ABC_LOG_CHANNEL_ERROR(CHANNEL, MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(CHANNEL, abc::log::level::error, MSG, ##__VA_ARGS__)
+#define ABC_LOG_CHANNEL_WARNING(CHANNEL, MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(CHANNEL, abc::log::level::warning, MSG, ##__VA_ARGS__)
+#define ABC_LOG_CHANNEL_INFO(CHANNEL, MSG, ...) \
+    ABC_LOG_CHANNEL_IMPL(CHANNEL, abc::log::level::info, MSG, ##__VA_ARGS__)
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "abc/format.hpp"
 #include "abc/string.hpp"
+#include "abc/log.hpp"   // the ABC_LOG_* macros write through it
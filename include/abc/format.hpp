@@ -1,12 +1,23 @@
-#pragma once
-
+// Included first, debug.hpp includes this header back at its end followed by log.hpp, which needs it complete
+#ifndef ABC_FORMAT_HPP
 #include "abc/debug.hpp"
+#endif
+
+#ifndef ABC_FORMAT_HPP
+#define ABC_FORMAT_HPP
+
+#include "abc/charconv.hpp"
 #include "abc/optional.hpp"
 #include "abc/string.hpp"
 
-#include <vector>
+#include <algorithm>
+#include <cctype>  //isspace
+#include <cmath>   //isfinite
+#include <iterator>
+#include <tuple>
 #include <type_traits>
-#include <sstream>  //ostringstream
+#include <utility>  //index_sequence
+#include <vector>
 
 namespace abc
 {
@@ -44,14 +55,21 @@ struct from_string_impl
 
 //////////////////////////////////////////////////////////////////////////
 
+template <typename T, bool IS_FUNDAMENTAL_T>
+struct format_writer;
+template <class TString>
+struct string_sink;
+
+// fundamental types are rendered by format_writer, which uses abc::to_chars (no iostreams, no locale)
 template <typename T>
 struct to_string_impl<T, true>
 {
     static abc::string impl(const T &value)
     {
-        std::ostringstream ostr;
-        ostr << value;
-        return ostr.str();
+        abc::string              result;
+        string_sink<abc::string> sink(result);
+        format_writer<T, true>::write(sink, value);
+        return result;
     }
 };
 
@@ -60,11 +78,47 @@ struct from_string_impl<T, true>
 {
     static abc::optional<T> impl(const abc::string &str)
     {
-        T                  result;
-        std::istringstream istr(str);
-        istr >> result;
+        // skip leading whitespaces, as std::istream does
+        const char *first = str.data();
+        const char *last  = str.data() + str.size();
+        while (first != last && std::isspace(static_cast<unsigned char>(*first)))
+        {
+            ++first;
+        }
+
+        T result;
+        if (!parse(first, last, result))
+        {
+            return abc::none;
+        }
         return result;
     }
+
+private:
+    template <typename U>
+    static bool parse(const char *first, const char *last, U &o_value)
+    {
+        return abc::from_chars(first, last, o_value).ec == std::errc();
+    }
+    static bool parse(const char *first, const char *last, char &o_value)
+    {
+        if (first == last)
+        {
+            return false;
+        }
+        o_value = *first;
+        return true;
+    }
+    static bool parse(const char *first, const char *last, bool &o_value)
+    {
+        int value = 0;
+        if (abc::from_chars(first, last, value).ec != std::errc() || (value != 0 && value != 1))
+        {
+            return false;
+        }
+        o_value = value == 1;
+        return true;
+    }
 };
 
 }  // namespace detail
@@ -103,12 +157,33 @@ inline string to_string(const char *value) { return string(value); }
 //////////////////////////////////////////////////////////////////////////
 
 ///@brief: format("{} %s", param1IsVariadic, param2isString);
+///        "{{", "}}" and "%%" output a literal '{', '}' and '%'.
+///        "{:[[fill]align][sign][#][0][width][.precision][type]}" specs, i.e. "{:08x}", "{:.3f}", "{:>12}", "{:e}".
+///        Wrapping the literal in ABC_FORMAT_STRING parses it at compile time, see ABC_FORMAT
 template <typename TDest = abc::string, class FormatString, typename... Args>
 TDest format(const FormatString &i_format, Args &&... args);
 
 template <typename TDest = abc::string>
 TDest format();
 
+///@brief: formats into an output iterator, i.e. std::back_inserter(str) or a char*, without heap allocations
+///@return iterator past the last written char
+template <class OutputIt, class FormatString, typename... Args>
+OutputIt format_to(OutputIt out, const FormatString &i_format, const Args &... args);
+
+struct format_to_n_result
+{
+    char  *out;   // past the last written char
+    size_t size;  // size of the full output, may exceed the buffer size when truncated
+};
+///@brief: formats into a caller-provided buffer, writing at most n chars (no null terminator is added)
+template <class FormatString, typename... Args>
+format_to_n_result format_to_n(char *out, size_t n, const FormatString &i_format, const Args &... args);
+
+///@return number of chars abc::format would produce, so callers can reserve once
+template <class FormatString, typename... Args>
+size_t formatted_size(const FormatString &i_format, const Args &... args);
+
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////
@@ -117,22 +192,6 @@ namespace detail
 {
 //////////////////////////////////////////////////////////////////////////
 
-// forward delcare base case, so argument deduction chooses this option when Ts = {}
-template <typename T>
-void extractParams(std::vector<string> &o_params, T head);
-
-template <typename T, typename... Ts>
-void extractParams(std::vector<string> &o_params, T head, Ts... tail)
-{
-    extractParams(o_params, head);
-    extractParams(o_params, tail...);
-}
-template <typename T>
-void extractParams(std::vector<string> &o_params, T head)
-{
-    o_params.insert(o_params.end(), abc::to_string(head));
-}
-
 #if 0 // UNUSED
 template <typename T, typename... Args>
 static abc::string GetParamFromArgs(size_t index, const T &head, Args... args)
@@ -155,201 +214,1380 @@ static abc::string GetParamFromArgs(size_t index, const T &head)
 }
 #endif//UNUSED
 
-template <class FormatString = abc::string>
-struct format_string_adapter
+//////////////////////////////////////////////////////////////////////////
+// format string parsing, shared by the runtime and the compiled paths
+
+struct format_segment
 {
-    explicit format_string_adapter(const FormatString &fmt) : m_it(fmt.begin()), m_end(fmt.end) {}
-    bool is_done() const { return m_it == m_end; }
-    char get() const { return *m_it; }
-    char get_and_advance() { return *m_it++; }
+    enum class kind : uint8_t
+    {
+        literal,
+        placeholder,
+        unterminated,  // '{' without matching '}'
+        end
+    };
 
-private:
-    using iterator = typename FormatString::iterator;
-    iterator m_it;
-    iterator m_end;
+    kind   type;
+    size_t begin;  // literal: offset of the text, placeholder: offset of the text between braces
+    size_t size;
+    size_t next;  // offset where the following segment starts
 };
-template <>
-struct format_string_adapter<char *>
+
+constexpr bool is_printf_placeholder(char c) { return c == 's' || c == 'd' || c == 'f'; }
+
+constexpr bool is_segment_start(const char *fmt, size_t size, size_t pos)
 {
-    explicit format_string_adapter(char *&fmt) : m_it(fmt) {}
-    bool is_done() const { return *(m_it + 1) == 0; }
-    char get() const { return *m_it; }
-    char get_and_advance() { return *m_it++; }
+    return fmt[pos] == '{'                                                             //
+           || (fmt[pos] == '}' && pos + 1 < size && fmt[pos + 1] == '}')              //
+           || (fmt[pos] == '%' && pos + 1 < size                                       //
+               && (fmt[pos + 1] == '%' || is_printf_placeholder(fmt[pos + 1])));
+}
 
-private:
-    const char *m_it;
-};
-template <size_t N>
-struct format_string_adapter<char[N]>
+///@brief: splits "{}", "{{", "}}", "%s/%d/%f", "%%" and the literal runs in between
+constexpr format_segment parse_format_segment(const char *fmt, size_t size, size_t pos)
 {
-    explicit format_string_adapter(const char (&fmt)[N]) : m_it(fmt), m_end(fmt + N - 1) {}
-    bool is_done() const { return m_it == m_end; }
-    char get() const { return *m_it; }
-    char get_and_advance() { return *m_it++; }
+    if (pos >= size)
+    {
+        return format_segment{format_segment::kind::end, size, 0, size};
+    }
 
-private:
-    const char *m_it;
-    const char *m_end;
-};
+    const char c = fmt[pos];
+    if (c == '{')
+    {
+        if (pos + 1 < size && fmt[pos + 1] == '{')
+        {
+            return format_segment{format_segment::kind::literal, pos, 1, pos + 2};
+        }
+        size_t it = pos + 1;
+        while (it < size && fmt[it] != '}')
+        {
+            ++it;
+        }
+        if (it == size)
+        {
+            return format_segment{format_segment::kind::unterminated, pos, size - pos, size};
+        }
+        return format_segment{format_segment::kind::placeholder, pos + 1, it - pos - 1, it + 1};
+    }
+    if (is_segment_start(fmt, size, pos))
+    {
+        // "}}", "%%" or "%s"
+        if (c == '%' && is_printf_placeholder(fmt[pos + 1]))
+        {
+            return format_segment{format_segment::kind::placeholder, pos + 1, 0, pos + 2};
+        }
+        return format_segment{format_segment::kind::literal, pos, 1, pos + 2};
+    }
+
+    size_t it = pos + 1;
+    while (it < size && !is_segment_start(fmt, size, it))
+    {
+        ++it;
+    }
+    return format_segment{format_segment::kind::literal, pos, it - pos, it};
+}
 
-template <typename TDst = abc::string>
-struct dst_adapter
+constexpr format_segment get_format_segment(const char *fmt, size_t size, size_t index)
 {
-    explicit dst_adapter(TDst &dest) : m_buffer(dest.begin(), dest.end()), m_dest(dest) {}
+    format_segment segment = parse_format_segment(fmt, size, 0);
+    for (; index > 0; --index)
+    {
+        segment = parse_format_segment(fmt, size, segment.next);
+    }
+    return segment;
+}
 
-    void append(char c) { m_buffer.push_back(c); }
-    void append(char const *start, char const *end)
+constexpr size_t count_format_segments(const char *fmt, size_t size, format_segment::kind type)
+{
+    size_t         count   = 0;
+    format_segment segment = parse_format_segment(fmt, size, 0);
+    while (segment.type != format_segment::kind::end)
     {
-        m_buffer.append(start, start + (end - start));
+        count += (segment.type == type) ? 1 : 0;
+        segment = parse_format_segment(fmt, size, segment.next);
     }
-    void append(const abc::string &str) { m_buffer.append(str); }
-    void clear()
+    return count;
+}
+
+constexpr size_t count_format_segments(const char *fmt, size_t size)
+{
+    size_t         count   = 0;
+    format_segment segment = parse_format_segment(fmt, size, 0);
+    while (segment.type != format_segment::kind::end)
     {
-        m_dest.clear();
-        m_buffer.clear();
+        ++count;
+        segment = parse_format_segment(fmt, size, segment.next);
     }
-    void finish() { m_dest = m_buffer; }
+    return count;
+}
 
-private:
-    abc::string  m_buffer;
-    abc::string &m_dest;
+///@return number of placeholders preceding the segment at index, i.e. its argument index
+constexpr size_t get_format_argument_index(const char *fmt, size_t size, size_t index)
+{
+    size_t         count   = 0;
+    format_segment segment = parse_format_segment(fmt, size, 0);
+    for (; index > 0; --index)
+    {
+        count += (segment.type == format_segment::kind::placeholder) ? 1 : 0;
+        segment = parse_format_segment(fmt, size, segment.next);
+    }
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// format specs: "{:[[fill]align][sign][#][0][width][.precision][type]}", anything before ':' is ignored
+
+struct format_spec
+{
+    enum class alignment : uint8_t
+    {
+        none,
+        left,    // '<'
+        right,   // '>'
+        center   // '^'
+    };
+    enum class sign_mode : uint8_t
+    {
+        minus,  // '-', only negative values
+        plus,   // '+'
+        space   // ' '
+    };
+
+    char      fill      = ' ';
+    alignment align     = alignment::none;
+    sign_mode sign      = sign_mode::minus;
+    bool      alternate = false;  // '#', 0x/0b/0 prefixes
+    bool      zero      = false;  // '0', pad with zeros after the sign
+    char      type      = '\0';
+    uint32_t  width     = 0;
+    int32_t   precision = -1;
+
+    constexpr bool is_default() const
+    {
+        return align == alignment::none && sign == sign_mode::minus && !alternate && !zero && type == '\0'
+               && width == 0 && precision < 0;
+    }
 };
 
-template <typename TDest>
-struct format_helper
+struct format_spec_result
 {
-    template <typename FormatString, typename... Args>
-    static TDest format(const FormatString &i_format, Args &&... args)
+    format_spec spec;
+    bool        valid;
+};
+
+constexpr bool is_format_spec_type(char c)
+{
+    return c == 's' || c == 'c' || c == 'd' || c == 'x' || c == 'X' || c == 'o' || c == 'b' || c == 'B'
+           || c == 'f' || c == 'F' || c == 'e' || c == 'E' || c == 'g' || c == 'G';
+}
+
+constexpr format_spec::alignment to_format_alignment(char c)
+{
+    return c == '<'   ? format_spec::alignment::left
+           : c == '>' ? format_spec::alignment::right
+           : c == '^' ? format_spec::alignment::center
+                      : format_spec::alignment::none;
+}
+
+constexpr bool parse_format_spec_number(const char *fmt, size_t size, size_t &pos, uint32_t &value)
+{
+    const size_t begin = pos;
+    for (; pos < size && fmt[pos] >= '0' && fmt[pos] <= '9'; ++pos)
     {
-        auto formatString = format_string_adapter<FormatString>(i_format);
-        if (formatString.is_done())
+        value = value * 10 + static_cast<uint32_t>(fmt[pos] - '0');
+        if (value > 0xFFFF)
         {
-            return i_format;
+            return false;
         }
+    }
+    return pos != begin;
+}
 
-        TDest              formattedString;
-        dst_adapter<TDest> outputAdapter(formattedString);
+///@brief: parses the text between the braces of a placeholder
+constexpr format_spec_result parse_format_spec(const char *fmt, size_t size)
+{
+    format_spec_result result{format_spec(), true};
+    format_spec       &spec = result.spec;
 
-        std::vector<string> params;
-        params.reserve(sizeof...(args));
-        detail::extractParams(params, args...);
+    size_t pos = 0;
+    while (pos < size && fmt[pos] != ':')
+    {
+        ++pos;
+    }
+    if (pos == size)
+    {
+        return result;
+    }
+    ++pos;
 
-        auto   paramsIt          = params.begin();
-        size_t placeholdersCount = 0;
+    if (pos + 1 < size && to_format_alignment(fmt[pos + 1]) != format_spec::alignment::none)
+    {
+        spec.fill  = fmt[pos];
+        spec.align = to_format_alignment(fmt[pos + 1]);
+        pos += 2;
+    }
+    else if (pos < size && to_format_alignment(fmt[pos]) != format_spec::alignment::none)
+    {
+        spec.align = to_format_alignment(fmt[pos]);
+        ++pos;
+    }
 
-        while (!formatString.is_done())
-        {
-            char curChar = formatString.get_and_advance();
+    if (pos < size && (fmt[pos] == '+' || fmt[pos] == '-' || fmt[pos] == ' '))
+    {
+        spec.sign = fmt[pos] == '+'   ? format_spec::sign_mode::plus
+                    : fmt[pos] == ' ' ? format_spec::sign_mode::space
+                                      : format_spec::sign_mode::minus;
+        ++pos;
+    }
+    if (pos < size && fmt[pos] == '#')
+    {
+        spec.alternate = true;
+        ++pos;
+    }
+    if (pos < size && fmt[pos] == '0')
+    {
+        spec.zero = true;
+        ++pos;
+    }
 
-            if (curChar == '%')
-            {
-                ++placeholdersCount;
-                while (!formatString.is_done())
-                {
-                    curChar = formatString.get_and_advance();
-                    if (curChar == 's')
-                    {
-                        const abc::string &param = *paramsIt++;
-                        outputAdapter.append(param);
-                        break;
-                    }
-                    else if (curChar == 'd')
-                    {
-                        const abc::string &param = *paramsIt++;
-                        outputAdapter.append(param);
-                        break;
-                    }
-                    else if (curChar == 'f')
-                    {
-                        const abc::string &param = *paramsIt++;
-                        outputAdapter.append(param);
-                        break;
-                    }
-                    else
-                    {
-                        --placeholdersCount;  // not a placeholder
-                        outputAdapter.append('%');
-                        outputAdapter.append(curChar);
-                        break;
-                    }
-                }
-                if (curChar == '%')
-                {
-                    --placeholdersCount;  // not a placeholder
-                    outputAdapter.append(curChar);
-                }
-            }
-            else if (curChar == '{')
-            {
-                ++placeholdersCount;
+    uint32_t width = 0;
+    if (parse_format_spec_number(fmt, size, pos, width))
+    {
+        spec.width = width;
+    }
+    else if (width != 0)
+    {
+        result.valid = false;
+        return result;
+    }
 
-                curChar = formatString.get_and_advance();
-                while (curChar != '}' && !formatString.is_done())
-                {
-                    curChar = formatString.get_and_advance();
-                    // skip formatting parameters, for now
-                }
-                if (curChar == '}')
-                {
-                    ABC_ASSERT(paramsIt != params.end(), "Missing argument #{} in '{}'",
-                               placeholdersCount, i_format);
-                    if (paramsIt != params.end())
-                    {
-                        const abc::string &param = *paramsIt++;
-                        outputAdapter.append(param);
-                    }
-                    else
-                    {
-                        outputAdapter.append(
-                            format("###Missing argument #{} in '{}'", placeholdersCount, i_format));
-                    }
-                }
-                else
-                {
-                    outputAdapter.append(
-                        format("err missing closing '}' at argument #{}", placeholdersCount));
-                }
-            }
-            else
-            {
-                outputAdapter.append(curChar);
-            }
+    if (pos < size && fmt[pos] == '.')
+    {
+        ++pos;
+        uint32_t precision = 0;
+        if (!parse_format_spec_number(fmt, size, pos, precision))
+        {
+            result.valid = false;
+            return result;
         }
+        spec.precision = static_cast<int32_t>(precision);
+    }
 
-        outputAdapter.finish();
-
-        return formattedString;
+    if (pos < size && is_format_spec_type(fmt[pos]))
+    {
+        spec.type = fmt[pos];
+        ++pos;
     }
 
-    template <class FormatString>
-    static TDest format(const FormatString & /* i_format */)
+    result.valid = (pos == size);
+    return result;
+}
+
+///@brief: spec of the placeholder at segment index
+constexpr format_spec_result get_format_spec(const char *fmt, size_t size, size_t index)
+{
+    const format_segment segment = get_format_segment(fmt, size, index);
+    return parse_format_spec(fmt + segment.begin, segment.size);
+}
+
+constexpr bool has_valid_format_specs(const char *fmt, size_t size)
+{
+    format_segment segment = parse_format_segment(fmt, size, 0);
+    while (segment.type != format_segment::kind::end)
     {
-        return TDest();
+        if (segment.type == format_segment::kind::placeholder
+            && !parse_format_spec(fmt + segment.begin, segment.size).valid)
+        {
+            return false;
+        }
+        segment = parse_format_segment(fmt, size, segment.next);
     }
+    return true;
+}
+
+///@brief: which specs an argument type accepts, checked at compile time for ABC_FORMAT_STRING
+enum class format_category : uint8_t
+{
+    integer,
+    floating,
+    character,
+    boolean,
+    string,
+    other
 };
-//////////////////////////////////////////////////////////////////////////
-}  // namespace detail
 
-//////////////////////////////////////////////////////////////////////////
+template <typename T>
+struct format_category_of
+    : std::integral_constant<format_category,
+                             std::is_same<T, bool>::value ? format_category::boolean
+                             : (std::is_same<T, char>::value || std::is_same<T, signed char>::value
+                                || std::is_same<T, unsigned char>::value)
+                                 ? format_category::character
+                             : std::is_integral<T>::value       ? format_category::integer
+                             : std::is_floating_point<T>::value ? format_category::floating
+                                                                : format_category::other>
+{
+};
+template <>
+struct format_category_of<abc::string> : std::integral_constant<format_category, format_category::string>
+{
+};
+template <>
+struct format_category_of<const char *> : std::integral_constant<format_category, format_category::string>
+{
+};
+template <>
+struct format_category_of<char *> : std::integral_constant<format_category, format_category::string>
+{
+};
+template <size_t N>
+struct format_category_of<char[N]> : std::integral_constant<format_category, format_category::string>
+{
+};
 
-template <typename TDest, class FormatString, typename... Args>
-TDest format(const FormatString &i_format, Args &&... args)
+constexpr bool is_integer_presentation(char type)
 {
-    return detail::format_helper<TDest>::format(i_format, std::forward<Args>(args)...);
+    return type == 'd' || type == 'x' || type == 'X' || type == 'o' || type == 'b' || type == 'B';
 }
 
-template <typename TDest, typename T>
-TDest format(const T &i_value)
+constexpr bool format_spec_accepts(format_category category, const format_spec &spec)
 {
-    return abc::to_string(i_value);
+    const bool numericFlags = spec.sign != format_spec::sign_mode::minus || spec.alternate || spec.zero;
+    switch (category)
+    {
+        case format_category::integer:
+            return spec.precision < 0 && (spec.type == '\0' || spec.type == 'c' || is_integer_presentation(spec.type));
+        case format_category::character:
+            return spec.precision < 0
+                   && (((spec.type == '\0' || spec.type == 'c') && !numericFlags)
+                       || is_integer_presentation(spec.type));
+        case format_category::boolean:
+            return spec.precision < 0
+                   && (((spec.type == '\0' || spec.type == 's') && !numericFlags)
+                       || is_integer_presentation(spec.type));
+        case format_category::floating:
+            return spec.type == '\0' || spec.type == 'f' || spec.type == 'F' || spec.type == 'e' || spec.type == 'E'
+                   || spec.type == 'g' || spec.type == 'G';
+        case format_category::string:
+        case format_category::other:
+            return (spec.type == '\0' || spec.type == 's') && !numericFlags;
+    }
+    return false;
 }
 
-template <typename TDest>
-TDest format()
+//////////////////////////////////////////////////////////////////////////
+
+template <class FormatString>
+struct format_string_adapter
 {
-    TDest dest;
-    return dest;
-}
+    explicit format_string_adapter(const FormatString &fmt) : m_data(fmt.data()), m_size(fmt.size()) {}
+    const char *data() const { return m_data; }
+    size_t      size() const { return m_size; }
+
+private:
+    const char *m_data;
+    size_t      m_size;
+};
+template <>
+struct format_string_adapter<const char *>
+{
+    explicit format_string_adapter(const char *fmt) : m_data(fmt), m_size(std::char_traits<char>::length(fmt)) {}
+    const char *data() const { return m_data; }
+    size_t      size() const { return m_size; }
+
+private:
+    const char *m_data;
+    size_t      m_size;
+};
+template <>
+struct format_string_adapter<char *> : format_string_adapter<const char *>
+{
+    explicit format_string_adapter(const char *fmt) : format_string_adapter<const char *>(fmt) {}
+};
+template <size_t N>
+struct format_string_adapter<char[N]>
+{
+    // literals end at N - 1, but char buffers may hold shorter strings
+    explicit format_string_adapter(const char (&fmt)[N])
+        : m_data(fmt), m_size(static_cast<size_t>(std::find(fmt, fmt + N, '\0') - fmt))
+    {
+    }
+    const char *data() const { return m_data; }
+    size_t      size() const { return m_size; }
+
+private:
+    const char *m_data;
+    size_t      m_size;
+};
 
 //////////////////////////////////////////////////////////////////////////
-}  // namespace abc
+// output sinks, the formatting engine appends into them without intermediate buffers
+
+template <class TString>
+struct string_sink
+{
+    explicit string_sink(TString &dest) : m_dest(dest) {}
+
+    void append(char c) { m_dest.push_back(c); }
+    void append(const char *str, size_t size) { m_dest.append(str, size); }
+
+private:
+    TString &m_dest;
+};
+
+template <class OutputIt>
+struct iterator_sink
+{
+    explicit iterator_sink(OutputIt out) : m_out(out) {}
+
+    void     append(char c) { *m_out++ = c; }
+    void     append(const char *str, size_t size) { m_out = std::copy(str, str + size, m_out); }
+    OutputIt out() const { return m_out; }
+
+private:
+    OutputIt m_out;
+};
+
+// back_inserter into a string: append in bulk instead of char by char
+template <class TString>
+struct iterator_sink<std::back_insert_iterator<TString>> : string_sink<TString>
+{
+    using iterator_t = std::back_insert_iterator<TString>;
+
+    explicit iterator_sink(iterator_t out) : string_sink<TString>(container_of(out)), m_out(out) {}
+
+    iterator_t out() const { return m_out; }
+
+private:
+    static TString &container_of(iterator_t it)
+    {
+        struct accessor : iterator_t
+        {
+            explicit accessor(iterator_t base) : iterator_t(base) {}
+            TString *get() const { return this->container; }
+        };
+        return *accessor(it).get();
+    }
+
+    iterator_t m_out;
+};
+
+///@brief: writes up to capacity chars, but keeps counting the full formatted size
+struct bounded_sink
+{
+    bounded_sink(char *out, size_t capacity) : m_out(out), m_capacity(capacity) {}
+
+    void append(char c)
+    {
+        if (m_size < m_capacity)
+        {
+            m_out[m_size] = c;
+        }
+        ++m_size;
+    }
+    void append(const char *str, size_t size)
+    {
+        if (m_size < m_capacity)
+        {
+            const size_t available = m_capacity - m_size;
+            std::copy(str, str + (size < available ? size : available), m_out + m_size);
+        }
+        m_size += size;
+    }
+
+    char  *out() const { return m_out + (m_size < m_capacity ? m_size : m_capacity); }
+    size_t size() const { return m_size; }
+
+private:
+    char  *m_out;
+    size_t m_capacity;
+    size_t m_size = 0;
+};
+
+struct counting_sink
+{
+    void   append(char) { ++m_size; }
+    void   append(const char *, size_t size) { m_size += size; }
+    size_t size() const { return m_size; }
+
+private:
+    size_t m_size = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////
+// argument writers: fundamental and string types are rendered straight into the sink,
+// anything else goes through the to_string_impl extension point
+
+template <typename T, bool IS_FUNDAMENTAL_T = std::is_fundamental<T>::value>
+struct format_writer
+{
+    template <class Sink>
+    static void write(Sink &sink, const T &value)
+    {
+        const abc::string str = abc::to_string(value);
+        sink.append(str.data(), str.size());
+    }
+};
+
+template <typename T>
+struct format_writer<T, true>
+{
+    template <class Sink>
+    static void write(Sink &sink, const T &value)
+    {
+        char                  buffer[charconv::max_chars<T>::value];
+        const to_chars_result result = abc::to_chars(buffer, buffer + sizeof(buffer), value);
+        sink.append(buffer, static_cast<size_t>(result.ptr - buffer));
+    }
+};
+
+// std::ostream prints the character types as characters and bools as 1/0
+template <>
+struct format_writer<char, true>
+{
+    template <class Sink>
+    static void write(Sink &sink, char value)
+    {
+        sink.append(value);
+    }
+};
+template <>
+struct format_writer<signed char, true> : format_writer<char, true>
+{
+};
+template <>
+struct format_writer<unsigned char, true> : format_writer<char, true>
+{
+};
+template <>
+struct format_writer<bool, true>
+{
+    template <class Sink>
+    static void write(Sink &sink, bool value)
+    {
+        sink.append(value ? '1' : '0');
+    }
+};
+template <>
+struct format_writer<std::nullptr_t, true>
+{
+    template <class Sink>
+    static void write(Sink &sink, std::nullptr_t)
+    {
+        sink.append("nullptr", 7);
+    }
+};
+
+template <>
+struct format_writer<abc::string, false>
+{
+    template <class Sink>
+    static void write(Sink &sink, const abc::string &value)
+    {
+        sink.append(value.data(), value.size());
+    }
+};
+template <>
+struct format_writer<const char *, false>
+{
+    template <class Sink>
+    static void write(Sink &sink, const char *value)
+    {
+        sink.append(value, std::char_traits<char>::length(value));
+    }
+};
+template <>
+struct format_writer<char *, false> : format_writer<const char *, false>
+{
+};
+template <size_t N>
+struct format_writer<char[N], false> : format_writer<const char *, false>
+{
+};
+
+//////////////////////////////////////////////////////////////////////////
+// spec-aware writers, only used when the placeholder has a non-empty spec
+
+template <class Sink>
+void write_fill(Sink &sink, char fill, size_t count)
+{
+    for (; count > 0; --count)
+    {
+        sink.append(fill);
+    }
+}
+
+inline size_t get_padding_before(const format_spec &spec, size_t padding, format_spec::alignment defaultAlign)
+{
+    const format_spec::alignment align = spec.align != format_spec::alignment::none ? spec.align : defaultAlign;
+    return align == format_spec::alignment::right    ? padding
+           : align == format_spec::alignment::center ? padding / 2
+                                                     : 0;
+}
+
+template <class Sink>
+void write_padded(Sink &sink, const char *prefix, size_t prefixSize, const char *data, size_t size,
+                  const format_spec &spec, format_spec::alignment defaultAlign)
+{
+    const size_t padding = spec.width > prefixSize + size ? spec.width - prefixSize - size : 0;
+    const size_t before  = get_padding_before(spec, padding, defaultAlign);
+    write_fill(sink, spec.fill, before);
+    sink.append(prefix, prefixSize);
+    sink.append(data, size);
+    write_fill(sink, spec.fill, padding - before);
+}
+template <class Sink>
+void write_padded(Sink &sink, const char *data, size_t size, const format_spec &spec,
+                  format_spec::alignment defaultAlign)
+{
+    write_padded(sink, data, 0, data, size, spec, defaultAlign);
+}
+
+///@brief: sign and base prefix go before the zero padding, "-0x00ff"
+template <class Sink>
+void write_numeric(Sink &sink, const char *prefix, size_t prefixSize, const char *digits, size_t digitsSize,
+                   const format_spec &spec)
+{
+    if (spec.zero && spec.align == format_spec::alignment::none)
+    {
+        const size_t size = prefixSize + digitsSize;
+        sink.append(prefix, prefixSize);
+        write_fill(sink, '0', spec.width > size ? spec.width - size : 0);
+        sink.append(digits, digitsSize);
+        return;
+    }
+    write_padded(sink, prefix, prefixSize, digits, digitsSize, spec, format_spec::alignment::right);
+}
+
+inline size_t write_sign(char *out, bool negative, format_spec::sign_mode sign)
+{
+    if (negative)
+    {
+        *out = '-';
+        return 1;
+    }
+    if (sign != format_spec::sign_mode::minus)
+    {
+        *out = sign == format_spec::sign_mode::plus ? '+' : ' ';
+        return 1;
+    }
+    return 0;
+}
+
+///@brief: writes value in base 2, 8, 10 or 16 backwards, ending right before end
+///@return first written char
+inline char *write_integer_digits(char *end, uint64_t value, char type)
+{
+    if (type == '\0' || type == 'd')
+    {
+        char *begin = end - charconv::count_digits(value);
+        charconv::write_digits(end, value);
+        return begin;
+    }
+
+    const unsigned    shift  = (type == 'x' || type == 'X') ? 4 : (type == 'o') ? 3 : 1;
+    const uint64_t    mask   = (uint64_t(1) << shift) - 1;
+    const char *const digits = type == 'X' ? "0123456789ABCDEF" : "0123456789abcdef";
+    do
+    {
+        *--end = digits[value & mask];
+        value >>= shift;
+    } while (value != 0);
+    return end;
+}
+
+template <format_category CATEGORY>
+struct format_spec_writer;
+
+template <>
+struct format_spec_writer<format_category::integer>
+{
+    template <class Sink, typename T>
+    static void write(Sink &sink, T value, const format_spec &spec)
+    {
+        using unsigned_t = typename std::make_unsigned<T>::type;
+
+        if (spec.type == 'c')
+        {
+            const char c = static_cast<char>(value);
+            write_padded(sink, &c, 1, spec, format_spec::alignment::left);
+            return;
+        }
+
+        const bool     negative  = charconv::is_negative(value, std::is_signed<T>());
+        const uint64_t magnitude = negative ? uint64_t(unsigned_t(unsigned_t(0) - static_cast<unsigned_t>(value)))
+                                            : uint64_t(static_cast<unsigned_t>(value));
+
+        char   prefix[3];
+        size_t prefixSize = write_sign(prefix, negative, spec.sign);
+        if (spec.alternate && spec.type != '\0' && spec.type != 'd')
+        {
+            prefix[prefixSize++] = '0';
+            if (spec.type != 'o')
+            {
+                prefix[prefixSize++] = spec.type;
+            }
+        }
+
+        char        digits[64];
+        const char *begin = write_integer_digits(digits + sizeof(digits), magnitude, spec.type);
+        write_numeric(sink, prefix, prefixSize, begin, static_cast<size_t>(digits + sizeof(digits) - begin), spec);
+    }
+};
+
+template <>
+struct format_spec_writer<format_category::character>
+{
+    template <class Sink, typename T>
+    static void write(Sink &sink, T value, const format_spec &spec)
+    {
+        if (spec.type == '\0' || spec.type == 'c')
+        {
+            const char c = static_cast<char>(value);
+            write_padded(sink, &c, 1, spec, format_spec::alignment::left);
+            return;
+        }
+        format_spec_writer<format_category::integer>::write(sink, value, spec);
+    }
+};
+
+template <>
+struct format_spec_writer<format_category::boolean>
+{
+    template <class Sink>
+    static void write(Sink &sink, bool value, const format_spec &spec)
+    {
+        if (spec.type == 's')
+        {
+            write_padded(sink, value ? "true" : "false", value ? 4 : 5, spec, format_spec::alignment::left);
+            return;
+        }
+        if (spec.type == '\0')
+        {
+            const char c = value ? '1' : '0';
+            write_padded(sink, &c, 1, spec, format_spec::alignment::left);
+            return;
+        }
+        format_spec_writer<format_category::integer>::write(sink, static_cast<unsigned>(value), spec);
+    }
+};
+
+template <>
+struct format_spec_writer<format_category::floating>
+{
+    template <class Sink, typename T>
+    static void write(Sink &sink, T value, const format_spec &spec)
+    {
+        char        buffer[charconv::max_chars<double>::value + 8];
+        const char *digits     = buffer;
+        size_t      digitsSize = 0;
+        abc::string longBuffer;  // only for very long fixed outputs
+
+        if (spec.type == '\0' && spec.precision < 0 && !spec.alternate)
+        {
+            // shortest round-trip representation
+            const to_chars_result result = abc::to_chars(buffer, buffer + sizeof(buffer), value);
+            digitsSize                   = static_cast<size_t>(result.ptr - buffer);
+        }
+        else
+        {
+            // printf's %e/%f/%g, without its locale
+            const char         type      = spec.type != '\0' ? spec.type : 'g';
+            const chars_format format    = type == 'e' || type == 'E' ? chars_format::scientific
+                                           : type == 'f' || type == 'F' ? chars_format::fixed
+                                                                        : chars_format::general;
+            const int          precision = spec.precision >= 0 ? spec.precision : 6;
+            char              *out       = buffer;
+            to_chars_result    result    = charconv::to_chars_precision(
+                out, out + sizeof(buffer), static_cast<double>(value), format, precision, spec.alternate);
+            if (result.ec != std::errc())
+            {
+                // i.e. "{:.3f}" of 1e300: sign, 309 integer digits, point and the precision
+                longBuffer.resize(static_cast<size_t>(precision) + 320);
+                out    = &longBuffer[0];
+                result = charconv::to_chars_precision(
+                    out, out + longBuffer.size(), static_cast<double>(value), format, precision, spec.alternate);
+            }
+            if (type == 'E' || type == 'F' || type == 'G')
+            {
+                for (char *it = out; it != result.ptr; ++it)
+                {
+                    if (*it >= 'a' && *it <= 'z')
+                    {
+                        *it = static_cast<char>(*it - 'a' + 'A');
+                    }
+                }
+            }
+            digits     = out;
+            digitsSize = static_cast<size_t>(result.ptr - out);
+        }
+
+        const bool negative = digitsSize > 0 && digits[0] == '-';
+        if (negative)
+        {
+            ++digits;
+            --digitsSize;
+        }
+
+        char         prefix[1];
+        const size_t prefixSize = write_sign(prefix, negative, spec.sign);
+
+        format_spec numericSpec = spec;
+        if (!std::isfinite(value))
+        {
+            // nan and inf are never zero padded
+            numericSpec.zero = false;
+        }
+        write_numeric(sink, prefix, prefixSize, digits, digitsSize, numericSpec);
+    }
+};
+
+template <>
+struct format_spec_writer<format_category::string>
+{
+    template <class Sink>
+    static void write(Sink &sink, const char *data, size_t size, const format_spec &spec)
+    {
+        if (spec.precision >= 0 && static_cast<size_t>(spec.precision) < size)
+        {
+            size = static_cast<size_t>(spec.precision);
+        }
+        write_padded(sink, data, size, spec, format_spec::alignment::left);
+    }
+
+    template <class Sink>
+    static void write(Sink &sink, const abc::string &value, const format_spec &spec)
+    {
+        write(sink, value.data(), value.size(), spec);
+    }
+    template <class Sink>
+    static void write(Sink &sink, const char *value, const format_spec &spec)
+    {
+        write(sink, value, std::char_traits<char>::length(value), spec);
+    }
+};
+
+template <>
+struct format_spec_writer<format_category::other>
+{
+    template <class Sink, typename T>
+    static void write(Sink &sink, const T &value, const format_spec &spec)
+    {
+        format_spec_writer<format_category::string>::write(sink, abc::to_string(value), spec);
+    }
+};
+
+template <class Sink, typename T>
+void write_argument(Sink &sink, const T &value)
+{
+    format_writer<T>::write(sink, value);
+}
+
+template <class Sink, typename T>
+void write_argument(Sink &sink, const T &value, const format_spec &spec)
+{
+    if (spec.is_default())
+    {
+        format_writer<T>::write(sink, value);
+        return;
+    }
+    if (!format_spec_accepts(format_category_of<T>::value, spec))
+    {
+        ABC_ASSERT(false, "Format spec does not apply to the argument type");
+        format_writer<T>::write(sink, value);
+        return;
+    }
+    format_spec_writer<format_category_of<T>::value>::write(sink, value, spec);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// type-erased arguments, rendered straight into the sink when their placeholder is reached
+
+template <class Sink>
+struct format_arg
+{
+    using write_func = void (*)(Sink &, const void *, const format_spec &);
+
+    const void *value;
+    write_func  write;
+};
+
+template <class Sink, typename T>
+void write_erased_argument(Sink &sink, const void *value, const format_spec &spec)
+{
+    write_argument(sink, *static_cast<const T *>(value), spec);
+}
+
+template <class Sink, typename T>
+format_arg<Sink> make_format_arg(const T &value)
+{
+    return format_arg<Sink>{&value, &write_erased_argument<Sink, T>};
+}
+
+///@brief: non-owning view over the arguments of a single format call
+template <class Sink>
+struct format_args
+{
+    const format_arg<Sink> *args;
+    size_t                  size;
+
+    bool write(Sink &sink, size_t index, const format_spec &spec) const
+    {
+        if (index >= size)
+        {
+            return false;
+        }
+        args[index].write(sink, args[index].value, spec);
+        return true;
+    }
+};
+
+///@brief: references to the arguments plus their thunks, lives on the caller's stack for the whole call
+template <class Sink, size_t N>
+struct format_arg_store
+{
+    format_arg<Sink> args[N > 0 ? N : 1];
+
+    operator format_args<Sink>() const { return format_args<Sink>{args, N}; }
+};
+
+template <class Sink, typename... Args>
+format_arg_store<Sink, sizeof...(Args)> make_format_args(const Args &... args)
+{
+    return format_arg_store<Sink, sizeof...(Args)>{{make_format_arg<Sink>(args)...}};
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: runtime formatting engine, parses i_format while appending into the sink.
+///        Only instantiated once per sink, whatever the argument types.
+template <class Sink>
+void vformat_to_sink(Sink &sink, const char *fmt, size_t fmtSize, format_args<Sink> args)
+{
+    size_t placeholdersCount = 0;
+
+    format_segment segment = parse_format_segment(fmt, fmtSize, 0);
+    while (segment.type != format_segment::kind::end)
+    {
+        switch (segment.type)
+        {
+            case format_segment::kind::literal:
+                sink.append(fmt + segment.begin, segment.size);
+                break;
+            case format_segment::kind::placeholder:
+            {
+                const format_spec_result spec = parse_format_spec(fmt + segment.begin, segment.size);
+                ABC_ASSERT(spec.valid, "Invalid format spec '{}' in '{}'",
+                           abc::string(fmt + segment.begin, segment.size), abc::string(fmt, fmtSize));
+                if (!args.write(sink, placeholdersCount++, spec.valid ? spec.spec : format_spec()))
+                {
+                    ABC_ASSERT(false, "Missing argument #{} in '{}'", placeholdersCount, abc::string(fmt, fmtSize));
+                    static const char k_missing[] = "###Missing argument #{} in '{}'";
+                    const abc::string format = abc::string(fmt, fmtSize);
+                    vformat_to_sink(sink, k_missing, sizeof(k_missing) - 1,
+                                    format_args<Sink>(make_format_args<Sink>(placeholdersCount, format)));
+                }
+                break;
+            }
+            case format_segment::kind::unterminated:
+            {
+                static const char k_unterminated[] = "err missing closing '}}' at argument #{}";
+                const size_t argument = placeholdersCount + 1;
+                vformat_to_sink(sink, k_unterminated, sizeof(k_unterminated) - 1,
+                                format_args<Sink>(make_format_args<Sink>(argument)));
+                break;
+            }
+            case format_segment::kind::end:
+                break;
+        }
+        segment = parse_format_segment(fmt, fmtSize, segment.next);
+    }
+}
+
+template <class Sink, class FormatString, typename... Args>
+void format_to_sink(Sink &sink, const FormatString &i_format, const Args &... args);
+
+//////////////////////////////////////////////////////////////////////////
+// compile-time format strings, see ABC_FORMAT_STRING
+
+struct compiled_format_string
+{
+};
+
+template <class FormatString>
+struct is_compiled_format_string : std::is_base_of<compiled_format_string, FormatString>
+{
+};
+
+template <class FormatString, size_t I,
+          format_segment::kind Kind = get_format_segment(FormatString::data(), FormatString::size(), I).type>
+struct compiled_format_segment;
+
+template <class FormatString, size_t I>
+struct compiled_format_segment<FormatString, I, format_segment::kind::literal>
+{
+    static constexpr size_t begin = get_format_segment(FormatString::data(), FormatString::size(), I).begin;
+    static constexpr size_t size  = get_format_segment(FormatString::data(), FormatString::size(), I).size;
+
+    template <class Sink, class ArgsTuple>
+    static void append(Sink &sink, const ArgsTuple & /*args*/)
+    {
+        sink.append(FormatString::data() + begin, size);
+    }
+};
+
+template <class FormatString, size_t I>
+struct compiled_format_segment<FormatString, I, format_segment::kind::placeholder>
+{
+    static constexpr size_t argument = get_format_argument_index(FormatString::data(), FormatString::size(), I);
+
+    template <class Sink, class ArgsTuple>
+    static void append(Sink &sink, const ArgsTuple &args)
+    {
+        using argument_type =
+            typename std::remove_cv<typename std::remove_reference<decltype(std::get<argument>(args))>::type>::type;
+
+        constexpr format_spec spec = get_format_spec(FormatString::data(), FormatString::size(), I).spec;
+        static_assert(format_spec_accepts(format_category_of<argument_type>::value, spec),
+                      "Format spec does not apply to the argument type");
+        write_argument(sink, std::get<argument>(args), spec);
+    }
+};
+
+template <class FormatString>
+struct compiled_format_helper
+{
+    static_assert(count_format_segments(FormatString::data(), FormatString::size(),
+                                        format_segment::kind::unterminated)
+                      == 0,
+                  "Missing closing '}' in format string");
+    static_assert(has_valid_format_specs(FormatString::data(), FormatString::size()),
+                  "Invalid format spec in format string");
+
+    template <class Sink, typename... Args>
+    static void format_to(Sink &sink, const Args &... args)
+    {
+        static_assert(count_format_segments(FormatString::data(), FormatString::size(),
+                                            format_segment::kind::placeholder)
+                          == sizeof...(Args),
+                      "Placeholder count in format string does not match the argument count");
+
+        constexpr size_t segmentCount = count_format_segments(FormatString::data(), FormatString::size());
+        append_segments(sink, std::forward_as_tuple(args...), std::make_index_sequence<segmentCount>());
+    }
+
+private:
+    template <class Sink, class ArgsTuple, size_t... Is>
+    static void append_segments(Sink &sink, const ArgsTuple &args, std::index_sequence<Is...>)
+    {
+        using expander = int[];
+        (void)expander{0, (compiled_format_segment<FormatString, Is>::append(sink, args), 0)...};
+    }
+};
+
+template <class Sink, class FormatString, typename... Args>
+void format_to_sink_impl(std::true_type /*compiled*/, Sink &sink, const FormatString & /*i_format*/,
+                         const Args &... args)
+{
+    compiled_format_helper<FormatString>::format_to(sink, args...);
+}
+template <class Sink, class FormatString, typename... Args>
+void format_to_sink_impl(std::false_type /*compiled*/, Sink &sink, const FormatString &i_format,
+                         const Args &... args)
+{
+    const auto formatString = format_string_adapter<FormatString>(i_format);
+    vformat_to_sink(sink, formatString.data(), formatString.size(), format_args<Sink>(make_format_args<Sink>(args...)));
+}
+
+template <class Sink, class FormatString, typename... Args>
+void format_to_sink(Sink &sink, const FormatString &i_format, const Args &... args)
+{
+    format_to_sink_impl(is_compiled_format_string<FormatString>(), sink, i_format, args...);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename TDest>
+struct format_helper
+{
+    template <typename FormatString, typename... Args>
+    static TDest format(const FormatString &i_format, const Args &... args)
+    {
+        TDest              formattedString;
+        string_sink<TDest> sink(formattedString);
+        format_to_sink(sink, i_format, args...);
+        return formattedString;
+    }
+
+    template <class FormatString>
+    static TDest format(const FormatString &i_format)
+    {
+        return format_value(is_compiled_format_string<FormatString>(), i_format);
+    }
+
+private:
+    template <class FormatString>
+    static TDest format_value(std::true_type /*compiled*/, const FormatString & /*i_format*/)
+    {
+        TDest              formattedString;
+        string_sink<TDest> sink(formattedString);
+        compiled_format_helper<FormatString>::format_to(sink);
+        return formattedString;
+    }
+    template <typename T>
+    static TDest format_value(std::false_type /*compiled*/, const T &i_value)
+    {
+        return abc::to_string(i_value);
+    }
+};
+//////////////////////////////////////////////////////////////////////////
+}  // namespace detail
+
+//////////////////////////////////////////////////////////////////////////
+
+template <typename TDest, class FormatString, typename... Args>
+TDest format(const FormatString &i_format, Args &&... args)
+{
+    return detail::format_helper<TDest>::format(i_format, std::forward<Args>(args)...);
+}
+
+template <typename TDest, typename T>
+TDest format(const T &i_value)
+{
+    return detail::format_helper<TDest>::format(i_value);
+}
+
+template <typename TDest>
+TDest format()
+{
+    TDest dest;
+    return dest;
+}
+
+template <class OutputIt, class FormatString, typename... Args>
+OutputIt format_to(OutputIt out, const FormatString &i_format, const Args &... args)
+{
+    detail::iterator_sink<OutputIt> sink(out);
+    detail::format_to_sink(sink, i_format, args...);
+    return sink.out();
+}
+
+template <class FormatString, typename... Args>
+format_to_n_result format_to_n(char *out, size_t n, const FormatString &i_format, const Args &... args)
+{
+    detail::bounded_sink sink(out, n);
+    detail::format_to_sink(sink, i_format, args...);
+    return format_to_n_result{sink.out(), sink.size()};
+}
+
+template <class FormatString, typename... Args>
+size_t formatted_size(const FormatString &i_format, const Args &... args)
+{
+    detail::counting_sink sink;
+    detail::format_to_sink(sink, i_format, args...);
+    return sink.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: runtime format string split once, for strings loaded at startup and reused many times.
+///        Same syntax as abc::format. Calls only append, they are const and safe to share across threads.
+///        Usage: const abc::prepared_format fmt(config.line); fmt(file, line);
+class prepared_format
+{
+public:
+    explicit prepared_format(const abc::string &i_format);
+
+    template <typename... Args>
+    abc::string operator()(const Args &... args) const;
+
+    template <class OutputIt, typename... Args>
+    OutputIt format_to(OutputIt out, const Args &... args) const;
+
+    const abc::string &str() const { return m_format; }
+    size_t             placeholders_count() const { return m_placeholdersCount; }
+
+private:
+    template <class Sink>
+    void format_to_sink(Sink &sink, detail::format_args<Sink> args) const;
+
+    struct segment
+    {
+        detail::format_segment::kind type;
+        size_t                       begin;  // literal: offset in m_literals, placeholder: argument index
+        size_t                       size;
+        detail::format_spec          spec;
+    };
+
+    abc::string          m_format;
+    abc::string          m_literals;  // unescaped literal text, adjacent literals merged
+    std::vector<segment> m_segments;
+    size_t               m_placeholdersCount = 0;
+};
+
+inline prepared_format::prepared_format(const abc::string &i_format)
+    : m_format(i_format)
+{
+    using detail::format_segment;
+
+    const char  *fmt     = m_format.data();
+    const size_t fmtSize = m_format.size();
+
+    format_segment parsed = detail::parse_format_segment(fmt, fmtSize, 0);
+    while (parsed.type != format_segment::kind::end)
+    {
+        switch (parsed.type)
+        {
+            case format_segment::kind::literal:
+                if (!m_segments.empty() && m_segments.back().type == format_segment::kind::literal)
+                {
+                    m_segments.back().size += parsed.size;
+                }
+                else
+                {
+                    m_segments.push_back(segment{parsed.type, m_literals.size(), parsed.size, detail::format_spec()});
+                }
+                m_literals.append(fmt + parsed.begin, parsed.size);
+                break;
+            case format_segment::kind::placeholder:
+            {
+                const detail::format_spec_result spec = detail::parse_format_spec(fmt + parsed.begin, parsed.size);
+                ABC_ASSERT(spec.valid, "Invalid format spec '{}' in '{}'", abc::string(fmt + parsed.begin, parsed.size),
+                           m_format);
+                m_segments.push_back(
+                    segment{parsed.type, m_placeholdersCount++, 0, spec.valid ? spec.spec : detail::format_spec()});
+                break;
+            }
+            case format_segment::kind::unterminated:
+                m_segments.push_back(segment{parsed.type, m_placeholdersCount + 1, 0, detail::format_spec()});
+                break;
+            case format_segment::kind::end:
+                break;
+        }
+        parsed = detail::parse_format_segment(fmt, fmtSize, parsed.next);
+    }
+}
+
+template <typename... Args>
+abc::string prepared_format::operator()(const Args &... args) const
+{
+    abc::string formattedString;
+    formattedString.reserve(m_literals.size() + 8 * m_placeholdersCount);
+
+    detail::string_sink<abc::string> sink(formattedString);
+    format_to_sink(sink, detail::format_args<decltype(sink)>(detail::make_format_args<decltype(sink)>(args...)));
+    return formattedString;
+}
+
+template <class OutputIt, typename... Args>
+OutputIt prepared_format::format_to(OutputIt out, const Args &... args) const
+{
+    detail::iterator_sink<OutputIt> sink(out);
+    format_to_sink(sink, detail::format_args<decltype(sink)>(detail::make_format_args<decltype(sink)>(args...)));
+    return sink.out();
+}
+
+template <class Sink>
+void prepared_format::format_to_sink(Sink &sink, detail::format_args<Sink> args) const
+{
+    using detail::format_segment;
+
+    for (const segment &it : m_segments)
+    {
+        switch (it.type)
+        {
+            case format_segment::kind::literal:
+                sink.append(m_literals.data() + it.begin, it.size);
+                break;
+            case format_segment::kind::placeholder:
+                if (!args.write(sink, it.begin, it.spec))
+                {
+                    ABC_ASSERT(false, "Missing argument #{} in '{}'", it.begin + 1, m_format);
+                    static const char k_missing[] = "###Missing argument #{} in '{}'";
+                    const size_t      argument    = it.begin + 1;
+                    detail::vformat_to_sink(
+                        sink, k_missing, sizeof(k_missing) - 1,
+                        detail::format_args<Sink>(detail::make_format_args<Sink>(argument, m_format)));
+                }
+                break;
+            case format_segment::kind::unterminated:
+            {
+                static const char k_unterminated[] = "err missing closing '}}' at argument #{}";
+                detail::vformat_to_sink(sink, k_unterminated, sizeof(k_unterminated) - 1,
+                                        detail::format_args<Sink>(detail::make_format_args<Sink>(it.begin)));
+                break;
+            }
+            case format_segment::kind::end:
+                break;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: appends value as a quoted JSON string, quotes, backslashes and control characters are escaped
+inline void append_json_string(string &out, const string &value)
+{
+    static const char k_hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (const char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            const char escaped[] = {'\\', 'u', '0', '0', k_hex[(c >> 4) & 0xF], k_hex[c & 0xF]};
+            out.append(escaped, sizeof(escaped));
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+///@return nanoseconds with two decimals in the largest unit among ns, us, ms and s, e.g. "1.25 ms"
+inline string format_nanoseconds(double nanoseconds)
+{
+    if (nanoseconds >= 1e9)
+    {
+        return format("{:.2f} s", nanoseconds / 1e9);
+    }
+    if (nanoseconds >= 1e6)
+    {
+        return format("{:.2f} ms", nanoseconds / 1e6);
+    }
+    if (nanoseconds >= 1e3)
+    {
+        return format("{:.2f} us", nanoseconds / 1e3);
+    }
+    return format("{:.2f} ns", nanoseconds);
+}
+
+//////////////////////////////////////////////////////////////////////////
+}  // namespace abc
+
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: wraps a string literal so abc::format parses it at compile time, validates the placeholder
+///        count against the arguments and expands to straight-line appends.
+///        Usage: abc::format(ABC_FORMAT_STRING("{}:{}"), file, line);
+#define ABC_FORMAT_STRING(FORMAT_LITERAL)                                                 \
+    [] {                                                                                 \
+        struct abc_compiled_format_string : abc::detail::compiled_format_string          \
+        {                                                                                \
+            static constexpr const char *data() { return FORMAT_LITERAL; }               \
+            static constexpr size_t      size() { return sizeof(FORMAT_LITERAL) - 1; }   \
+        };                                                                               \
+        return abc_compiled_format_string{};                                             \
+    }()
+
+///@brief: abc::format with a compile-time parsed format literal
+#define ABC_FORMAT(FORMAT_LITERAL, ...) abc::format(ABC_FORMAT_STRING(FORMAT_LITERAL), ##__VA_ARGS__)
+
+#endif   // ABC_FORMAT_HPP
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace abc {
+///////////////////////////////////////////////////////////////////////////////
+
+///@brief: fixed memory log-linear (HDR style) histogram of unsigned values, i.e. latencies in nanoseconds.
+///        Every power of two is split in 2^(SubBucketBits - 1) linear sub-buckets, so a recorded value is known
+///        within that fraction of itself; values up to 2^MaxValueBits are tracked, larger ones land in the last
+///        bucket. One thread records, any thread can read or merge it meanwhile (counters are relaxed atomics).
+template <unsigned SubBucketBits, unsigned MaxValueBits> class basic_log_linear_histogram {
+public:
+    static constexpr unsigned k_subBucketBits = SubBucketBits;
+    static constexpr unsigned k_maxValueBits  = MaxValueBits;
+    static constexpr size_t   k_halfCount     = size_t(1) << (k_subBucketBits - 1);
+    static constexpr size_t   k_bucketCount   = (k_maxValueBits - k_subBucketBits + 1) * k_halfCount + k_halfCount;
+
+    basic_log_linear_histogram() = default;
+    basic_log_linear_histogram(const basic_log_linear_histogram& other) { merge(other); }
+    basic_log_linear_histogram& operator=(const basic_log_linear_histogram& other)
+    {
+        if (this != &other) {
+            reset();
+            merge(other);
+        }
+        return *this;
+    }
+
+    static size_t get_bucket_index(uint64_t value)
+    {
+        if (value < (uint64_t(1) << k_subBucketBits)) {
+            return static_cast<size_t>(value);
+        }
+        const unsigned shift = get_most_significant_bit(value) - (k_subBucketBits - 1);
+        const size_t   index = shift * k_halfCount + static_cast<size_t>(value >> shift);
+        return index < k_bucketCount ? index : k_bucketCount - 1;
+    }
+    ///@return the highest value stored in the bucket
+    static uint64_t get_bucket_upper_bound(size_t index)
+    {
+        if (index < 2 * k_halfCount) {
+            return index;
+        }
+        const unsigned shift    = static_cast<unsigned>(index / k_halfCount - 1);
+        const uint64_t mantissa = index - shift * k_halfCount;
+        return ((mantissa + 1) << shift) - 1;
+    }
+
+    ///@brief: owner only
+    void record(uint64_t value)
+    {
+        add_relaxed(m_counts[get_bucket_index(value)], 1);
+        add_relaxed(m_count, 1);
+        if (value > m_max.load(std::memory_order_relaxed)) {
+            m_max.store(value, std::memory_order_relaxed);
+        }
+    }
+    ///@brief: owner only
+    void reset()
+    {
+        for (std::atomic<uint64_t>& count : m_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_count.store(0, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+    ///@brief: adds the other histogram's counts, only this histogram's owner can call it
+    void merge(const basic_log_linear_histogram& other)
+    {
+        uint64_t total = 0;
+        for (size_t i = 0; i < k_bucketCount; ++i) {
+            const uint64_t count = other.m_counts[i].load(std::memory_order_relaxed);
+            add_relaxed(m_counts[i], count);
+            total += count;
+        }
+        add_relaxed(m_count, total);   // summed from the buckets so a concurrent record stays consistent
+        const uint64_t max = other.m_max.load(std::memory_order_relaxed);
+        if (max > m_max.load(std::memory_order_relaxed)) {
+            m_max.store(max, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t get_count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t get_max() const { return m_max.load(std::memory_order_relaxed); }
+
+    ///@return the smallest value at least percentile (0-100) of the records are lower or equal to, within
+    ///        the bucket precision and never above the recorded maximum. 0 when empty.
+    uint64_t get_percentile(double percentile) const
+    {
+        const uint64_t count = get_count();
+        if (count == 0) {
+            return 0;
+        }
+        double rank = percentile / 100.0 * static_cast<double>(count);
+        rank        = rank < 1.0 ? 1.0 : rank;
+
+        const uint64_t max        = get_max();
+        uint64_t       cumulative = 0;
+        for (size_t i = 0; i < k_bucketCount; ++i) {
+            cumulative += m_counts[i].load(std::memory_order_relaxed);
+            if (static_cast<double>(cumulative) >= rank - 1e-9) {
+                const uint64_t upper = get_bucket_upper_bound(i);
+                return upper < max ? upper : max;
+            }
+        }
+        return max;
+    }
+
+private:
+    static void add_relaxed(std::atomic<uint64_t>& value, uint64_t delta)
+    {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+    static unsigned get_most_significant_bit(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    std::atomic<uint64_t> m_counts[k_bucketCount] = {};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+///@brief: 32 sub-buckets (~3% precision) up to 2^44 (~4.9 hours in nanoseconds), ~10 KB
+using log_linear_histogram = basic_log_linear_histogram<6, 44>;
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace abc
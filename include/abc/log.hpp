@@ -0,0 +1,524 @@
+#pragma once
+
+#include "abc/debug.hpp"
+#include "abc/chrono.hpp"
+#include "abc/format.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>   //memcpy
+#include <type_traits>
+
+namespace abc {
+namespace log {
+//////////////////////////////////////////////////////////////////////////
+
+enum class level : uint8_t {
+    debug,
+    info,
+    warning,
+    error,
+    off   // channel threshold only, disables every level
+};
+const char* get_level_name(level lvl);
+///@brief: case insensitive "debug", "info", "warning" (or "warn"), "error" and "off"
+bool parse_level(const char* name, size_t size, level& out);
+
+namespace detail {
+struct root_channel_tag { };
+}   // namespace detail
+
+///@brief: named log channel, names are hierarchical: "net.http" follows the level set for "net" unless
+///        a level was set for "net.http" itself. Checking a level is a single relaxed atomic load, done by the
+///        ABC_LOG_CHANNEL_* macros before any argument is evaluated.
+///        The name must outlive the channel, channels are usually globals defined with a string literal.
+class channel {
+public:
+    explicit channel(const char* name);
+    constexpr channel(const char* name, detail::root_channel_tag)
+        : m_name(name)
+        , m_threshold(static_cast<uint8_t>(level::debug))
+    {
+    }
+    ~channel();
+    channel(const channel&)            = delete;
+    channel& operator=(const channel&) = delete;
+
+    bool is_enabled(level lvl) const
+    {
+        return static_cast<uint8_t>(lvl) >= m_threshold.load(std::memory_order_relaxed);
+    }
+    level       get_level() const { return static_cast<level>(m_threshold.load(std::memory_order_relaxed)); }
+    const char* get_name() const { return m_name; }
+
+    void set_threshold(level lvl) { m_threshold.store(static_cast<uint8_t>(lvl), std::memory_order_relaxed); }
+
+private:
+    const char*          m_name;
+    std::atomic<uint8_t> m_threshold;   // lowest enabled level
+};
+
+namespace detail {
+extern channel g_rootChannel;
+}   // namespace detail
+
+///@brief: the unnamed channel used by ABC_LOG_ERROR/WARNING/INFO/DEBUG, parent of every named channel
+inline channel&
+get_root_channel()
+{
+    return detail::g_rootChannel;
+}
+
+///@brief: lowest enabled level of a channel and of its children without their own level, "" is the root.
+///        Channels defined later pick it up too.
+void set_level(const char* channelName, level lvl);
+inline void
+set_level(level lvl)
+{
+    set_level("", lvl);
+}
+
+///@brief: comma separated levels, "warning,net=debug,net.http=off", entries without a channel set the root.
+///        The ABC_LOG_LEVEL environment variable is applied with it at startup.
+///@return false, without changing any level, when the specification does not parse
+bool configure_levels(const char* spec);
+
+///@brief: forgets every level set so far, all channels go back to level::debug
+void reset_levels();
+
+enum class overflow_policy : uint8_t {
+    block,          // producers wait for the writer thread to make room
+    drop,           // records are discarded silently
+    count_dropped   // records are discarded, the writer reports how many were lost
+};
+
+enum class output_format : uint8_t {
+    text,
+    binary   // abc/log_file.hpp container, deferred records are not formatted, see tools/abc_logdecode
+};
+
+struct async_config {
+    size_t          capacity     = 4096;   // records in flight, rounded up to a power of two
+    overflow_policy overflow     = overflow_policy::block;
+    int             fd           = 2;      // file descriptor the writer thread writes to
+    bool            flushOnCrash = true;   // drain pending records on SIGSEGV/SIGABRT/..., then run the handlers
+                                           // installed before, or die
+    output_format   output       = output_format::text;
+
+    size_t   deferredBufferSize   = 64 * 1024;   // bytes per producer thread for ABC_LOG_DEFERRED_* records
+    uint32_t suppressedReportMs = 1000;        // period of the "suppressed N messages" summaries, 0 disables
+};
+
+///@brief: ABC_LOG_* records are pushed into a lock-free MPSC ring and written by a background thread
+///        in large batches, instead of formatting into std::cerr and flushing every line.
+///@return false if the backend was already running
+bool start_async(const async_config& config = async_config());
+///@brief: writes every pending record, joins the writer thread and goes back to synchronous logging
+void stop_async();
+bool is_async();
+
+///@brief: blocks until every record pushed before the call has been written
+void flush();
+
+///@return records lost since start_async with overflow_policy::drop or count_dropped
+uint64_t get_dropped_count();
+
+///@brief: logs a "suppressed N messages" summary for every rate limited call site (ABC_LOG_EVERY_N, ...)
+///        that dropped messages since its last summary; the async writer does it every suppressedReportMs
+void report_suppressed();
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: hands a full line ('\n' terminated) to the async backend, or to std::cerr when it is not running
+void submit(level lvl, const char* line, size_t size);
+
+constexpr size_t k_lineBufferSize = 512;
+
+///@brief: formats "[LEVEL][file:line] message\n" on the stack, only long lines allocate
+template <class FormatString, typename... Args>
+void
+write_line(level lvl, const char* file, int line, const FormatString& i_format, const Args&... args)
+{
+    char                      buffer[k_lineBufferSize];
+    abc::detail::bounded_sink sink(buffer, sizeof(buffer));
+    abc::detail::format_to_sink(sink, ABC_FORMAT_STRING("[{}][{}:{}] "), get_level_name(lvl), file, line);
+    abc::detail::format_to_sink(sink, i_format, args...);
+    sink.append('\n');
+
+    if (sink.size() <= sizeof(buffer)) {
+        submit(lvl, buffer, sink.size());
+        return;
+    }
+
+    abc::string                           longLine;
+    abc::detail::string_sink<abc::string> longSink(longLine);
+    longLine.reserve(sink.size());
+    abc::detail::format_to_sink(longSink, ABC_FORMAT_STRING("[{}][{}:{}] "), get_level_name(lvl), file, line);
+    abc::detail::format_to_sink(longSink, i_format, args...);
+    longSink.append('\n');
+    submit(lvl, longLine.data(), longLine.size());
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// deferred logging, see ABC_LOG_DEFERRED_INFO: every call site registers its format string once,
+// records only carry the site id, a timestamp and the raw arguments, the writer thread formats them
+
+struct log_site {
+    level       lvl;
+    const char* format;
+    const char* file;
+    int         line;
+    const char* signature;   // one type code per argument, see deferred_argument
+};
+
+///@return id of the call site, stable for the lifetime of the process
+uint32_t register_site(level lvl, const char* format, const char* file, int line, const char* signature);
+///@return nullptr for unknown ids
+const log_site* find_site(uint32_t id);
+
+// records: header followed by the encoded arguments, aligned to the header size in the per-thread buffers
+struct deferred_record_header {
+    uint32_t size;   // header included
+    uint32_t site;
+    uint64_t timestamp;   // nanoseconds since the clock epoch
+};
+
+inline uint64_t
+get_timestamp()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(abc::chrono::clock::now().time_since_epoch()).count());
+}
+
+///@brief: formats encoded arguments with a site's format string, used by the writer thread and offline decoders
+///@return false when the data does not match the signature
+bool format_deferred_arguments(abc::string& out, const char* format, const char* signature, const char* data,
+                               size_t size);
+
+enum class deferred_status : uint8_t {
+    reserved,
+    dropped,
+    unavailable   // no async backend or the record does not fit, format synchronously
+};
+struct deferred_reservation {
+    char*           out;
+    deferred_status status;
+};
+
+///@brief: room in the calling thread's buffer, commit_deferred publishes it to the writer thread
+deferred_reservation reserve_deferred(size_t size);
+void                 commit_deferred(size_t size);
+
+///@brief: argument encoding, arithmetic types are copied as is, strings as a 32-bit length plus the bytes
+template <typename T, typename Enable = void> struct deferred_argument;
+
+template <typename T>
+struct deferred_argument<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    static constexpr char code = std::is_same<T, bool>::value ? 'b'
+        : (std::is_same<T, char>::value || std::is_same<T, signed char>::value
+              || std::is_same<T, unsigned char>::value)
+        ? 'c'
+        : std::is_same<T, float>::value  ? 'f'
+        : std::is_same<T, double>::value ? 'd'
+        : sizeof(T) == 2                 ? (std::is_signed<T>::value ? 'h' : 'H')
+        : sizeof(T) == 4                 ? (std::is_signed<T>::value ? 'i' : 'I')
+                                         : (std::is_signed<T>::value ? 'l' : 'L');
+
+    static size_t size(T) { return sizeof(T); }
+    static char*  encode(char* out, T value)
+    {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+};
+
+template <> struct deferred_argument<abc::string> {
+    static constexpr char code = 's';
+
+    static size_t size(const abc::string& value) { return sizeof(uint32_t) + value.size(); }
+    static char*  encode(char* out, const abc::string& value) { return encode(out, value.data(), value.size()); }
+    static char*  encode(char* out, const char* value, size_t size)
+    {
+        const uint32_t length = static_cast<uint32_t>(size);
+        std::memcpy(out, &length, sizeof(length));
+        std::memcpy(out + sizeof(length), value, size);
+        return out + sizeof(length) + size;
+    }
+};
+
+template <> struct deferred_argument<const char*> {
+    static constexpr char code = 's';
+
+    static size_t size(const char* value) { return sizeof(uint32_t) + std::char_traits<char>::length(value); }
+    static char*  encode(char* out, const char* value)
+    {
+        return deferred_argument<abc::string>::encode(out, value, std::char_traits<char>::length(value));
+    }
+};
+
+///@brief: types without an encoding are formatted eagerly with abc::to_string and stored as strings
+template <typename T, bool HAS_ENCODING = std::is_arithmetic<T>::value> struct deferred_value {
+    using type = abc::string;
+    static abc::string get(const T& value) { return abc::to_string(value); }
+};
+template <typename T> struct deferred_value<T, true> {
+    using type = typename std::conditional<std::is_same<T, long double>::value, double, T>::type;
+    static type get(T value) { return static_cast<type>(value); }
+};
+template <> struct deferred_value<abc::string, false> {
+    using type = abc::string;
+    static const abc::string& get(const abc::string& value) { return value; }
+};
+template <> struct deferred_value<const char*, false> {
+    using type = const char*;
+    static const char* get(const char* value) { return value; }
+};
+template <> struct deferred_value<char*, false> : deferred_value<const char*, false> { };
+template <size_t N> struct deferred_value<char[N], false> : deferred_value<const char*, false> { };
+
+template <typename T> using deferred_type_t = typename deferred_value<T>::type;
+
+template <typename... Args> struct deferred_signature {
+    static const char* get()
+    {
+        static const char s_signature[] = {deferred_argument<deferred_type_t<Args>>::code..., '\0'};
+        return s_signature;
+    }
+};
+
+///@brief: only used in decltype by ABC_LOG_DEFERRED_IMPL, the arguments are never evaluated
+template <typename... Args> deferred_signature<Args...> make_deferred_signature(const Args&...);
+
+template <typename... Args>
+void
+write_deferred_values(uint32_t siteId, const Args&... values)
+{
+    const size_t sizes[] = {sizeof(deferred_record_header), deferred_argument<Args>::size(values)...};
+    size_t       size    = 0;
+    for (const size_t argumentSize : sizes) {
+        size += argumentSize;
+    }
+
+    const deferred_reservation reservation = reserve_deferred(size);
+    if (reservation.status == deferred_status::reserved) {
+        const deferred_record_header header = {static_cast<uint32_t>(size), siteId, get_timestamp()};
+        std::memcpy(reservation.out, &header, sizeof(header));
+
+        char* out = reservation.out + sizeof(header);
+        using expander = int[];
+        (void)expander{0, (out = deferred_argument<Args>::encode(out, values), 0)...};
+        (void)out;   // unused without arguments
+        commit_deferred(size);
+    } else if (reservation.status == deferred_status::unavailable) {
+        const log_site* site = find_site(siteId);
+        write_line(site->lvl, site->file, site->line, site->format, values...);
+    }
+}
+
+template <typename... Args>
+void
+write_deferred(uint32_t siteId, const Args&... args)
+{
+    write_deferred_values(siteId, deferred_value<Args>::get(args)...);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// rate limited logging, see ABC_LOG_EVERY_N: every call site owns a constant initialized static state,
+// suppressed calls only touch its atomics
+
+class rate_limited_site {
+public:
+    constexpr rate_limited_site(level lvl, const char* file, int line)
+        : m_lvl(lvl)
+        , m_file(file)
+        , m_line(line)
+    {
+    }
+
+    level       get_level() const { return m_lvl; }
+    const char* get_file() const { return m_file; }
+    int         get_line() const { return m_line; }
+
+    ///@return messages suppressed since the last call
+    uint64_t take_suppressed() { return m_suppressed.exchange(0, std::memory_order_relaxed); }
+
+    ///@brief: logs the pending summary, called before a message goes through
+    void report()
+    {
+        const uint64_t suppressed = take_suppressed();
+        if (suppressed != 0) {
+            write_line(m_lvl, m_file, m_line, ABC_FORMAT_STRING("suppressed {} messages"), suppressed);
+        }
+    }
+
+    rate_limited_site* next = nullptr;   // list of sites that suppressed at least once
+
+protected:
+    bool suppress()
+    {
+        if (m_suppressed.fetch_add(1, std::memory_order_relaxed) == 0 && !m_registered.load(std::memory_order_relaxed)
+            && !m_registered.exchange(true, std::memory_order_relaxed)) {
+            register_rate_limited_site(this);
+        }
+        return false;
+    }
+
+private:
+    static void register_rate_limited_site(rate_limited_site* site);
+
+    const level           m_lvl;
+    const char* const     m_file;
+    const int             m_line;
+    std::atomic<uint64_t> m_suppressed{0};
+    std::atomic<bool>     m_registered{false};
+};
+
+///@brief: the 1st, N+1th, 2N+1th... calls go through
+class every_n_site : public rate_limited_site {
+public:
+    using rate_limited_site::rate_limited_site;
+
+    bool should_log(uint64_t n)
+    {
+        const uint64_t count = m_count.fetch_add(1, std::memory_order_relaxed);
+        return n <= 1 || count % n == 0 ? true : suppress();
+    }
+
+private:
+    std::atomic<uint64_t> m_count{0};
+};
+
+///@brief: the first N calls go through
+class first_n_site : public rate_limited_site {
+public:
+    using rate_limited_site::rate_limited_site;
+
+    bool should_log(uint64_t n)
+    {
+        // the counter stops growing once the site is saturated
+        if (m_count.load(std::memory_order_relaxed) >= n) {
+            return suppress();
+        }
+        return m_count.fetch_add(1, std::memory_order_relaxed) < n ? true : suppress();
+    }
+
+private:
+    std::atomic<uint64_t> m_count{0};
+};
+
+///@brief: at most one call every ms milliseconds goes through
+class every_ms_site : public rate_limited_site {
+public:
+    using rate_limited_site::rate_limited_site;
+
+    bool should_log(uint64_t ms)
+    {
+        const uint64_t now  = get_timestamp();
+        uint64_t       next = m_next.load(std::memory_order_relaxed);
+        if (now < next || !m_next.compare_exchange_strong(next, now + ms * 1000000, std::memory_order_relaxed)) {
+            return suppress();
+        }
+        return true;
+    }
+
+private:
+    std::atomic<uint64_t> m_next{0};   // timestamp of the next call allowed through
+};
+
+///@brief: token bucket of `burst` tokens refilled at `perSecond`, as a generic cell rate algorithm:
+///        a single atomic holds the theoretical arrival time of the next call. A rate that is not positive never
+///        lets a call through, rates under one per century are rounded up to it.
+class token_bucket_site : public rate_limited_site {
+public:
+    using rate_limited_site::rate_limited_site;
+
+    bool should_log(double perSecond, uint64_t burst)
+    {
+        constexpr double k_maxIntervalNs = 100.0 * 365 * 24 * 3600 * 1e9;
+        if (!(perSecond > 0.0)) {
+            return suppress();
+        }
+        const uint64_t interval  = static_cast<uint64_t>(std::min(1e9 / perSecond, k_maxIntervalNs));
+        const uint64_t tolerance = interval * (burst > 0 ? burst - 1 : 0);
+        const uint64_t now       = get_timestamp();
+        uint64_t       arrival   = m_arrival.load(std::memory_order_relaxed);
+        for (;;) {
+            if (arrival > now + tolerance) {
+                return suppress();
+            }
+            const uint64_t next = (arrival > now ? arrival : now) + interval;
+            if (m_arrival.compare_exchange_weak(arrival, next, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+    }
+
+private:
+    std::atomic<uint64_t> m_arrival{0};
+};
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace log
+}   // namespace abc
+
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: NanoLog-style logging for hot loops, FORMAT_LITERAL must be a string literal.
+///        The call site is registered once, then a call only copies a site id, a timestamp and the arguments
+///        into a per-thread buffer; the writer thread formats them. Without start_async it formats synchronously.
+#define ABC_LOG_DEFERRED_CHANNEL_IMPL(CHANNEL, LEVEL, FORMAT_LITERAL, ...)                               \
+    do {                                                                                               \
+        if ((CHANNEL).is_enabled(LEVEL)) {                                                             \
+            static const uint32_t abc_logSiteId = abc::log::detail::register_site(LEVEL, FORMAT_LITERAL, \
+                __FILE__, __LINE__,                                                                    \
+                decltype(abc::log::detail::make_deferred_signature(__VA_ARGS__))::get());              \
+            abc::log::detail::write_deferred(abc_logSiteId, ##__VA_ARGS__);                            \
+        }                                                                                              \
+    } while (0)
+#define ABC_LOG_DEFERRED_IMPL(LEVEL, FORMAT_LITERAL, ...) \
+    ABC_LOG_DEFERRED_CHANNEL_IMPL(abc::log::get_root_channel(), LEVEL, FORMAT_LITERAL, ##__VA_ARGS__)
+
+#define ABC_LOG_DEFERRED_ERROR(FORMAT_LITERAL, ...) \
+    ABC_LOG_DEFERRED_IMPL(abc::log::level::error, FORMAT_LITERAL, ##__VA_ARGS__)
+#define ABC_LOG_DEFERRED_WARNING(FORMAT_LITERAL, ...) \
+    ABC_LOG_DEFERRED_IMPL(abc::log::level::warning, FORMAT_LITERAL, ##__VA_ARGS__)
+#define ABC_LOG_DEFERRED_INFO(FORMAT_LITERAL, ...) \
+    ABC_LOG_DEFERRED_IMPL(abc::log::level::info, FORMAT_LITERAL, ##__VA_ARGS__)
+#if defined(ABC_DEBUG) || defined(ABC_RELEASE_CHECKED)
+#define ABC_LOG_DEFERRED_DEBUG(FORMAT_LITERAL, ...) \
+    ABC_LOG_DEFERRED_IMPL(abc::log::level::debug, FORMAT_LITERAL, ##__VA_ARGS__)
+#else
+#define ABC_LOG_DEFERRED_DEBUG(...)
+#endif
+
+///@brief: rate limited logging for messages that can fire in bursts, LEVEL is debug, info, warning or error.
+///        Suppressed calls skip argument evaluation and formatting; the number of suppressed messages is logged
+///        before the next message that goes through and periodically by abc::log::report_suppressed.
+#define ABC_LOG_RATE_LIMITED_IMPL(SITE_TYPE, LEVEL, LIMITS, MSG, ...)                                         \
+    do {                                                                                                     \
+        static SITE_TYPE abc_logRateSite(abc::log::level::LEVEL, __FILE__, __LINE__);                         \
+        if (abc::log::get_root_channel().is_enabled(abc::log::level::LEVEL) && abc_logRateSite.should_log LIMITS) { \
+            abc_logRateSite.report();                                                                        \
+            ABC_LOG_CHANNEL_IMPL(abc::log::get_root_channel(), abc::log::level::LEVEL, MSG, ##__VA_ARGS__);   \
+        }                                                                                                    \
+    } while (0)
+
+#define ABC_LOG_EVERY_N(LEVEL, N, MSG, ...) \
+    ABC_LOG_RATE_LIMITED_IMPL(abc::log::detail::every_n_site, LEVEL, (N), MSG, ##__VA_ARGS__)
+#define ABC_LOG_FIRST_N(LEVEL, N, MSG, ...) \
+    ABC_LOG_RATE_LIMITED_IMPL(abc::log::detail::first_n_site, LEVEL, (N), MSG, ##__VA_ARGS__)
+#define ABC_LOG_EVERY_MS(LEVEL, MS, MSG, ...) \
+    ABC_LOG_RATE_LIMITED_IMPL(abc::log::detail::every_ms_site, LEVEL, (MS), MSG, ##__VA_ARGS__)
+///@brief: up to BURST messages at once, then PER_SECOND messages per second
+#define ABC_LOG_RATE_LIMITED(LEVEL, PER_SECOND, BURST, MSG, ...) \
+    ABC_LOG_RATE_LIMITED_IMPL(abc::log::detail::token_bucket_site, LEVEL, (PER_SECOND, BURST), MSG, ##__VA_ARGS__)
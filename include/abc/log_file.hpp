@@ -0,0 +1,143 @@
+#pragma once
+
+#include "abc/log.hpp"
+#include "abc/string.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+
+///@brief: binary log container written by the async backend with async_config::output = output_format::binary
+///
+///  file   := magic chunk*
+///  magic  := "ABCLOG" 0x00 version(0x01)
+///  chunk  := tag:u8 size:varint payload[size]
+///
+///  'S' site   := id:varint level:u8 line:varint file:str format:str signature:str
+///  'B' block  := first:varint last:varint record*      (min/max absolute timestamps of the records)
+///      record := site:varint delta:zigzag size:varint data[size]
+///
+///  str    := size:varint bytes[size]
+///  varint := unsigned LEB128, zigzag maps signed deltas to unsigned values
+///
+///  The sites known when the backend starts follow the magic, the ones registered later are written before the
+///  first block that uses them. Record sites are the site id + 1, 0 holds an already formatted text line
+///  (ABC_LOG_* records, dropped record reports). The first record of a block stores its absolute timestamp,
+///  the next ones the delta to the previous record. Blocks carry their timestamp range so readers seek by
+///  skipping whole blocks, and chunks are written whole so a reader following a growing file only has to
+///  retry an incomplete trailing chunk.
+
+namespace abc {
+namespace log {
+namespace binary {
+//////////////////////////////////////////////////////////////////////////
+
+constexpr char     k_magic[]        = {'A', 'B', 'C', 'L', 'O', 'G', '\0', '\x01'};
+constexpr char     k_siteChunk      = 'S';
+constexpr char     k_blockChunk     = 'B';
+constexpr uint32_t k_textRecordSite = 0;
+constexpr size_t   k_maxVarintSize  = 10;
+
+inline char*
+write_varint(char* out, uint64_t value)
+{
+    while (value >= 0x80) {
+        *out++ = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+inline void
+append_varint(abc::string& out, uint64_t value)
+{
+    char buffer[k_maxVarintSize];
+    out.append(buffer, static_cast<size_t>(write_varint(buffer, value) - buffer));
+}
+
+///@return false when the data ends before the varint does
+inline bool
+read_varint(const char*& data, const char* end, uint64_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; data != end && shift < 64; shift += 7) {
+        const uint8_t byte = static_cast<uint8_t>(*data++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+constexpr uint64_t
+zigzag_encode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+constexpr int64_t
+zigzag_decode(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+enum class read_status : uint8_t {
+    record,
+    end,       // nothing more to read yet, the file may still be growing
+    corrupted
+};
+
+struct decoded_record {
+    const detail::log_site* site;   // nullptr for text records
+    uint64_t                timestamp;
+    abc::string             text;   // formatted line, without the trailing '\n'
+};
+
+///@brief: decodes a binary log chunk by chunk, an incomplete trailing chunk is retried on the next call
+class reader {
+public:
+    explicit reader(std::FILE* file);
+
+    ///@return false when the file does not start with the magic (or is still too short to tell)
+    bool open();
+
+    read_status next(decoded_record& out);
+
+    ///@brief: restarts from the first record at or after timestamp, blocks ending before it are skipped
+    ///        by their timestamp range without reading their records
+    void seek(uint64_t timestamp);
+
+    const detail::log_site* find_site(uint32_t id) const;
+
+private:
+    struct site_storage {
+        detail::log_site site;
+        abc::string      file;
+        abc::string      format;
+        abc::string      signature;
+    };
+
+    read_status read_chunk();
+    bool        read_file_varint(uint64_t& value);
+    bool        read_site(const char* data, const char* end);
+    read_status read_record(decoded_record& out);
+
+    std::FILE*               m_file;
+    long                     m_offset = 0;   // start of the next chunk
+    std::deque<site_storage> m_sites;        // log_site points into its own storage, never moved
+    abc::string              m_chunk;
+    const char*              m_record       = nullptr;   // next record of the current block
+    const char*              m_blockEnd     = nullptr;
+    uint64_t                 m_timestamp    = 0;         // of the previous record
+    uint64_t                 m_minTimestamp = 0;         // set by seek
+};
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace binary
+}   // namespace log
+}   // namespace abc
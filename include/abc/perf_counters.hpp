@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace abc {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+enum class perf_counter : uint8_t {
+    cycles,
+    instructions,
+    cache_misses,    // last level cache
+    branch_misses,
+    count
+};
+
+constexpr size_t k_perfCounterCount = static_cast<size_t>(perf_counter::count);
+
+const char* get_perf_counter_name(perf_counter counter);
+
+///@brief: hardware counters of the calling thread, opened as one perf_event_open group (Linux only) so
+///        they are scheduled together. Counters are read with rdpmc when the kernel allows user space
+///        access, else with a single read() of the group.
+class perf_counter_group {
+public:
+    struct values {
+        uint64_t counts[k_perfCounterCount] = {};
+    };
+
+    ///@return nullptr when perf events are not permitted (perf_event_paranoid, seccomp filters in
+    ///        containers, virtual machines without a PMU) or not supported by the platform
+    static std::unique_ptr<perf_counter_group> open();
+
+    ~perf_counter_group();
+    perf_counter_group(const perf_counter_group&)            = delete;
+    perf_counter_group& operator=(const perf_counter_group&) = delete;
+
+    ///@brief: counters that could not be opened (not supported by the CPU) stay at 0
+    bool is_available(perf_counter counter) const { return m_fds[static_cast<size_t>(counter)] >= 0; }
+
+    ///@return false when the counters could not be read
+    bool read(values& out) const;
+
+private:
+    perf_counter_group() = default;
+
+    bool read_rdpmc(values& out) const;
+
+    int   m_fds[k_perfCounterCount]   = {-1, -1, -1, -1};
+    void* m_pages[k_perfCounterCount] = {};   // perf_event_mmap_page of every counter, for rdpmc
+    bool  m_rdpmc                     = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace abc
@@ -2,241 +2,1009 @@
 
 #include "abc/debug.hpp"
 #include "abc/format.hpp"
+#include "abc/histogram.hpp"
+#include "abc/perf_counters.hpp"
+#include "abc/rolling_window.hpp"
 #include "abc/string.hpp"
 #include "abc/timer.hpp"
 
-#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 namespace abc {
 namespace detail {
 ///////////////////////////////////////////////////////////////////////////////
 
+template <typename T> struct profiler_tls {
+    static thread_local T* value;   // trivially constructible, accessing it costs no initialization check
+};
+template <typename T> thread_local T* profiler_tls<T>::value = nullptr;
+
 struct profiler {
+public:
+    using tag_id = uint32_t;
+#if defined(ABC_PROFILER_TSC_CLOCK)
+    using clock = abc::chrono::fast_clock;   // reads the time stamp counter, see abc::chrono::tsc_clock
+#else
+    using clock = abc::chrono::timer::clock_t;
+#endif
+    using duration   = clock::duration_t;
+    using time_point = clock::time_point_t;
+
 protected:
     struct ProfilingData;
-    using sample_container_t          = std::vector<ProfilingData>;
-    using sample_container_iterator_t = sample_container_t::iterator;
+    using sample_container_t = std::deque<ProfilingData>;   // indexed by tag_id, elements never move
 
 public:
-    static profiler& GetInstance()
-    {
-        static profiler theInstance;
-        return theInstance;
-    }
+    ///@brief: allocations of a thread seen by the ABC_PROFILE_ALLOCATION_HOOKS operator new and delete
+    struct allocation_counts {
+        uint64_t allocations   = 0;
+        uint64_t bytes         = 0;
+        uint64_t deallocations = 0;
+    };
 
-    void initialize() { }
+    ///@brief: hardware counter sums of one tag in one thread, see enable_counters
+    struct counter_stats {
+        std::atomic<uint64_t>      sums[k_perfCounterCount] = {};
+        std::atomic<uint64_t>      samples{0};
+        perf_counter_group::values start;             // owner only, counters at the begin of the open zone
+        bool                       started = false;   // owner only
+    };
 
-    void print_summary(const std::vector<abc::string>& tagFilter = std::vector<abc::string>()) const
-    {
-        std::cout << "-----------------------------------------------------------------" << std::endl;
-        std::cout << "-- Profiling summary" << std::endl;
-        std::cout << "-----------------------------------------------------------------" << std::endl;
+    ///@brief: statistics of one tag in one thread. Only the owning thread writes them, the fields are relaxed
+    ///        atomics so summaries can read them while the thread keeps running.
+    struct tag_stats {
+        std::atomic<duration::rep> accum{0};
+        std::atomic<duration::rep> min{std::numeric_limits<duration::rep>::max()};
+        std::atomic<duration::rep> max{0};
+        std::atomic<duration::rep> locked{0};
+        std::atomic<uint64_t>      samples{0};
+        std::atomic<uint64_t>      locks{0};
+        std::atomic<uint64_t>      allocations{0};   // made during the zones, nested zones included
+        std::atomic<uint64_t>      allocatedBytes{0};
+        std::atomic<uint64_t>      deallocations{0};
+        time_point                 t0;               // owner only, begin of the open zone
+        allocation_counts          allocations0;     // owner only, thread allocations at t0
+        duration::rep              overhead0 = 0;    // owner only, thread nested overhead at t0
+
+        std::atomic<log_linear_histogram*> histogram{nullptr};   // set by the owner, see enable_histogram
+        std::atomic<counter_stats*>        counters{nullptr};    // set by the owner, see enable_counters
+        std::atomic<rolling_window*>       window{nullptr};      // set by the owner, see enable_window
+        std::atomic<uint32_t>              generation{0};        // reset generation of the tag, see declare
+
+        tag_stats() = default;
+        ~tag_stats()
+        {
+            delete histogram.load(std::memory_order_relaxed);
+            delete counters.load(std::memory_order_relaxed);
+            delete window.load(std::memory_order_relaxed);
+        }
+        tag_stats(const tag_stats&)            = delete;
+        tag_stats& operator=(const tag_stats&) = delete;
 
-        const auto timeUnitsFunc = [](const abc::chrono::duration& duration) {
-            if (duration >= abc::chrono::seconds(1)) {
-                return abc::format("{} s", std::chrono::duration_cast<abc::chrono::secondsf>(duration).count());
-            } else if (duration >= abc::chrono::milliseconds(1)) {
-                return abc::format("{} ms", std::chrono::duration_cast<abc::chrono::millisecondsf>(duration).count());
-            } else {
-                return abc::format("{} us", std::chrono::duration_cast<abc::chrono::microsecondsf>(duration).count());
+        void record(duration::rep elapsed)
+        {
+            accum.store(accum.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+            if (elapsed < min.load(std::memory_order_relaxed)) {
+                min.store(elapsed, std::memory_order_relaxed);
+            }
+            if (elapsed > max.load(std::memory_order_relaxed)) {
+                max.store(elapsed, std::memory_order_relaxed);
             }
+            samples.store(samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    };
+
+    ///@brief: node of a thread's call tree, one per distinct path of ABC_PROFILE_SCOPE tags. Nodes are
+    ///        published with release stores once initialized, summaries walk the tree while it grows.
+    struct call_node {
+        static constexpr uint32_t k_none = std::numeric_limits<uint32_t>::max();
+
+        tag_id                     tag    = 0;
+        uint32_t                   parent = k_none;
+        std::atomic<uint32_t>      firstChild{k_none};
+        std::atomic<uint32_t>      nextSibling{k_none};
+        std::atomic<duration::rep> inclusive{0};
+        std::atomic<duration::rep> children{0};   // inclusive time of the child scopes
+        std::atomic<uint64_t>      calls{0};
+        std::atomic<uint64_t>      sampled{0};   // sampler hits while the scope was the innermost one
+        std::atomic<uint64_t>      allocations{0};   // made while the scope was the innermost one
+        std::atomic<uint64_t>      allocatedBytes{0};
+        std::atomic<uint64_t>      deallocations{0};
+    };
+
+    struct sampler_thread;   // platform state of the sampler, see start_sampling
+    struct publisher;        // shared memory export, see start_publishing
+
+    ///@brief: bounded timeline of a thread's zones, the oldest events are overwritten. Only the owner
+    ///        pushes; every slot is a small seqlock so exports copy events while the ring is written.
+    class trace_ring {
+    public:
+        trace_ring(size_t capacity, uint32_t threadIndex);
+
+        void push(tag_id id, time_point begin, time_point end, uint64_t allocations = 0, uint64_t bytes = 0)
+        {
+            const uint64_t head = m_head.load(std::memory_order_relaxed);
+            event&         slot = m_events[head & m_mask];
+            slot.sequence.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.tag.store(id, std::memory_order_relaxed);
+            slot.begin.store(begin.time_since_epoch().count(), std::memory_order_relaxed);
+            slot.end.store(end.time_since_epoch().count(), std::memory_order_relaxed);
+            slot.allocations.store(allocations, std::memory_order_relaxed);
+            slot.bytes.store(bytes, std::memory_order_relaxed);
+            slot.sequence.store(head + 1, std::memory_order_release);
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        ///@brief: calls func(tag, begin, end, allocations, bytes) for the events still in the ring, oldest first
+        template <typename Func> void for_each(Func&& func) const
+        {
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            for (uint64_t i = head > m_events.size() ? head - m_events.size() : 0; i < head; ++i) {
+                const event&   slot     = m_events[i & m_mask];
+                const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+                const tag_id   id       = slot.tag.load(std::memory_order_relaxed);
+                const auto     begin    = slot.begin.load(std::memory_order_relaxed);
+                const auto     end      = slot.end.load(std::memory_order_relaxed);
+                const uint64_t count    = slot.allocations.load(std::memory_order_relaxed);
+                const uint64_t bytes    = slot.bytes.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence == i + 1 && slot.sequence.load(std::memory_order_relaxed) == sequence) {
+                    func(id, time_point(duration(begin)), time_point(duration(end)), count, bytes);
+                }
+            }
+        }
+
+        uint32_t get_thread_index() const { return m_threadIndex; }
+
+    private:
+        struct event {
+            std::atomic<uint64_t>      sequence{0};   // index + 1 once written, 0 while being written
+            std::atomic<tag_id>        tag{0};
+            std::atomic<duration::rep> begin{0};
+            std::atomic<duration::rep> end{0};
+            std::atomic<uint64_t>      allocations{0};   // made during the zone
+            std::atomic<uint64_t>      bytes{0};
         };
 
-        const auto processSample = [&timeUnitsFunc](const ProfilingData& data) {
-            if (data.samples <= 0) {
-                return;
+        std::vector<event>    m_events;
+        uint64_t              m_mask;
+        std::atomic<uint64_t> m_head{0};
+        uint32_t              m_threadIndex;
+    };
+
+    ///@brief: per-thread samples, created on the first tick of a thread and merged into the profiler when
+    ///        the thread exits. Tags are stored in chunks allocated on demand, the hot path never locks.
+    class thread_samples {
+    public:
+        static constexpr size_t k_chunkSize     = 256;
+        static constexpr size_t k_maxChunks     = 256;    // up to 65536 tags
+        static constexpr size_t k_nodeChunkSize = 1024;   // the first chunk is allocated with the thread samples
+        static constexpr size_t k_maxNodeChunks = 64;
+
+        explicit thread_samples(uint32_t threadIndex);
+        ~thread_samples();
+        thread_samples(const thread_samples&)            = delete;
+        thread_samples& operator=(const thread_samples&) = delete;
+
+        tag_stats& get(tag_id id)
+        {
+            ABC_ASSERT(id / k_chunkSize < k_maxChunks);
+            tag_stats* chunk = m_chunks[id / k_chunkSize].load(std::memory_order_relaxed);
+            if (chunk == nullptr) {
+                chunk = allocate_chunk(id / k_chunkSize);
             }
+            return chunk[id % k_chunkSize];
+        }
+        ///@return nullptr when the thread never used the tag, callable from any thread
+        const tag_stats* find(tag_id id) const
+        {
+            const tag_stats* chunk = id / k_chunkSize < k_maxChunks
+                ? m_chunks[id / k_chunkSize].load(std::memory_order_acquire)
+                : nullptr;
+            return chunk != nullptr ? &chunk[id % k_chunkSize] : nullptr;
+        }
 
-            const auto avgTime = data.accumDuration / data.samples;
-            if (data.samples > 1) {
-                if (data.mt_lockedTime > ProfilingData::duration(0)) {
-                    const auto lockedTime = data.mt_lockedTime / data.samples;
-                    const auto avgTimeMT  = avgTime - lockedTime;
-
-                    std::cout << abc::format("{} : avg({})lckd({}) min/max({}/{})#[{}]", data.tag,
-                        timeUnitsFunc(avgTimeMT), timeUnitsFunc(lockedTime), timeUnitsFunc(data.minDuration),
-                        timeUnitsFunc(data.maxDuration), data.samples)
-                              << std::endl;
-                } else {
-                    std::cout << abc::format("{} : avg({}) min/max({}/{})#[{}]", data.tag, timeUnitsFunc(avgTime),
-                        timeUnitsFunc(data.minDuration), timeUnitsFunc(data.maxDuration), data.samples)
-                              << std::endl;
-                }
-            } else {
-                if (data.mt_lockedTime > ProfilingData::duration(0)) {
-                    const auto& lockedTime = data.mt_lockedTime;
-                    const auto  avgTimeMT  = avgTime - lockedTime;
-                    std::cout << abc::format(
-                        "{} : {} (locked: {})", data.tag, timeUnitsFunc(avgTimeMT), timeUnitsFunc(lockedTime))
-                              << std::endl;
-                } else {
-                    std::cout << abc::format("{} : {}", data.tag, timeUnitsFunc(avgTime)) << std::endl;
+        ///@brief: owner only
+        void reset(tag_id id);
+        ///@brief: owner only, clears the child of the current scope for tag as if it was never entered
+        void reset_child(tag_id id);
+
+        ///@brief: descends into the child of the current scope for tag, creating it on the first call
+        ///@return the entered node, call_node::k_none once the node pools are exhausted
+        uint32_t enter(tag_id id)
+        {
+            const uint32_t current = m_current.load(std::memory_order_relaxed);
+            for (uint32_t child = node(current).firstChild.load(std::memory_order_relaxed);
+                 child != call_node::k_none; child = node(child).nextSibling.load(std::memory_order_relaxed)) {
+                if (node(child).tag == id) {
+                    m_current.store(child, std::memory_order_relaxed);
+                    return child;
                 }
             }
+            const uint32_t child = create_node(id);
+            if (child != call_node::k_none) {
+                m_current.store(child, std::memory_order_relaxed);
+            }
+            return child;
+        }
+        void leave(uint32_t index, duration::rep elapsed)
+        {
+            call_node& current = node(index);
+            add_relaxed(current.inclusive, elapsed);
+            add_relaxed(current.calls, 1);
+            add_relaxed(node(current.parent).children, elapsed);
+            m_current.store(current.parent, std::memory_order_relaxed);
+        }
+
+        ///@brief: called by the SIGPROF handler on the owner thread, async-signal-safe
+        void sample(void* signalContext);
+
+        sampler_thread* get_sampler() const { return m_sampler; }
+        void            set_sampler(sampler_thread* sampler) { m_sampler = sampler; }
+
+        ///@brief: owner only, keeps the profiler's own lazy allocations out of the counts
+        class internal_scope {
+        public:
+            explicit internal_scope(thread_samples& samples)
+                : m_samples(samples)
+                , m_internal(samples.m_internal)
+            {
+                samples.m_internal = true;
+            }
+            ~internal_scope() { m_samples.m_internal = m_internal; }
+            internal_scope(const internal_scope&)            = delete;
+            internal_scope& operator=(const internal_scope&) = delete;
+
+        private:
+            thread_samples& m_samples;
+            bool            m_internal;
         };
-        if (tagFilter.empty()) {
-            for (const auto& data : m_samples) {
-                processSample(data);
+
+        ///@brief: owner only, charged to the innermost scope
+        void allocated(size_t bytes)
+        {
+            if (m_internal) {
+                return;
             }
-        } else {
-            for (const auto& tag : tagFilter) {
-                auto it = std::find_if(
-                    m_samples.begin(), m_samples.end(), [&tag](const ProfilingData& data) { return data.tag == tag; });
-                if (it != m_samples.end()) {
-                    processSample(*it);
-                }
+            call_node& current = node(m_current.load(std::memory_order_relaxed));
+            add_relaxed(current.allocations, 1);
+            add_relaxed(current.allocatedBytes, bytes);
+            ++m_allocations.allocations;
+            m_allocations.bytes += bytes;
+        }
+        void deallocated()
+        {
+            if (m_internal) {
+                return;
+            }
+            add_relaxed(node(m_current.load(std::memory_order_relaxed)).deallocations, 1);
+            ++m_allocations.deallocations;
+        }
+        const allocation_counts& get_allocations() const { return m_allocations; }
+
+        ///@brief: owner only, profiler overhead the zones that ended so far added to their enclosing zones
+        duration::rep get_nested_overhead() const { return m_nestedOverhead; }
+        void          add_nested_overhead(duration::rep overhead) { m_nestedOverhead += overhead; }
+
+        ///@brief: owner only, the counters are opened on the first call
+        ///@return nullptr when perf events are not available
+        const perf_counter_group* get_perf_counters()
+        {
+            if (!m_perfCountersOpened) {
+                m_perfCounters       = perf_counter_group::open();
+                m_perfCountersOpened = true;
             }
+            return m_perfCounters.get();
+        }
+
+        ///@brief: owner only, the ring is allocated by the first event traced on the thread
+        trace_ring& get_trace(size_t capacity)
+        {
+            trace_ring* trace = m_trace.load(std::memory_order_relaxed);
+            return trace != nullptr ? *trace : allocate_trace(capacity);
+        }
+        ///@return nullptr when the thread never traced, callable from any thread under the profiler mutex
+        std::shared_ptr<const trace_ring> share_trace() const
+        {
+            // m_traceOwner is set before m_trace is published and only reset by release_trace
+            return m_trace.load(std::memory_order_acquire) != nullptr ? m_traceOwner : nullptr;
+        }
+        ///@brief: under the profiler mutex
+        std::shared_ptr<trace_ring> release_trace()
+        {
+            m_trace.store(nullptr, std::memory_order_release);
+            return std::move(m_traceOwner);
+        }
+
+        ///@brief: owner only, ids of the tags the thread passed by name, see profiler::resolve_tag
+        std::unordered_map<abc::string, tag_id>& get_tag_cache() { return m_tagCache; }
+
+        ///@brief: callable from any thread for the nodes reachable from the root (index 0)
+        const call_node& node(uint32_t index) const
+        {
+            return m_nodes[index / k_nodeChunkSize].load(std::memory_order_acquire)[index % k_nodeChunkSize];
+        }
+
+    private:
+        template <typename T, typename U> static void add_relaxed(std::atomic<T>& value, U delta)
+        {
+            value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+        call_node& node(uint32_t index)
+        {
+            return m_nodes[index / k_nodeChunkSize].load(std::memory_order_relaxed)[index % k_nodeChunkSize];
         }
-        std::cout << "-----------------------------------------------------------------" << std::endl;
+
+        tag_stats*  allocate_chunk(size_t index);
+        uint32_t    create_node(tag_id id);
+        trace_ring& allocate_trace(size_t capacity);
+
+        std::atomic<tag_stats*>  m_chunks[k_maxChunks]    = {};
+        std::atomic<call_node*>  m_nodes[k_maxNodeChunks] = {};
+        uint32_t                 m_nodeCount              = 1;   // the root
+        std::atomic<uint32_t>    m_current{0};   // atomic for the sampler's signal handler
+        std::atomic<trace_ring*> m_trace{nullptr};   // m_traceOwner, read by the owner without touching the count
+        uint32_t                 m_threadIndex;
+        sampler_thread*          m_sampler = nullptr;
+        allocation_counts        m_allocations;
+        duration::rep            m_nestedOverhead = 0;
+        bool                     m_internal       = false;
+
+        std::unique_ptr<perf_counter_group> m_perfCounters;
+        bool                                m_perfCountersOpened = false;
+
+        std::unordered_map<abc::string, tag_id> m_tagCache;
+        std::shared_ptr<trace_ring>             m_traceOwner;   // shared with the trace exports
+    };
+
+    static profiler& GetInstance()
+    {
+        static profiler theInstance;
+        return theInstance;
     }
 
-    void declare(const abc::string& tag, bool reset = false)
+    ~profiler();
+
+    ///@brief: own cost of the profiler, measured by calibrate
+    struct overhead {
+        duration zone        = duration(0);   // tick/tock: measured by the zone itself, between its clock reads
+        duration zoneNested  = duration(0);   // tick/tock: added to the enclosing zones, from tick to tock
+        duration scope       = duration(0);   // same for ABC_PROFILE_SCOPE
+        duration scopeNested = duration(0);
+    };
+
+    ///@brief: calibrates the overhead, see ABC_PROFILE_INIT
+    void initialize(bool compensateOverhead = false)
     {
-        auto it = std::find_if(
-            m_samples.begin(), m_samples.end(), [&tag](const ProfilingData& data) { return data.tag == tag; });
-        if (it == m_samples.end()) {
-            m_samples.emplace_back(tag);
-        } else {
-            if (reset) {
-                m_samples.erase(it);
-            } else {
-                ABC_LOG_DEBUG("Call to profiler::declare({}) failed because the tag is already registered", tag);
-            }
+        calibrate();
+        set_overhead_compensation(compensateOverhead);
+    }
+
+    ///@brief: times empty zones on the calling thread, with the counters enabled at the time, and keeps the
+    ///        median. Summaries report it; tracing is paused meanwhile so the timelines do not show it.
+    void     calibrate();
+    overhead get_overhead() const;
+    ///@brief: subtracts the calibrated overhead from every zone that ends afterwards: its own part from the
+    ///        zone, the nested part of every zone it contains from its inclusive time. Exclusive times of the
+    ///        call tree and histograms follow. Timelines keep the measured times.
+    void set_overhead_compensation(bool enabled) { m_compensateOverhead.store(enabled, std::memory_order_relaxed); }
+
+    ///@return elapsed without the overhead of the zone (own) and of the zones it contained, when compensating
+    duration::rep compensate(duration::rep elapsed, duration::rep own, const thread_samples& samples,
+        duration::rep overhead0) const
+    {
+        if (!m_compensateOverhead.load(std::memory_order_relaxed)) {
+            return elapsed;
         }
+        const duration::rep compensated = elapsed - own - (samples.get_nested_overhead() - overhead0);
+        return compensated > 0 ? compensated : 0;
     }
 
-    void tick(const abc::string& tag) { internal_tick(tag); }
-    void tock(const abc::string& tag) { internal_tock(tag); }
+    void print_summary(const std::vector<abc::string>& tagFilter = std::vector<abc::string>());
 
-    void tick_mt(const abc::string& tag)
+    ///@brief: resolves a tag to a dense id, the ABC_PROFILE_* macros do it once per call site
+    tag_id register_tag(const abc::string& tag);
+    tag_id register_tag(const char* tag);
+    ///@brief: register_tag through a cache of the calling thread, tags passed by name only lock the first time
+    tag_id resolve_tag(const abc::string& tag)
     {
-        abc::chrono::timer          timer;
-        std::lock_guard<std::mutex> mutexLock(m_mutex);
-        auto                        lockedDuration = timer.get_elapsed_time();
+        thread_samples& samples = get_thread_samples();
+        const auto      it      = samples.get_tag_cache().find(tag);
+        return it != samples.get_tag_cache().end() ? it->second : cache_tag(samples, tag);
+    }
 
-        auto it = internal_tick(tag);
+    ///@brief: registers tag, or with reset clears what every thread recorded for it so far. Running threads
+    ///        clear their own statistics on their next record of the tag, summaries skip them until then.
+    void declare(const abc::string& tag, bool reset = false);
 
-        ABC_ASSERT(it != m_samples.end());
-        if (it != m_samples.end()) {   // accumulate locked duration
-            it->mt_lockedTime += lockedDuration;
+    ///@brief: keeps a latency histogram of the tag, summaries then report its percentiles
+    void enable_histogram(tag_id id)
+    {
+        ABC_ASSERT(id < k_maxTags);
+        m_histogramTags[id].store(true, std::memory_order_relaxed);
+    }
+    ///@brief: merged histogram of every thread
+    ///@return false when the tag has no histogram
+    bool get_histogram(const abc::string& tag, log_linear_histogram& histogram);
+
+    ///@brief: keeps the last 60 seconds of the tag in one second slots, summaries then report its rate and
+    ///        percentiles over the last 1s/10s/60s. Slots are recycled by the recording thread, no timer runs.
+    void enable_window(tag_id id)
+    {
+        ABC_ASSERT(id < k_maxTags);
+        m_windowTags[id].store(true, std::memory_order_relaxed);
+    }
+    ///@brief: latencies in nanoseconds of every thread over the last complete seconds (up to 60)
+    ///@return false when the tag has no window
+    bool get_window(const abc::string& tag, std::chrono::seconds seconds, rolling_window::stats& stats);
+    ///@return the second of the profiler clock windows are stamped with
+    static uint64_t get_window_second(time_point now)
+    {
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+        return seconds > 0 ? static_cast<uint64_t>(seconds) : 0;
+    }
+
+    ///@brief: owner only, the stats of the tag in the thread, cleared first when declare reset the tag since
+    tag_stats& get_current(thread_samples& samples, tag_id id)
+    {
+        tag_stats&     stats      = samples.get(id);
+        const uint32_t generation = m_resetGenerations[id].load(std::memory_order_acquire);
+        if (stats.generation.load(std::memory_order_relaxed) != generation) {
+            samples.reset(id);
+            stats.generation.store(generation, std::memory_order_release);
         }
+        return stats;
+    }
+    ///@return true when stats were recorded since the last reset of the tag, callable from any thread
+    bool is_current(const tag_stats& stats, tag_id id) const
+    {
+        return stats.generation.load(std::memory_order_acquire)
+            == m_resetGenerations[id].load(std::memory_order_relaxed);
     }
-    void tock_mt(const abc::string& tag)
+
+    void record(tag_id id, tag_stats& stats, duration::rep elapsed, time_point end)
     {
-        abc::chrono::timer          timer;
-        std::lock_guard<std::mutex> mutexLock(m_mutex);
-        auto                        lockedDuration = timer.get_elapsed_time();
+        stats.record(elapsed);
+        log_linear_histogram* histogram = stats.histogram.load(std::memory_order_relaxed);
+        if (histogram == nullptr && m_histogramTags[id].load(std::memory_order_relaxed)) {
+            histogram = new log_linear_histogram();
+            stats.histogram.store(histogram, std::memory_order_release);
+        }
+        rolling_window* window = stats.window.load(std::memory_order_relaxed);
+        if (window == nullptr && m_windowTags[id].load(std::memory_order_relaxed)) {
+            window = new rolling_window();
+            stats.window.store(window, std::memory_order_release);
+        }
+        if (histogram != nullptr || window != nullptr) {
+            const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration(elapsed)).count();
+            const auto value       = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : uint64_t(0);
+            if (histogram != nullptr) {
+                histogram->record(value);
+            }
+            if (window != nullptr) {
+                window->record(get_window_second(end), value);
+            }
+        }
+    }
+
+    ///@brief: counts cycles, instructions, cache and branch misses of every zone with perf events (Linux),
+    ///        summaries then report them per call
+    ///@return false when the calling thread cannot open the counters, they then stay disabled
+    bool enable_counters();
+    void disable_counters() { m_countersEnabled.store(false, std::memory_order_relaxed); }
 
-        auto it = internal_tock(tag);
+    ///@return nullptr when counters are disabled or not available on the thread
+    const perf_counter_group* get_counters(thread_samples& samples)
+    {
+        return m_countersEnabled.load(std::memory_order_relaxed) ? samples.get_perf_counters() : nullptr;
+    }
+    static void add_counters(
+        tag_stats& stats, const perf_counter_group::values& begin, const perf_counter_group::values& end);
 
-        ABC_ASSERT(it != m_samples.end());
-        if (it != m_samples.end()) {   // accumulate locked duration
-            it->mt_lockedTime += lockedDuration;
+    ///@brief: called by the operator new and delete of ABC_PROFILE_ALLOCATION_HOOKS, threads that never
+    ///        profiled are not counted
+    static void on_allocation(size_t bytes)
+    {
+        thread_samples* samples = profiler_tls<thread_samples>::value;
+        if (samples != nullptr) {
+            samples->allocated(bytes);
+        }
+    }
+    static void on_deallocation()
+    {
+        thread_samples* samples = profiler_tls<thread_samples>::value;
+        if (samples != nullptr) {
+            samples->deallocated();
         }
     }
+    static allocation_counts add_allocations(
+        tag_stats& stats, const allocation_counts& begin, const allocation_counts& end)
+    {
+        const allocation_counts delta = {
+            end.allocations - begin.allocations, end.bytes - begin.bytes, end.deallocations - begin.deallocations};
+        stats.allocations.store(stats.allocations.load(std::memory_order_relaxed) + delta.allocations,
+            std::memory_order_relaxed);
+        stats.allocatedBytes.store(
+            stats.allocatedBytes.load(std::memory_order_relaxed) + delta.bytes, std::memory_order_relaxed);
+        stats.deallocations.store(stats.deallocations.load(std::memory_order_relaxed) + delta.deallocations,
+            std::memory_order_relaxed);
+        return delta;
+    }
 
-protected:
-    sample_container_iterator_t internal_tick(const abc::string& tag)
+    void tick(tag_id id)
+    {
+        thread_samples&                      samples = get_thread_samples();
+        const thread_samples::internal_scope internal(samples);
+        tag_stats&                           stats = samples.get(id);
+        ABC_ASSERT(stats.t0 == time_point(), "Call to PROFILE_BEGIN without PROFILE_END.");
+        const perf_counter_group* counters = get_counters(samples);
+        if (counters != nullptr) {
+            counter_stats* counterStats = stats.counters.load(std::memory_order_relaxed);
+            if (counterStats == nullptr) {
+                counterStats = new counter_stats();
+                stats.counters.store(counterStats, std::memory_order_release);
+            }
+            counterStats->started = counters->read(counterStats->start);
+        }
+        stats.allocations0 = samples.get_allocations();
+        stats.overhead0    = samples.get_nested_overhead();
+        stats.t0           = clock::now();
+    }
+    void tock(tag_id id)
     {
-        sample_container_iterator_t it = std::find_if(
-            m_samples.begin(), m_samples.end(), [&tag](const ProfilingData& data) { return data.tag == tag; });
-        if (it != m_samples.end()) {
-            ABC_ASSERT(it->t0 == abc::chrono::timer::time_point_t(), "Call to PROFILE_BEGIN without PROFILE_END.");
-            it->t0 = abc::chrono::timer::now();
+        const time_point                     now     = clock::now();
+        thread_samples&                      samples = get_thread_samples();
+        const thread_samples::internal_scope internal(samples);
+        tag_stats&                           stats = get_current(samples, id);
+        if (stats.t0 != time_point()) {
+            const perf_counter_group*  counters     = get_counters(samples);
+            counter_stats*             counterStats = stats.counters.load(std::memory_order_relaxed);
+            perf_counter_group::values end;
+            if (counters != nullptr && counterStats != nullptr && counterStats->started && counters->read(end)) {
+                add_counters(stats, counterStats->start, end);
+            }
+            if (counterStats != nullptr) {
+                counterStats->started = false;
+            }
+            const allocation_counts allocations = add_allocations(stats, stats.allocations0, samples.get_allocations());
+            const duration::rep     elapsed     = compensate(
+                (now - stats.t0).count(), m_zoneOverhead.load(std::memory_order_relaxed), samples, stats.overhead0);
+            record(id, stats, elapsed, now);
+            trace(samples, id, stats.t0, now, allocations);
+            samples.add_nested_overhead(m_zoneNestedOverhead.load(std::memory_order_relaxed));
+            stats.t0 = time_point();
         } else {
-            m_samples.emplace_back(tag, abc::chrono::timer::now());
+            ABC_FAIL("Call to PROFILE_END without PROFILE_BEGIN.");
         }
+    }
+    void tick(const abc::string& tag) { tick(resolve_tag(tag)); }
+    void tock(const abc::string& tag) { tock(resolve_tag(tag)); }
+
+    // samples are per thread, the _mt variants are kept for existing call sites
+    void tick_mt(tag_id id) { tick(id); }
+    void tock_mt(tag_id id) { tock(id); }
+    void tick_mt(const abc::string& tag) { tick(resolve_tag(tag)); }
+    void tock_mt(const abc::string& tag) { tock(resolve_tag(tag)); }
 
-        return it;
+    ///@brief: charges time spent waiting on a mutex to a tag, see ABC_PROFILE_LOCK_GUARD
+    void add_locked_time(tag_id id, duration lockedDuration)
+    {
+        tag_stats& stats = get_current(get_thread_samples(), id);
+        stats.locked.store(
+            stats.locked.load(std::memory_order_relaxed) + lockedDuration.count(), std::memory_order_relaxed);
+        stats.locks.store(stats.locks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     }
 
-    sample_container_iterator_t internal_tock(const abc::string& tag)
+    ///@brief: starts recording every zone end into bounded per-thread timelines, see write_trace. The timelines
+    ///        of the last exitedThreads threads that exited are kept, older ones are freed.
+    void start_tracing(size_t eventsPerThread = 1 << 16, size_t exitedThreads = 64)
     {
-        sample_container_iterator_t it = std::find_if(
-            m_samples.begin(), m_samples.end(), [&tag](const ProfilingData& data) { return data.tag == tag; });
-        if (it != m_samples.end()) {
-            ABC_ASSERT(it->t0 != abc::chrono::timer::time_point_t(), "Call to PROFILE_END without PROFILE_BEGIN.");
-            const abc::chrono::duration elapsedTime = abc::chrono::timer::now() - it->t0;
-            it->minDuration                         = (it->minDuration < elapsedTime) ? it->minDuration : elapsedTime;
-            it->maxDuration                         = (it->maxDuration > elapsedTime) ? it->maxDuration : elapsedTime;
-            it->accumDuration += elapsedTime;
-            it->t0 = abc::chrono::timer::time_point_t();
-            ++(it->samples);
-        } else {
-            ABC_FAIL("Call to PROFILE_END without PROFILE_BEGIN.");
+        m_traceExitedThreads.store(exitedThreads, std::memory_order_relaxed);
+        m_traceCapacity.store(eventsPerThread, std::memory_order_relaxed);
+    }
+    ///@brief: recorded events are kept until written
+    void stop_tracing() { m_traceCapacity.store(0, std::memory_order_relaxed); }
+
+    void trace(thread_samples& samples, tag_id id, time_point begin, time_point end)
+    {
+        trace(samples, id, begin, end, allocation_counts());
+    }
+    void trace(
+        thread_samples& samples, tag_id id, time_point begin, time_point end, const allocation_counts& allocations)
+    {
+        const size_t capacity = m_traceCapacity.load(std::memory_order_relaxed);
+        if (capacity != 0) {
+            samples.get_trace(capacity).push(id, begin, end, allocations.allocations, allocations.bytes);
         }
+    }
 
-        return it;
+    ///@brief: samples every profiled thread on its own CPU time (timer_create + SIGPROF, Linux only).
+    ///        Each sample counts the innermost ABC_PROFILE_SCOPE of the thread and, with backtraces, keeps
+    ///        a frame pointer backtrace (code built with -fno-omit-frame-pointer) in a ring of 1024 per thread.
+    ///        The rings are folded by every summary, publish and write_folded_stacks, by stop_sampling and
+    ///        when the thread exits; backtraces overwritten before are counted by get_dropped_backtraces.
+    ///@return false when sampling is not supported or the signal handler could not be installed
+    bool start_sampling(unsigned frequencyHz = 99, bool backtraces = false);
+    void stop_sampling();
+    ///@brief: writes the samples as folded stacks ("zone;zone;function count" lines) for flamegraph.pl,
+    ///        speedscope or inferno, zones first and then the backtrace from the outermost frame. Dropped
+    ///        backtraces are written as a "[dropped backtraces]" stack.
+    bool write_folded_stacks(const abc::string& path);
+    ///@return backtraces lost since sampling started because their ring wrapped between two folds
+    uint64_t get_dropped_backtraces();
+
+    ///@brief: publishes the aggregates of every tag into the shared memory segment name (shm_open, POSIX only,
+    ///        "/abc_profiler_<pid>" when empty) every interval from a background thread, for abc_top. It only
+    ///        reads the relaxed atomics of the running threads, which are never paused.
+    ///@return false when the segment could not be created
+    bool start_publishing(
+        const abc::string& name = abc::string(), std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    ///@brief: publishes a last time and removes the segment
+    void stop_publishing();
+
+    ///@brief: writes the recorded timelines to path in the Chrome trace_event JSON format, which
+    ///        chrome://tracing and ui.perfetto.dev open. The file is streamed from the rings without copying
+    ///        them, threads keep recording and registering meanwhile.
+    ///@return false when the file could not be written
+    bool write_trace(const abc::string& path);
+
+    static thread_samples& get_thread_samples()
+    {
+        thread_samples* samples = profiler_tls<thread_samples>::value;
+        return samples != nullptr ? *samples : create_thread_samples();
     }
 
+protected:
+    static thread_samples& create_thread_samples();
+    tag_id                 cache_tag(thread_samples& samples, const abc::string& tag);
+    void                   release_thread_samples(thread_samples* samples);
+
+    // implemented with the platform code of the sampler, called under m_mutex
+    void attach_sampler(thread_samples& samples);
+    void detach_sampler(thread_samples& samples);   // folds the thread's backtraces first
+    void fold_backtraces(const thread_samples& samples);   // only the backtraces pushed since the last fold
+    const abc::string& get_cached_symbol_name(uintptr_t address, bool returnAddress);
+    friend struct thread_samples_holder;
+    friend class profile_scope;   // reads the scope overhead
+
+    ///@brief: merged samples of exited threads plus a snapshot of the running ones
+    sample_container_t collect();
+
+    struct call_tree {
+        tag_id                 tag       = 0;
+        duration               inclusive = duration(0);
+        duration               children  = duration(0);
+        uint64_t               calls     = 0;
+        uint64_t               sampled   = 0;
+        allocation_counts      allocations;   // while the scope was the innermost one
+        std::vector<call_tree> nodes;
+    };
+    static void merge_call_tree(call_tree& tree, const thread_samples& samples, uint32_t index);
+    ///@brief: same as collect for the call trees
+    call_tree collect_call_tree();
+    void      print_call_tree(const call_tree& tree, const sample_container_t& samples, size_t depth) const;
+    void      fold_call_tree(const call_tree& tree, const abc::string& prefix,
+             std::unordered_map<abc::string, uint64_t>& folded) const;   // under m_mutex
+
+    tag_id internal_register(const abc::string& tag);
+
 protected:
     std::mutex m_mutex;
 
     struct ProfilingData {
-        using duration   = abc::chrono::timer::duration_t;
-        using time_point = abc::chrono::timer::time_point_t;
-
         ProfilingData(const abc::string& i_tag)
             : tag(i_tag)
         {
         }
-        ProfilingData(const abc::string& i_tag, const time_point& i_t0)
-            : tag(i_tag)
-            , t0(i_t0)
-        {
-        }
+        ProfilingData(const ProfilingData& other);
+        ProfilingData& operator=(const ProfilingData& other);
+
+        void merge(const tag_stats& stats);
 
         abc::string tag;
-        time_point  t0;
         duration    accumDuration = duration(0);
         duration    minDuration   = duration(std::numeric_limits<duration::rep>::max());
         duration    maxDuration   = duration(0);
         size_t      samples       = 0;
 
         duration mt_lockedTime = duration(0);
+        size_t   locks         = 0;
+
+        std::unique_ptr<log_linear_histogram> histogram;
+        uint64_t                              counters[k_perfCounterCount] = {};
+        uint64_t                              counterSamples               = 0;
+        allocation_counts                     allocations;
+        std::unique_ptr<rolling_window>       window;
     };
-    sample_container_t m_samples;
+    sample_container_t                        m_samples;            // exited threads
+    call_tree                                 m_callTree;           // exited threads
+    std::deque<std::shared_ptr<trace_ring>>   m_traces;             // exited threads, oldest first
+    std::unordered_map<abc::string, uint64_t> m_foldedBacktraces;   // every thread, up to their last fold
+    std::unordered_map<uintptr_t, abc::string> m_symbolNames;       // see get_cached_symbol_name
+    uint64_t                                  m_droppedBacktraces = 0;
+    std::unordered_map<abc::string, tag_id>   m_tagIds;             // only used to register call sites
+    std::vector<thread_samples*>              m_threads;            // running threads
+    uint32_t                                  m_threadCount = 0;
+    std::atomic<size_t>                       m_traceCapacity{0};
+    std::atomic<size_t>                       m_traceExitedThreads{64};
+    std::atomic<bool>                         m_countersEnabled{false};
+    unsigned                                  m_samplingHz         = 0;   // 0 when not sampling
+    bool                                      m_samplingBacktraces = false;
+    publisher*                                m_publisher = nullptr;
+    // see calibrate, in clock ticks for the hot path
+    std::atomic<duration::rep> m_zoneOverhead{0};
+    std::atomic<duration::rep> m_zoneNestedOverhead{0};
+    std::atomic<duration::rep> m_scopeOverhead{0};
+    std::atomic<duration::rep> m_scopeNestedOverhead{0};
+    std::atomic<bool>          m_compensateOverhead{false};
+
+    static constexpr size_t k_maxTags = thread_samples::k_chunkSize * thread_samples::k_maxChunks;
+    std::atomic<bool>       m_histogramTags[k_maxTags]    = {};
+    std::atomic<bool>       m_windowTags[k_maxTags]       = {};
+    std::atomic<uint32_t>   m_resetGenerations[k_maxTags] = {};   // bumped by declare(tag, true)
+};
+
+///@brief: locks a mutex and charges the wait to a tag, for code that wants to see its own contention
+template <typename Mutex> class profiled_lock_guard {
+public:
+    profiled_lock_guard(profiler::tag_id id, Mutex& mutex)
+        : m_mutex(mutex)
+    {
+        const profiler::time_point start = profiler::clock::now();
+        m_mutex.lock();
+        profiler::GetInstance().add_locked_time(id, profiler::clock::now() - start);
+    }
+    ~profiled_lock_guard() { m_mutex.unlock(); }
+    profiled_lock_guard(const profiled_lock_guard&)            = delete;
+    profiled_lock_guard& operator=(const profiled_lock_guard&) = delete;
+
+private:
+    Mutex& m_mutex;
+};
+
+///@brief: times a scope as a node of the thread's call tree, see ABC_PROFILE_SCOPE
+class profile_scope {
+public:
+    explicit profile_scope(profiler::tag_id id)
+        : m_samples(profiler::get_thread_samples())
+        , m_id(id)
+    {
+        {
+            const profiler::thread_samples::internal_scope internal(m_samples);
+            m_node     = m_samples.enter(id);
+            m_counters = profiler::GetInstance().get_counters(m_samples);
+            if (m_counters != nullptr && !m_counters->read(m_startCounters)) {
+                m_counters = nullptr;
+            }
+        }
+        m_startAllocations = m_samples.get_allocations();
+        m_startOverhead    = m_samples.get_nested_overhead();
+        m_start            = profiler::clock::now();
+    }
+    ~profile_scope()
+    {
+        const profiler::time_point                     now = profiler::clock::now();
+        const profiler::thread_samples::internal_scope internal(m_samples);
+        profiler&                                      instance = profiler::GetInstance();
+        const profiler::duration::rep                  elapsed  = instance.compensate((now - m_start).count(),
+            instance.m_scopeOverhead.load(std::memory_order_relaxed), m_samples, m_startOverhead);
+        profiler::tag_stats&                           stats    = instance.get_current(m_samples, m_id);
+        perf_counter_group::values                     endCounters;
+        if (m_counters != nullptr && m_counters->read(endCounters)) {
+            profiler::add_counters(stats, m_startCounters, endCounters);
+        }
+        const profiler::allocation_counts allocations =
+            profiler::add_allocations(stats, m_startAllocations, m_samples.get_allocations());
+        instance.record(m_id, stats, elapsed, now);
+        instance.trace(m_samples, m_id, m_start, now, allocations);
+        if (m_node != profiler::call_node::k_none) {
+            m_samples.leave(m_node, elapsed);
+        }
+        m_samples.add_nested_overhead(instance.m_scopeNestedOverhead.load(std::memory_order_relaxed));
+    }
+    profile_scope(const profile_scope&)            = delete;
+    profile_scope& operator=(const profile_scope&) = delete;
+
+private:
+    profiler::thread_samples&   m_samples;
+    profiler::tag_id            m_id;
+    uint32_t                    m_node     = profiler::call_node::k_none;
+    const perf_counter_group*   m_counters = nullptr;
+    perf_counter_group::values  m_startCounters;
+    profiler::allocation_counts m_startAllocations;
+    profiler::duration::rep     m_startOverhead = 0;
+    profiler::time_point        m_start;
 };
 
+///@brief: allocation functions of ABC_PROFILE_ALLOCATION_HOOKS
+inline void*
+profiled_allocate(std::size_t size, bool nothrow)
+{
+    for (;;) {
+        void* pointer = std::malloc(size != 0 ? size : 1);
+        if (pointer != nullptr) {
+            profiler::on_allocation(size);
+            return pointer;
+        }
+        if (nothrow) {
+            return nullptr;   // new handlers may throw
+        }
+        const std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+            throw std::bad_alloc();
+#else
+            std::abort();
+#endif
+        }
+        handler();
+    }
+}
+inline void
+profiled_free(void* pointer)
+{
+    if (pointer != nullptr) {
+        profiler::on_deallocation();
+        std::free(pointer);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }   // namespace detail
 }   // namespace abc
 
 ///////////////////////////////////////////////////////////////////////////////
-#define ABC_PROFILE_INIT() abc::detail::profiler::GetInstance().initialize()
+#define ABC_PROFILE_CONCAT_IMPL2(A, B) A##B
+#define ABC_PROFILE_CONCAT_IMPL(A, B)  ABC_PROFILE_CONCAT_IMPL2(A, B)
+// every call site resolves its tag once, ticks and tocks then index the samples directly
+#define ABC_PROFILE_TAG_ID_IMPL(TAG)                              \
+    static const abc::detail::profiler::tag_id abc_profileTagId = \
+        abc::detail::profiler::GetInstance().register_tag(#TAG)
+///////////////////////////////////////////////////////////////////////////////
+///@brief: calibrates the profiler's own overhead per zone, ABC_PROFILE_INIT(true) also subtracts it from the zones
+#define ABC_PROFILE_INIT(...) abc::detail::profiler::GetInstance().initialize(__VA_ARGS__)
 ///////////////////////////////////////////////////////////////////////////////
-#define ABC_PROFILE_SECTION(TAG, CODE_BLOCK)             \
-    do {                                                 \
-        abc::detail::profiler::GetInstance().tick(#TAG); \
-        sizeof(#CODE_BLOCK);                             \
-        {CODE_BLOCK};                                    \
-        abc::detail::profiler::GetInstance().tock(#TAG); \
+#define ABC_PROFILE_SECTION(TAG, CODE_BLOCK)                         \
+    do {                                                             \
+        ABC_PROFILE_TAG_ID_IMPL(TAG);                                \
+        abc::detail::profiler::GetInstance().tick(abc_profileTagId); \
+        sizeof(#CODE_BLOCK);                                         \
+        {CODE_BLOCK};                                                \
+        abc::detail::profiler::GetInstance().tock(abc_profileTagId); \
     } while (false)
 ///////////////////////////////////////////////////////////////////////////////
+///@brief: profiles the rest of the scope, nested scopes are summarized as a call tree with inclusive and
+///        exclusive times
+#define ABC_PROFILE_SCOPE(TAG)                                                                            \
+    static const abc::detail::profiler::tag_id ABC_PROFILE_CONCAT_IMPL(abc_profileScopeTagId, __LINE__) = \
+        abc::detail::profiler::GetInstance().register_tag(#TAG);                                          \
+    const abc::detail::profile_scope ABC_PROFILE_CONCAT_IMPL(abc_profileScope, __LINE__)(                 \
+        ABC_PROFILE_CONCAT_IMPL(abc_profileScopeTagId, __LINE__))
+///////////////////////////////////////////////////////////////////////////////
 #define ABC_PROFILE_DECLARE(TAG)                            \
     do {                                                    \
         abc::detail::profiler::GetInstance().declare(#TAG); \
     } while (false)
 
-#define ABC_PROFILE_BEGIN(TAG)                           \
-    do {                                                 \
-        abc::detail::profiler::GetInstance().tick(#TAG); \
+///@brief: keeps a latency histogram for TAG, the summary reports its p50/p90/p99/p99.9/max
+#define ABC_PROFILE_HISTOGRAM(TAG)                                                  \
+    do {                                                                            \
+        abc::detail::profiler& abc_profiler = abc::detail::profiler::GetInstance(); \
+        abc_profiler.enable_histogram(abc_profiler.register_tag(#TAG));             \
     } while (false)
-#define ABC_PROFILE_END(TAG)                             \
-    do {                                                 \
-        abc::detail::profiler::GetInstance().tock(#TAG); \
+
+///@brief: keeps the last 60 seconds of TAG, the summary reports its rate and p99 over the last 1s/10s/60s
+#define ABC_PROFILE_WINDOW(TAG)                                                     \
+    do {                                                                            \
+        abc::detail::profiler& abc_profiler = abc::detail::profiler::GetInstance(); \
+        abc_profiler.enable_window(abc_profiler.register_tag(#TAG));                \
     } while (false)
 
-#define ABC_PROFILE_BEGIN_MT(TAG)                           \
-    do {                                                    \
-        abc::detail::profiler::GetInstance().tick_mt(#TAG); \
+///@brief: reports hardware counters per call next to the timings, see profiler::enable_counters
+#define ABC_PROFILE_COUNTERS() abc::detail::profiler::GetInstance().enable_counters()
+
+///@brief: replaces the global operator new and delete to count allocations, bytes and frees per zone. Expand it
+///        once, at global scope, in one source file of the program. Over-aligned allocations are not counted.
+#define ABC_PROFILE_ALLOCATION_HOOKS()                                                        \
+    void* operator new(std::size_t size)                                                      \
+    {                                                                                         \
+        return abc::detail::profiled_allocate(size, false);                                   \
+    }                                                                                         \
+    void* operator new[](std::size_t size)                                                    \
+    {                                                                                         \
+        return abc::detail::profiled_allocate(size, false);                                   \
+    }                                                                                         \
+    void* operator new(std::size_t size, const std::nothrow_t&) noexcept                      \
+    {                                                                                         \
+        return abc::detail::profiled_allocate(size, true);                                    \
+    }                                                                                         \
+    void* operator new[](std::size_t size, const std::nothrow_t&) noexcept                    \
+    {                                                                                         \
+        return abc::detail::profiled_allocate(size, true);                                    \
+    }                                                                                         \
+    void operator delete(void* pointer) noexcept { abc::detail::profiled_free(pointer); }     \
+    void operator delete[](void* pointer) noexcept { abc::detail::profiled_free(pointer); }   \
+    void operator delete(void* pointer, const std::nothrow_t&) noexcept                       \
+    {                                                                                         \
+        abc::detail::profiled_free(pointer);                                                  \
+    }                                                                                         \
+    void operator delete[](void* pointer, const std::nothrow_t&) noexcept                     \
+    {                                                                                         \
+        abc::detail::profiled_free(pointer);                                                  \
+    }                                                                                         \
+    void operator delete(void* pointer, std::size_t) noexcept                                 \
+    {                                                                                         \
+        abc::detail::profiled_free(pointer);                                                  \
+    }                                                                                         \
+    void operator delete[](void* pointer, std::size_t) noexcept                               \
+    {                                                                                         \
+        abc::detail::profiled_free(pointer);                                                  \
+    }
+
+#define ABC_PROFILE_BEGIN(TAG)                                       \
+    do {                                                             \
+        ABC_PROFILE_TAG_ID_IMPL(TAG);                                \
+        abc::detail::profiler::GetInstance().tick(abc_profileTagId); \
     } while (false)
-#define PROFILE_END_MT(TAG)                                 \
-    do {                                                    \
-        abc::detail::profiler::GetInstance().tock_mt(#TAG); \
+#define ABC_PROFILE_END(TAG)                                         \
+    do {                                                             \
+        ABC_PROFILE_TAG_ID_IMPL(TAG);                                \
+        abc::detail::profiler::GetInstance().tock(abc_profileTagId); \
+    } while (false)
+
+#define ABC_PROFILE_BEGIN_MT(TAG)                                       \
+    do {                                                                \
+        ABC_PROFILE_TAG_ID_IMPL(TAG);                                   \
+        abc::detail::profiler::GetInstance().tick_mt(abc_profileTagId); \
+    } while (false)
+#define ABC_PROFILE_END_MT(TAG)                                         \
+    do {                                                                \
+        ABC_PROFILE_TAG_ID_IMPL(TAG);                                   \
+        abc::detail::profiler::GetInstance().tock_mt(abc_profileTagId); \
+    } while (false)
+#define PROFILE_END_MT(TAG) ABC_PROFILE_END_MT(TAG)
+
+///@brief: locks MUTEX until the end of the scope, the time spent waiting for it is reported as TAG's locked time
+#define ABC_PROFILE_LOCK_GUARD(TAG, MUTEX)                                                               \
+    static const abc::detail::profiler::tag_id ABC_PROFILE_CONCAT_IMPL(abc_profileLockTagId, __LINE__) = \
+        abc::detail::profiler::GetInstance().register_tag(#TAG);                                         \
+    abc::detail::profiled_lock_guard<std::remove_reference<decltype(MUTEX)>::type>                       \
+        ABC_PROFILE_CONCAT_IMPL(abc_profileLockGuard, __LINE__)(                                         \
+            ABC_PROFILE_CONCAT_IMPL(abc_profileLockTagId, __LINE__), MUTEX)
+
+#define ABC_PROFILE_TRACE_START(...)                                     \
+    do {                                                                 \
+        abc::detail::profiler::GetInstance().start_tracing(__VA_ARGS__); \
+    } while (false)
+#define ABC_PROFILE_TRACE_STOP()                             \
+    do {                                                     \
+        abc::detail::profiler::GetInstance().stop_tracing(); \
+    } while (false)
+#define ABC_PROFILE_TRACE_WRITE(PATH) abc::detail::profiler::GetInstance().write_trace(PATH)
+
+#define ABC_PROFILE_SAMPLING_START(...) abc::detail::profiler::GetInstance().start_sampling(__VA_ARGS__)
+#define ABC_PROFILE_SAMPLING_STOP()                           \
+    do {                                                      \
+        abc::detail::profiler::GetInstance().stop_sampling(); \
+    } while (false)
+#define ABC_PROFILE_SAMPLING_WRITE(PATH) abc::detail::profiler::GetInstance().write_folded_stacks(PATH)
+
+#define ABC_PROFILE_PUBLISH_START(...) abc::detail::profiler::GetInstance().start_publishing(__VA_ARGS__)
+#define ABC_PROFILE_PUBLISH_STOP()                               \
+    do {                                                         \
+        abc::detail::profiler::GetInstance().stop_publishing(); \
     } while (false)
 
 #define ABC_PROFILE_SUMMARY(...)                                           \
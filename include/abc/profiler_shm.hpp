@@ -0,0 +1,101 @@
+#pragma once
+
+#include "abc/string.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace abc {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+///@brief: fixed layout of the shared memory segment written by profiler::start_publishing (POSIX only). The
+///        publisher makes sequence odd while it updates the statistics and even again after, readers copy them
+///        and retry when sequence moved meanwhile. Tag names never change once counted in tagCount.
+namespace profiler_shm {
+constexpr uint64_t k_magic    = 0x314D48535F434241ull;   // "ABC_SHM1"
+constexpr uint32_t k_version  = 2;
+constexpr size_t   k_maxTags  = 4096;
+constexpr size_t   k_nameSize = 64;
+
+struct tag {
+    char                  name[k_nameSize];   // truncated, always null terminated
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> minNs;
+    std::atomic<uint64_t> maxNs;
+    std::atomic<uint64_t> lockedNs;
+    std::atomic<uint64_t> p50Ns;   // percentiles are 0 without ABC_PROFILE_HISTOGRAM
+    std::atomic<uint64_t> p90Ns;
+    std::atomic<uint64_t> p99Ns;
+    std::atomic<uint64_t> p999Ns;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> allocatedBytes;
+};
+
+struct header {
+    std::atomic<uint64_t> magic;   // stored last, once the segment is initialized
+    uint32_t              version;
+    uint32_t              capacity;
+    int64_t               pid;
+    uint64_t              intervalMs;
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> publishes;
+    std::atomic<int64_t>  timestampNs;   // system clock, of the last publish
+    std::atomic<uint64_t> tagCount;
+    tag                   tags[k_maxTags];
+};
+
+///@return the segment name used when start_publishing is given none
+abc::string get_default_name(int64_t pid);
+}   // namespace profiler_shm
+
+///@brief: consistent copy of a published segment
+struct profiler_snapshot {
+    struct tag {
+        abc::string name;
+        uint64_t    calls          = 0;
+        uint64_t    totalNs        = 0;
+        uint64_t    minNs          = 0;
+        uint64_t    maxNs          = 0;
+        uint64_t    lockedNs       = 0;
+        uint64_t    p50Ns          = 0;
+        uint64_t    p90Ns          = 0;
+        uint64_t    p99Ns          = 0;
+        uint64_t    p999Ns         = 0;
+        uint64_t    allocations    = 0;
+        uint64_t    allocatedBytes = 0;
+    };
+
+    int64_t          pid         = 0;
+    uint64_t         intervalMs  = 0;
+    uint64_t         publishes   = 0;
+    int64_t          timestampNs = 0;
+    std::vector<tag> tags;
+};
+
+///@brief: maps a published segment read only, the publishing process is never blocked by readers
+class profiler_shm_reader {
+public:
+    profiler_shm_reader() = default;
+    ~profiler_shm_reader() { close(); }
+    profiler_shm_reader(const profiler_shm_reader&)            = delete;
+    profiler_shm_reader& operator=(const profiler_shm_reader&) = delete;
+
+    ///@return false when the segment does not exist or was not written by a compatible profiler
+    bool open(const abc::string& name);
+    void close();
+
+    ///@return false when the publisher kept updating the segment while it was copied
+    bool read(profiler_snapshot& out) const;
+
+private:
+    const profiler_shm::header* m_header = nullptr;
+    size_t                      m_size   = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace abc
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "abc/histogram.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace abc {
+///////////////////////////////////////////////////////////////////////////////
+
+///@brief: statistics of the last seconds of a stream of values (i.e. latencies in nanoseconds), kept in a ring of
+///        one second slots. A slot is recycled by the first record of a newer second, so there is no background
+///        rotation and recording costs a slot index on top of the histogram. One thread records, any thread can
+///        read or merge it meanwhile: every slot is stamped with its second and read like a seqlock.
+class rolling_window {
+public:
+    static constexpr size_t k_slotCount = 60;   // longest window, in seconds
+
+    ///@brief: 8 sub-buckets (~12% precision) up to 2^40 (~18 minutes in nanoseconds), ~2.4 KB per slot
+    using histogram = basic_log_linear_histogram<4, 40>;
+
+    struct stats {
+        uint64_t  count = 0;
+        uint64_t  total = 0;
+        uint64_t  max   = 0;
+        histogram values;
+    };
+
+    rolling_window() = default;
+    rolling_window(const rolling_window& other) { merge(other); }
+    rolling_window& operator=(const rolling_window&) = delete;
+
+    ///@brief: owner only
+    void record(uint64_t second, uint64_t value)
+    {
+        slot& current = get_slot(second);
+        add_relaxed(current.count, 1);
+        add_relaxed(current.total, value);
+        if (value > current.max.load(std::memory_order_relaxed)) {
+            current.max.store(value, std::memory_order_relaxed);
+        }
+        current.values.record(value);
+    }
+
+    ///@brief: owner only, forgets every second recorded so far, readers skip the slots until they are recycled
+    void reset()
+    {
+        for (slot& current : m_slots) {
+            current.stamp.store(0, std::memory_order_release);
+        }
+    }
+
+    ///@brief: adds the slots of other that are not older than this window's, only this window's owner can call it
+    void merge(const rolling_window& other)
+    {
+        for (const slot& source : other.m_slots) {
+            const uint64_t stamp = source.stamp.load(std::memory_order_acquire);
+            if (stamp == 0) {
+                continue;
+            }
+            slot& target = m_slots[(stamp - 1) % k_slotCount];
+            if (target.stamp.load(std::memory_order_relaxed) > stamp) {
+                continue;
+            }
+            slot& current = get_slot(stamp - 1);
+            add_relaxed(current.count, source.count.load(std::memory_order_relaxed));
+            add_relaxed(current.total, source.total.load(std::memory_order_relaxed));
+            const uint64_t max = source.max.load(std::memory_order_relaxed);
+            if (max > current.max.load(std::memory_order_relaxed)) {
+                current.max.store(max, std::memory_order_relaxed);
+            }
+            current.values.merge(source.values);
+        }
+    }
+
+    ///@brief: adds the complete seconds [now - seconds, now - 1] to out, the current second is still running
+    void collect(uint64_t now, size_t seconds, stats& out) const
+    {
+        seconds = seconds < k_slotCount ? seconds : k_slotCount;
+        for (size_t i = 1; i <= seconds && i <= now; ++i) {
+            const slot&    source = m_slots[(now - i) % k_slotCount];
+            const uint64_t stamp  = source.stamp.load(std::memory_order_acquire);
+            if (stamp != now - i + 1) {
+                continue;   // no record that second
+            }
+            const uint64_t count = source.count.load(std::memory_order_relaxed);
+            const uint64_t total = source.total.load(std::memory_order_relaxed);
+            const uint64_t max   = source.max.load(std::memory_order_relaxed);
+            histogram      values(source.values);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (source.stamp.load(std::memory_order_relaxed) != stamp) {
+                continue;   // recycled meanwhile
+            }
+            out.count += count;
+            out.total += total;
+            out.max = max > out.max ? max : out.max;
+            out.values.merge(values);
+        }
+    }
+
+private:
+    struct slot {
+        std::atomic<uint64_t> stamp{0};   // second + 1, 0 while empty or being recycled
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> max{0};
+        histogram             values;
+    };
+
+    static void add_relaxed(std::atomic<uint64_t>& value, uint64_t delta)
+    {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    slot& get_slot(uint64_t second)
+    {
+        slot& current = m_slots[second % k_slotCount];
+        if (current.stamp.load(std::memory_order_relaxed) != second + 1) {
+            current.stamp.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            current.count.store(0, std::memory_order_relaxed);
+            current.total.store(0, std::memory_order_relaxed);
+            current.max.store(0, std::memory_order_relaxed);
+            current.values.reset();
+            current.stamp.store(second + 1, std::memory_order_release);
+        }
+        return current;
+    }
+
+    slot m_slots[k_slotCount];
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace abc
@@ -35,7 +35,8 @@ struct timer_base {
 ///////////////////////////////////////////////////////////////////////////////
 }  // namespace detail
 
-using timer = detail::timer_base<>;
+using timer     = detail::timer_base<>;
+using tsc_timer = detail::timer_base<fast_clock>;   // see tsc_clock
 
 using duration      = timer::duration_t;
 using time_point    = timer::time_point_t;
@@ -0,0 +1,486 @@
+#include "abc/bench.hpp"
+#include "abc/charconv.hpp"
+#include "abc/format.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace abc {
+namespace bench {
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+constexpr uint64_t k_maxIterations = 1000000000ull;   // a body that never iterates measures 0 ns forever
+
+std::vector<benchmark>&
+get_registry()
+{
+    static std::vector<benchmark> s_benchmarks;
+    return s_benchmarks;
+}
+
+double
+to_ns(chrono::duration value)
+{
+    return static_cast<double>(std::chrono::duration_cast<chrono::nanoseconds>(value).count());
+}
+
+double
+get_median(std::vector<double>& values)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    const double upper = values[middle];
+    if (values.size() % 2 != 0) {
+        return upper;
+    }
+    return (*std::max_element(values.begin(), values.begin() + middle) + upper) / 2.0;
+}
+
+///@return the iterations of the next batch, aiming 20% above minBatchNs and growing 10x at most
+uint64_t
+get_next_iterations(uint64_t iterations, double elapsedNs, double minBatchNs)
+{
+    uint64_t next = iterations * 10;
+    if (elapsedNs > 0.0) {
+        const double target = static_cast<double>(iterations) * minBatchNs * 1.2 / elapsedNs;
+        next                = std::min(next, static_cast<uint64_t>(target));
+    }
+    return std::min(std::max(next, iterations + 1), k_maxIterations);
+}
+
+///@return the value of "key": in a line written by format_results as json
+bool
+find_json_value(const abc::string& line, const char* key, abc::string& out)
+{
+    const abc::string pattern = ABC_FORMAT("\"{}\":", key);
+    size_t            begin   = line.find(pattern);
+    if (begin == abc::string::npos) {
+        return false;
+    }
+    begin += pattern.size();
+    out.clear();
+    if (begin < line.size() && line[begin] == '"') {
+        for (size_t i = begin + 1; i < line.size(); ++i) {
+            if (line[i] == '"') {
+                return true;
+            }
+            if (line[i] == '\\' && i + 1 < line.size()) {
+                ++i;
+                // append_json_string only writes \u00XX escapes, for control characters
+                if (line[i] == 'u' && i + 4 < line.size()) {
+                    char code = 0;
+                    for (size_t digit = i + 3; digit <= i + 4; ++digit) {
+                        const char c = line[digit];
+                        code         = static_cast<char>(code * 16 + (c >= 'a' ? c - 'a' + 10 : c - '0'));
+                    }
+                    i += 4;
+                    out += code;
+                    continue;
+                }
+            }
+            out += line[i];
+        }
+        return false;
+    }
+    const size_t end = line.find_first_of(",}", begin);
+    out              = line.substr(begin, end == abc::string::npos ? abc::string::npos : end - begin);
+    return true;
+}
+
+bool
+parse_number(const abc::string& text, double& value)
+{
+    const char* last = text.data() + text.size();
+    return abc::from_chars(text.data(), last, value).ptr == last && !text.empty();
+}
+
+bool
+parse_number(const abc::string& text, uint64_t& value)
+{
+    const char* last = text.data() + text.size();
+    return abc::from_chars(text.data(), last, value).ptr == last && !text.empty();
+}
+
+bool
+parse_json_line(const abc::string& line, result& out)
+{
+    abc::string value;
+    uint64_t    repetitions = 0;
+    if (!find_json_value(line, "name", out.name)) {
+        return false;
+    }
+    const bool ok = find_json_value(line, "iterations", value) && parse_number(value, out.iterations)
+        && find_json_value(line, "repetitions", value) && parse_number(value, repetitions)
+        && find_json_value(line, "median_ns", value) && parse_number(value, out.medianNs)
+        && find_json_value(line, "mad_ns", value) && parse_number(value, out.madNs)
+        && find_json_value(line, "min_ns", value) && parse_number(value, out.minNs)
+        && find_json_value(line, "max_ns", value) && parse_number(value, out.maxNs);
+    out.repetitions = static_cast<unsigned>(repetitions);
+    return ok;
+}
+
+bool
+parse_csv_line(const abc::string& line, result& out)
+{
+    std::vector<abc::string> fields;
+    size_t                   begin = 0;
+    for (;;) {
+        const size_t end = line.find(',', begin);
+        fields.push_back(line.substr(begin, end == abc::string::npos ? abc::string::npos : end - begin));
+        if (end == abc::string::npos) {
+            break;
+        }
+        begin = end + 1;
+    }
+    uint64_t repetitions = 0;
+    if (fields.size() < 7 || !parse_number(fields[1], out.iterations) || !parse_number(fields[2], repetitions)
+        || !parse_number(fields[3], out.medianNs) || !parse_number(fields[4], out.madNs)
+        || !parse_number(fields[5], out.minNs) || !parse_number(fields[6], out.maxNs)) {
+        return false;
+    }
+    out.name        = fields[0];
+    out.repetitions = static_cast<unsigned>(repetitions);
+    return true;
+}
+
+bool
+write_file(const abc::string& path, const abc::string& content)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool ok = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+void
+write_usage(std::FILE* stream)
+{
+    std::fputs("usage: abc_bench [--list] [--filter <text>] [--repetitions <n>] [--min-time <ms>] [--warmup <ms>]\n"
+               "                 [--format console|json|csv] [--output <file>] [--baseline <file>]\n"
+               "                 [--threshold <percent>] [--help]\n",
+        stream);
+}
+
+int
+print_usage()
+{
+    write_usage(stderr);
+    return 2;
+}
+}   // namespace
+
+bool
+register_benchmark(const abc::string& name, abc::function<void(state&)> body)
+{
+    get_registry().push_back(benchmark{name, std::move(body)});
+    return true;
+}
+
+const std::vector<benchmark>&
+get_benchmarks()
+{
+    return get_registry();
+}
+
+void
+compute_statistics(std::vector<double> nanoseconds, result& out)
+{
+    if (nanoseconds.empty()) {
+        return;
+    }
+    out.minNs    = *std::min_element(nanoseconds.begin(), nanoseconds.end());
+    out.maxNs    = *std::max_element(nanoseconds.begin(), nanoseconds.end());
+    out.medianNs = get_median(nanoseconds);
+    for (double& value : nanoseconds) {
+        value = std::fabs(value - out.medianNs);
+    }
+    out.madNs = get_median(nanoseconds);
+}
+
+result
+run(const benchmark& benchmark, const options& options)
+{
+    const double minBatchNs = to_ns(options.minBatchTime);
+    const double warmupNs   = to_ns(options.warmupTime);
+
+    // warmup also sizes the batches: it runs until a batch lasts minBatchTime and warmupTime elapsed
+    chrono::timer warmup;
+    uint64_t      iterations = 1;
+    for (;;) {
+        state batch(iterations);
+        benchmark.body(batch);
+        const double elapsedNs = to_ns(batch.get_elapsed_time());
+        if (iterations == k_maxIterations) {
+            break;
+        }
+        if (elapsedNs < minBatchNs) {
+            iterations = get_next_iterations(iterations, elapsedNs, minBatchNs);
+        } else if (to_ns(warmup.get_elapsed_time()) >= warmupNs) {
+            break;
+        }
+    }
+
+    result              out;
+    std::vector<double> nanoseconds;
+    nanoseconds.reserve(options.repetitions);
+    for (unsigned i = 0; i < options.repetitions; ++i) {
+        state batch(iterations);
+        benchmark.body(batch);
+        nanoseconds.push_back(to_ns(batch.get_elapsed_time()) / static_cast<double>(iterations));
+        out.counters = batch.get_counters();
+    }
+
+    out.name        = benchmark.name;
+    out.iterations  = iterations;
+    out.repetitions = options.repetitions;
+    compute_statistics(std::move(nanoseconds), out);
+    return out;
+}
+
+abc::string
+format_results(const std::vector<result>& results, output_format format)
+{
+    abc::string out;
+    switch (format) {
+        case output_format::console: {
+            char line[256];
+            std::snprintf(line, sizeof(line), "%-40s %12s %12s %8s %12s %12s %12s\n", "benchmark", "median", "mad",
+                "mad %", "min", "max", "iterations");
+            out += line;
+            for (const result& entry : results) {
+                const double percent = entry.medianNs > 0.0 ? entry.madNs * 100.0 / entry.medianNs : 0.0;
+                std::snprintf(line, sizeof(line), "%-40.40s %12s %12s %7.2f%% %12s %12s %9llux%u",
+                    entry.name.c_str(), format_nanoseconds(entry.medianNs).c_str(),
+                    format_nanoseconds(entry.madNs).c_str(), percent, format_nanoseconds(entry.minNs).c_str(),
+                    format_nanoseconds(entry.maxNs).c_str(), static_cast<unsigned long long>(entry.iterations),
+                    entry.repetitions);
+                out += line;
+                for (const counter& item : entry.counters) {
+                    out += ABC_FORMAT("  {}={:.2f}", item.name, item.value);
+                }
+                out += '\n';
+            }
+            break;
+        }
+        case output_format::json: {
+            // one benchmark per line, read_results relies on it
+            out += "{\"benchmarks\":[\n";
+            for (size_t i = 0; i < results.size(); ++i) {
+                const result& entry = results[i];
+                abc::string   counters;
+                for (const counter& item : entry.counters) {
+                    if (!counters.empty()) {
+                        counters += ',';
+                    }
+                    append_json_string(counters, item.name);
+                    counters += ABC_FORMAT(":{:.3f}", item.value);
+                }
+                out += "{\"name\":";
+                append_json_string(out, entry.name);
+                out += ABC_FORMAT(",\"iterations\":{},\"repetitions\":{},\"median_ns\":{:.3f},\"mad_ns\":{:.3f},"
+                                  "\"min_ns\":{:.3f},\"max_ns\":{:.3f},\"counters\":{{{}}}}}{}\n",
+                    entry.iterations, entry.repetitions, entry.medianNs, entry.madNs, entry.minNs, entry.maxNs,
+                    counters, i + 1 < results.size() ? "," : "");
+            }
+            out += "]}\n";
+            break;
+        }
+        case output_format::csv: {
+            // counters go in the last column as name=value pairs separated by ';'
+            out += "name,iterations,repetitions,median_ns,mad_ns,min_ns,max_ns,counters\n";
+            for (const result& entry : results) {
+                abc::string counters;
+                for (const counter& item : entry.counters) {
+                    counters += ABC_FORMAT("{}{}={:.3f}", counters.empty() ? "" : ";", item.name, item.value);
+                }
+                out += ABC_FORMAT("{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{}\n", entry.name, entry.iterations,
+                    entry.repetitions, entry.medianNs, entry.madNs, entry.minNs, entry.maxNs, counters);
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+bool
+read_results(const abc::string& path, std::vector<result>& out)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    abc::string content;
+    char        buffer[4096];
+    size_t      size = 0;
+    while ((size = std::fread(buffer, 1, sizeof(buffer), file)) != 0) {
+        content.append(buffer, size);
+    }
+    std::fclose(file);
+
+    const bool json  = content.find_first_not_of(" \t\r\n") != abc::string::npos
+        && content[content.find_first_not_of(" \t\r\n")] == '{';
+    size_t     begin = 0;
+    while (begin < content.size()) {
+        size_t end = content.find('\n', begin);
+        end        = end == abc::string::npos ? content.size() : end;
+        abc::string line = content.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        begin = end + 1;
+
+        result entry;
+        if (json ? parse_json_line(line, entry) : parse_csv_line(line, entry)) {
+            out.push_back(std::move(entry));
+        }
+    }
+    return true;
+}
+
+std::vector<comparison>
+compare(const std::vector<result>& baseline, const std::vector<result>& current, double threshold)
+{
+    std::unordered_map<abc::string, const result*> before;
+    for (const result& entry : baseline) {
+        before[entry.name] = &entry;
+    }
+
+    std::vector<comparison> comparisons;
+    for (const result& entry : current) {
+        const auto it = before.find(entry.name);
+        if (it == before.end() || it->second->medianNs <= 0.0) {
+            continue;
+        }
+        comparison item;
+        item.name       = entry.name;
+        item.baselineNs = it->second->medianNs;
+        item.currentNs  = entry.medianNs;
+        item.change     = item.currentNs / item.baselineNs - 1.0;
+        // a slowdown within 3 MAD of either run is noise, whatever its percentage
+        const double noise = 3.0 * std::max(entry.madNs, it->second->madNs);
+        item.regression    = item.change > threshold && item.currentNs - item.baselineNs > noise;
+        comparisons.push_back(item);
+    }
+    return comparisons;
+}
+
+int
+run_main(int argc, char** argv)
+{
+    options       settings;
+    output_format format = output_format::console;
+    abc::string   outputPath;
+    abc::string   baselinePath;
+    double        threshold = 0.05;
+    bool          list      = false;
+    for (int i = 1; i < argc; ++i) {
+        const bool  hasValue = i + 1 < argc;
+        uint64_t    number   = 0;
+        const char* argument = argv[i];
+        if (std::strcmp(argument, "--help") == 0 || std::strcmp(argument, "-h") == 0) {
+            write_usage(stdout);
+            return 0;
+        } else if (std::strcmp(argument, "--list") == 0) {
+            list = true;
+        } else if (std::strcmp(argument, "--filter") == 0 && hasValue) {
+            settings.filter = argv[++i];
+        } else if (std::strcmp(argument, "--repetitions") == 0 && hasValue) {
+            if (!parse_number(argv[++i], number) || number == 0) {
+                return print_usage();
+            }
+            settings.repetitions = static_cast<unsigned>(number);
+        } else if (std::strcmp(argument, "--min-time") == 0 && hasValue) {
+            if (!parse_number(argv[++i], number)) {
+                return print_usage();
+            }
+            settings.minBatchTime = chrono::milliseconds(number);
+        } else if (std::strcmp(argument, "--warmup") == 0 && hasValue) {
+            if (!parse_number(argv[++i], number)) {
+                return print_usage();
+            }
+            settings.warmupTime = chrono::milliseconds(number);
+        } else if (std::strcmp(argument, "--format") == 0 && hasValue) {
+            const abc::string name = argv[++i];
+            if (name == "console") {
+                format = output_format::console;
+            } else if (name == "json") {
+                format = output_format::json;
+            } else if (name == "csv") {
+                format = output_format::csv;
+            } else {
+                return print_usage();
+            }
+        } else if (std::strcmp(argument, "--output") == 0 && hasValue) {
+            outputPath = argv[++i];
+        } else if (std::strcmp(argument, "--baseline") == 0 && hasValue) {
+            baselinePath = argv[++i];
+        } else if (std::strcmp(argument, "--threshold") == 0 && hasValue) {
+            double percent = 0.0;
+            if (!parse_number(abc::string(argv[++i]), percent) || percent < 0.0) {
+                return print_usage();
+            }
+            threshold = percent / 100.0;
+        } else {
+            return print_usage();
+        }
+    }
+
+    std::vector<result> results;
+    for (const benchmark& entry : get_benchmarks()) {
+        if (!settings.filter.empty() && entry.name.find(settings.filter) == abc::string::npos) {
+            continue;
+        }
+        if (list) {
+            std::printf("%s\n", entry.name.c_str());
+            continue;
+        }
+        std::fprintf(stderr, "running %s\n", entry.name.c_str());
+        results.push_back(run(entry, settings));
+    }
+    if (list) {
+        return 0;
+    }
+
+    // with an output file the console gets the table and the file the requested format, json by default
+    if (outputPath.empty()) {
+        std::fputs(format_results(results, format).c_str(), stdout);
+    } else {
+        std::fputs(format_results(results, output_format::console).c_str(), stdout);
+        const output_format written = format == output_format::console ? output_format::json : format;
+        if (!write_file(outputPath, format_results(results, written))) {
+            std::fprintf(stderr, "abc_bench: cannot write '%s'\n", outputPath.c_str());
+            return 1;
+        }
+    }
+
+    if (baselinePath.empty()) {
+        return 0;
+    }
+    std::vector<result> baseline;
+    if (!read_results(baselinePath, baseline)) {
+        std::fprintf(stderr, "abc_bench: cannot read the baseline '%s'\n", baselinePath.c_str());
+        return 1;
+    }
+    bool regressed = false;
+    std::printf("\n%-40s %12s %12s %9s\n", "compared to baseline", "baseline", "current", "change");
+    for (const comparison& item : compare(baseline, results, threshold)) {
+        std::printf("%-40.40s %12s %12s %+8.1f%%%s\n", item.name.c_str(),
+            format_nanoseconds(item.baselineNs).c_str(), format_nanoseconds(item.currentNs).c_str(),
+            item.change * 100.0, item.regression ? "  REGRESSION" : "");
+        regressed = regressed || item.regression;
+    }
+    return regressed ? 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace bench
+}   // namespace abc
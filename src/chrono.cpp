@@ -0,0 +1,91 @@
+#include "abc/chrono.hpp"
+
+#if (defined(ABC_PLATFORM_ARCHITECTURE_AMD64) || defined(ABC_PLATFORM_ARCHITECTURE_X86)) && !defined(_MSC_VER)
+#    include <cpuid.h>
+#endif
+
+namespace abc {
+namespace chrono {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+///@return true when the counter ticks at a constant rate through frequency changes and sleep states
+bool
+has_invariant_tsc()
+{
+#if defined(ABC_PLATFORM_ARCHITECTURE_AMD64) || defined(ABC_PLATFORM_ARCHITECTURE_X86)
+    // CPUID.80000007H:EDX[8], hypervisors that do not expose it get the steady clock
+#    if defined(_MSC_VER)
+    int registers[4] = {};
+    __cpuid(registers, 0x80000000);
+    if (static_cast<unsigned>(registers[0]) < 0x80000007u) {
+        return false;
+    }
+    __cpuid(registers, 0x80000007);
+    return (registers[3] & (1 << 8)) != 0;
+#    else
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1u << 8)) != 0;
+#    endif
+#elif defined(ABC_PLATFORM_ARCHITECTURE_ARM64) && !defined(_MSC_VER)
+    return true;   // the generic timer runs at the fixed cntfrq_el0 rate
+#else
+    return false;
+#endif
+}
+
+int64_t
+steady_nanoseconds()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+tsc_calibration
+calibrate()
+{
+    tsc_calibration calibration;
+    if (!has_invariant_tsc()) {
+        return calibration;
+    }
+
+    constexpr int64_t k_calibrationNs = 10 * 1000 * 1000;
+    const uint64_t    ticks0          = read_tsc();
+    const int64_t     ns0             = steady_nanoseconds();
+    int64_t           ns1             = ns0;
+    while (ns1 - ns0 < k_calibrationNs) {
+        ns1 = steady_nanoseconds();
+    }
+    const uint64_t ticks1 = read_tsc();
+    if (ticks1 <= ticks0) {
+        return calibration;
+    }
+
+    const double ticksPerNs = static_cast<double>(ticks1 - ticks0) / static_cast<double>(ns1 - ns0);
+    if (ticksPerNs < 1e-3 || ticksPerNs > 1e3) {
+        return calibration;   // below 1MHz or above 1THz, not a usable counter
+    }
+    calibration.useTsc      = true;
+    calibration.baseTicks   = ticks0;
+    calibration.baseNs      = ns0;
+    calibration.nsPerTick32 = static_cast<uint64_t>(4294967296.0 / ticksPerNs);
+    calibration.ticksPerNs  = ticksPerNs;
+    return calibration;
+}
+}   // namespace
+
+const tsc_calibration&
+get_tsc_calibration()
+{
+    static const tsc_calibration calibration = calibrate();
+    return calibration;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace chrono
+}   // namespace abc
@@ -11,6 +11,7 @@ namespace detail
 
 response do_assert(const char* condition, const char* file, int line, const char* message)
 {
+	abc::log::flush();
 	std::cerr << "ASSERTION FAILED(" << condition << "): " << message
 			  << "[" << file << ":" << line << "]"
 			  << std::endl;
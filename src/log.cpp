@@ -0,0 +1,1203 @@
+#include "abc/core.hpp"
+#include "abc/debug.hpp"
+#include "abc/log.hpp"
+#include "abc/log_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(ABC_PLATFORM_POSIX_API)
+#include <signal.h>
+#include <time.h>
+#endif
+#if defined(ABC_PLATFORM_WIN_API)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace abc {
+namespace log {
+//////////////////////////////////////////////////////////////////////////
+
+const char*
+get_level_name(level lvl)
+{
+    switch (lvl) {
+        case level::debug: return "DEBUG";
+        case level::info: return "INFO";
+        case level::warning: return "WARNING";
+        case level::error: return "ERROR";
+        case level::off: return "OFF";
+    }
+    return "UNKNOWN";
+}
+
+bool
+parse_level(const char* name, size_t size, level& out)
+{
+    const auto equals = [name, size](const char* candidate) {
+        if (std::char_traits<char>::length(candidate) != size) {
+            return false;
+        }
+        for (size_t i = 0; i < size; ++i) {
+            if (std::tolower(static_cast<unsigned char>(name[i])) != candidate[i]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (equals("debug")) {
+        out = level::debug;
+    } else if (equals("info")) {
+        out = level::info;
+    } else if (equals("warning") || equals("warn")) {
+        out = level::warning;
+    } else if (equals("error")) {
+        out = level::error;
+    } else if (equals("off")) {
+        out = level::off;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+channel g_rootChannel("", root_channel_tag());   // constant initialized, usable from any static initializer
+}   // namespace detail
+
+namespace {
+///@brief: levels set by name and the channels they apply to, only touched when channels come and go or
+///        levels change, never when logging
+struct channel_registry {
+    struct rule {
+        abc::string name;
+        level       lvl;
+    };
+
+    std::mutex            mutex;
+    std::vector<channel*> channels;
+    std::vector<rule>     rules;
+
+    static channel_registry& get()
+    {
+        static channel_registry s_registry;
+        return s_registry;
+    }
+
+    ///@brief: the most specific rule: the channel itself, then its parents up to the root ("")
+    level resolve(const char* name) const
+    {
+        const size_t size     = std::char_traits<char>::length(name);
+        const rule*  best     = nullptr;
+        size_t       bestSize = 0;
+        for (const rule& r : rules) {
+            const bool matches = r.name.empty()
+                || (r.name.size() <= size && r.name.compare(0, r.name.size(), name, r.name.size()) == 0
+                    && (r.name.size() == size || name[r.name.size()] == '.'));
+            if (matches && (best == nullptr || r.name.size() >= bestSize)) {
+                best     = &r;
+                bestSize = r.name.size();
+            }
+        }
+        return best != nullptr ? best->lvl : level::debug;
+    }
+
+    void set(const char* name, level lvl)
+    {
+        for (rule& r : rules) {
+            if (r.name == name) {
+                r.lvl = lvl;
+                return;
+            }
+        }
+        rules.push_back(rule{name, lvl});
+    }
+
+    void apply()
+    {
+        detail::g_rootChannel.set_threshold(resolve(""));
+        for (channel* c : channels) {
+            c->set_threshold(resolve(c->get_name()));
+        }
+    }
+};
+
+bool
+configure_levels(channel_registry& registry, const char* spec)
+{
+    std::vector<channel_registry::rule> parsed;
+    for (const char* it = spec; *it != '\0';) {
+        const char* end = it;
+        while (*end != '\0' && *end != ',') {
+            ++end;
+        }
+        const char* equals = it;
+        while (equals != end && *equals != '=') {
+            ++equals;
+        }
+        const char* levelName = equals != end ? equals + 1 : it;
+        level       lvl;
+        if (end != it) {
+            if (!parse_level(levelName, static_cast<size_t>(end - levelName), lvl)) {
+                return false;
+            }
+            parsed.push_back(channel_registry::rule{
+                equals != end ? abc::string(it, static_cast<size_t>(equals - it)) : abc::string(), lvl});
+        }
+        it = *end == ',' ? end + 1 : end;
+    }
+
+    for (const channel_registry::rule& r : parsed) {
+        registry.set(r.name.c_str(), r.lvl);
+    }
+    registry.apply();
+    return true;
+}
+
+// ABC_LOG_LEVEL is applied before main, channels defined by earlier static initializers are updated too
+struct environment_levels {
+    environment_levels()
+    {
+        const char* spec = std::getenv("ABC_LOG_LEVEL");
+        if (spec == nullptr) {
+            return;
+        }
+        channel_registry&           registry = channel_registry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!configure_levels(registry, spec)) {
+            std::cerr << "[WARNING][abc::log] ignoring invalid ABC_LOG_LEVEL '" << spec << "'" << std::endl;
+        }
+    }
+} g_environmentLevels;
+}   // namespace
+
+channel::channel(const char* name)
+    : m_name(name)
+    , m_threshold(static_cast<uint8_t>(level::debug))
+{
+    channel_registry&           registry = channel_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.channels.push_back(this);
+    set_threshold(registry.resolve(name));
+}
+
+channel::~channel()
+{
+    channel_registry&           registry = channel_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.channels.erase(std::remove(registry.channels.begin(), registry.channels.end(), this),
+                            registry.channels.end());
+}
+
+void
+set_level(const char* channelName, level lvl)
+{
+    channel_registry&           registry = channel_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.set(channelName, lvl);
+    registry.apply();
+}
+
+bool
+configure_levels(const char* spec)
+{
+    channel_registry&           registry = channel_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return configure_levels(registry, spec);
+}
+
+void
+reset_levels()
+{
+    channel_registry&           registry = channel_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.rules.clear();
+    registry.apply();
+}
+
+namespace detail {
+//////////////////////////////////////////////////////////////////////////
+
+void
+write_fd(int fd, const char* data, size_t size)
+{
+    while (size > 0) {
+#if defined(ABC_PLATFORM_WIN_API)
+        const int written = ::_write(fd, data, static_cast<unsigned>(size));
+#else
+        const ssize_t written = ::write(fd, data, size);
+#endif
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+///@brief: bounded MPSC ring (Vyukov), every slot carries its own sequence number so producers
+///        only contend on the head index and the single consumer never takes a lock
+class record_ring {
+public:
+    static constexpr size_t k_slotSize   = 256;
+    static constexpr size_t k_inlineSize =
+        k_slotSize - sizeof(std::atomic<size_t>) - sizeof(char*) - 2 * sizeof(uint32_t);
+
+    struct alignas(64) slot {
+        std::atomic<size_t> sequence;
+        char*               heap;   // records longer than k_inlineSize
+        uint32_t            size;
+        uint32_t            padding;
+        char                data[k_inlineSize];
+
+        const char* get_data() const { return heap != nullptr ? heap : data; }
+    };
+
+    explicit record_ring(size_t capacity)
+    {
+        size_t powerOfTwo = 16;
+        while (powerOfTwo < capacity) {
+            powerOfTwo <<= 1;
+        }
+        m_mask  = powerOfTwo - 1;
+        m_slots = std::vector<slot>(powerOfTwo);
+        for (size_t i = 0; i < powerOfTwo; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            m_slots[i].heap = nullptr;
+        }
+    }
+    ~record_ring()
+    {
+        for (slot& s : m_slots) {
+            std::free(s.heap);
+        }
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    ///@return false when the ring is full
+    bool try_push(const char* data, size_t size)
+    {
+        size_t position = m_head.load(std::memory_order_relaxed);
+        slot*  target   = nullptr;
+        for (;;) {
+            target                   = &m_slots[position & m_mask];
+            const size_t   sequence  = target->sequence.load(std::memory_order_acquire);
+            const intptr_t distance  = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (distance == 0) {
+                if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (distance < 0) {
+                return false;
+            } else {
+                position = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (size <= k_inlineSize) {
+            std::memcpy(target->data, data, size);
+            target->heap = nullptr;
+        } else {
+            target->heap = static_cast<char*>(std::malloc(size));
+            if (target->heap != nullptr) {
+                std::memcpy(target->heap, data, size);
+            } else {
+                size = std::min(size, k_inlineSize);
+                std::memcpy(target->data, data, size);
+            }
+        }
+        target->size = static_cast<uint32_t>(size);
+        target->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    ///@brief: consumer side, calls func(data, size) for the next published record
+    ///@return false when there is nothing to read
+    template <typename Func>
+    bool try_pop(Func&& func)
+    {
+        slot&        source   = m_slots[m_tail & m_mask];
+        const size_t sequence = source.sequence.load(std::memory_order_acquire);
+        if (sequence != m_tail + 1) {
+            return false;
+        }
+        func(source.get_data(), static_cast<size_t>(source.size));
+        std::free(source.heap);
+        source.heap = nullptr;
+        source.sequence.store(m_tail + capacity(), std::memory_order_release);
+        ++m_tail;
+        m_consumed.store(m_tail, std::memory_order_release);
+        return true;
+    }
+
+    size_t get_pushed() const { return m_head.load(std::memory_order_acquire); }
+    size_t get_consumed() const { return m_consumed.load(std::memory_order_acquire); }
+
+private:
+    std::vector<slot>   m_slots;
+    size_t              m_mask = 0;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) size_t m_tail = 0;
+    std::atomic<size_t> m_consumed{0};
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+///@brief: SPSC byte ring owned by one producer thread, records never wrap: a padding record fills the end of the
+///        buffer when the next one does not fit. Capacity and record sizes are multiples of the header size, so the
+///        space left at the end always holds a padding header.
+class deferred_buffer {
+public:
+    static constexpr uint32_t k_paddingSite = 0xFFFFFFFFu;
+
+    explicit deferred_buffer(size_t capacity)
+    {
+        size_t powerOfTwo = 1024;
+        while (powerOfTwo < capacity) {
+            powerOfTwo <<= 1;
+        }
+        m_data.resize(powerOfTwo);
+    }
+
+    size_t capacity() const { return m_data.size(); }
+
+    ///@return nullptr when there is not enough room
+    char* reserve(size_t size)
+    {
+        size                  = align(size);
+        const size_t head     = m_head.load(std::memory_order_relaxed);
+        const size_t offset   = head & (capacity() - 1);
+        const size_t trailing = capacity() - offset;
+        m_padding             = size > trailing ? trailing : 0;
+
+        if (capacity() - (head - m_tail.load(std::memory_order_acquire)) < m_padding + size) {
+            return nullptr;
+        }
+        if (m_padding != 0) {
+            const deferred_record_header padding = {static_cast<uint32_t>(m_padding), k_paddingSite, 0};
+            std::memcpy(&m_data[offset], &padding, sizeof(padding));
+            return &m_data[0];
+        }
+        return &m_data[offset];
+    }
+    void commit(size_t size)
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + m_padding + align(size), std::memory_order_release);
+    }
+
+    ///@brief: consumer side, calls func(header, arguments) for every published record
+    template <typename Func>
+    bool drain(Func&& func)
+    {
+        const size_t head = m_head.load(std::memory_order_acquire);
+        size_t       tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == head) {
+            return false;
+        }
+        while (tail != head) {
+            deferred_record_header header;
+            const char*            record = &m_data[tail & (capacity() - 1)];
+            std::memcpy(&header, record, sizeof(header));
+            if (header.site != k_paddingSite) {
+                func(header, record + sizeof(header));
+            }
+            tail += align(header.size);
+        }
+        m_tail.store(tail, std::memory_order_release);
+        return true;
+    }
+
+    bool is_empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    std::atomic<bool> orphaned{false};   // the producer thread exited
+
+private:
+    static constexpr size_t k_alignment = sizeof(deferred_record_header);
+    static_assert((k_alignment & (k_alignment - 1)) == 0, "the header size has to be a power of two");
+
+    static size_t align(size_t size) { return (size + k_alignment - 1) & ~(k_alignment - 1); }
+
+    std::vector<char>   m_data;
+    size_t              m_padding = 0;   // producer only, between reserve and commit
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+///@brief: call sites and per-thread buffers, outlive any async backend
+struct deferred_registry {
+    std::mutex                                   mutex;
+    std::deque<log_site>                         sites;
+    std::vector<std::unique_ptr<deferred_buffer>> buffers;
+
+    static deferred_registry& get()
+    {
+        static deferred_registry s_registry;
+        return s_registry;
+    }
+
+    deferred_buffer* create_buffer(size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.emplace_back(new deferred_buffer(capacity));
+        return buffers.back().get();
+    }
+
+    ///@brief: consumer side, drains every buffer and releases the ones whose thread exited.
+    ///        Buffers are only destroyed here, so they are drained without holding the lock.
+    template <typename Func>
+    bool drain(Func&& func)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            m_draining.clear();
+            for (const std::unique_ptr<deferred_buffer>& buffer : buffers) {
+                m_draining.push_back(buffer.get());
+            }
+        }
+
+        bool any       = false;
+        bool releasing = false;
+        for (deferred_buffer* buffer : m_draining) {
+            const bool orphaned = buffer->orphaned.load(std::memory_order_acquire);
+            any |= buffer->drain(func);
+            releasing |= orphaned;
+        }
+        if (releasing) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = buffers.begin(); it != buffers.end();) {
+                if ((*it)->orphaned.load(std::memory_order_acquire) && (*it)->is_empty()) {
+                    it = buffers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        return any;
+    }
+
+private:
+    std::vector<deferred_buffer*> m_draining;   // consumer only
+};
+
+struct thread_buffer_holder {
+    deferred_buffer* buffer = nullptr;
+
+    ~thread_buffer_holder()
+    {
+        if (buffer != nullptr) {
+            buffer->orphaned.store(true, std::memory_order_release);
+        }
+    }
+};
+thread_local thread_buffer_holder t_deferredBuffer;
+
+//////////////////////////////////////////////////////////////////////////
+
+// rate limited call sites that suppressed messages, sites are statics and are never removed
+std::atomic<rate_limited_site*> g_rateLimitedSites{nullptr};
+
+void
+rate_limited_site::register_rate_limited_site(rate_limited_site* site)
+{
+    rate_limited_site* head = g_rateLimitedSites.load(std::memory_order_relaxed);
+    do {
+        site->next = head;
+    } while (!g_rateLimitedSites.compare_exchange_weak(
+        head, site, std::memory_order_release, std::memory_order_relaxed));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+class async_backend {
+public:
+    static constexpr size_t k_batchSize = 64 * 1024;
+
+    explicit async_backend(const async_config& config)
+        : m_config(config)
+        , m_ring(config.capacity)
+    {
+        m_batch.reserve(k_batchSize);
+        m_thread = std::thread([this] { run(); });
+    }
+    ~async_backend() { stop(); }
+
+    ///@brief: writes everything pending and joins the writer thread
+    void stop()
+    {
+        m_stop.store(true, std::memory_order_release);
+        if (m_thread.joinable()) {
+            wake_writer();
+            m_thread.join();
+        }
+    }
+
+    void push(const char* data, size_t size)
+    {
+        while (!m_ring.try_push(data, size)) {
+            switch (m_config.overflow) {
+                case overflow_policy::block:
+                    if (m_stop.load(std::memory_order_relaxed)) {
+                        return;
+                    }
+                    wake_writer();
+                    std::this_thread::yield();
+                    break;
+                case overflow_policy::drop:
+                case overflow_policy::count_dropped:
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    m_droppedUnreported.fetch_add(1, std::memory_order_relaxed);
+                    return;
+            }
+        }
+        notify_pushed();
+    }
+
+    deferred_reservation reserve_deferred(size_t size)
+    {
+        deferred_buffer*& buffer = t_deferredBuffer.buffer;
+        if (buffer != nullptr && buffer->capacity() < m_config.deferredBufferSize) {
+            // made for an earlier backend, released like the buffer of an exited thread once drained
+            buffer->orphaned.store(true, std::memory_order_release);
+            buffer = nullptr;
+        }
+        if (buffer == nullptr) {
+            buffer = deferred_registry::get().create_buffer(m_config.deferredBufferSize);
+        }
+        if (size > buffer->capacity() / 2) {
+            return deferred_reservation{nullptr, deferred_status::unavailable};
+        }
+        for (;;) {
+            char* out = buffer->reserve(size);
+            if (out != nullptr) {
+                return deferred_reservation{out, deferred_status::reserved};
+            }
+            switch (m_config.overflow) {
+                case overflow_policy::block:
+                    if (m_stop.load(std::memory_order_relaxed)) {
+                        return deferred_reservation{nullptr, deferred_status::dropped};
+                    }
+                    wake_writer();
+                    std::this_thread::yield();
+                    break;
+                case overflow_policy::drop:
+                case overflow_policy::count_dropped:
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    m_droppedUnreported.fetch_add(1, std::memory_order_relaxed);
+                    return deferred_reservation{nullptr, deferred_status::dropped};
+            }
+        }
+    }
+
+    ///@brief: only the first producer after the writer went to sleep pays for the wakeup
+    void notify_pushed()
+    {
+        if (m_writerSleeping.load(std::memory_order_relaxed)
+            && m_writerSleeping.exchange(false, std::memory_order_relaxed)) {
+            wake_writer();
+        }
+    }
+
+    ///@brief: waits for two complete drain passes, the second one starts after the call
+    void flush()
+    {
+        if (std::this_thread::get_id() == m_thread.get_id()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const uint64_t               target = m_passes.load(std::memory_order_relaxed) + 2;
+        ++m_flushWaiters;
+        m_wakeup.notify_one();
+        while (m_passes.load(std::memory_order_relaxed) < target && !m_stopped) {
+            m_flushed.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        --m_flushWaiters;
+    }
+
+    ///@brief: async-signal-safe, gives the writer thread some time to write what was pushed before the crash.
+    ///        No lock can be taken and no sleep is async-signal-safe, so it spins on the writer passes.
+    void flush_for_crash()
+    {
+        if (std::this_thread::get_id() == m_thread.get_id()) {
+            write_batch();
+            return;
+        }
+#if defined(ABC_PLATFORM_POSIX_API)
+        constexpr int64_t k_timeoutNs = 200 * 1000000;   // the writer polls every 10ms
+        const auto        now         = [] {
+            struct timespec time;
+            ::clock_gettime(CLOCK_MONOTONIC, &time);
+            return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+        };
+        const uint64_t target   = m_passes.load(std::memory_order_acquire) + 2;
+        const int64_t  deadline = now() + k_timeoutNs;
+        while (m_passes.load(std::memory_order_acquire) < target && now() < deadline) {
+        }
+#endif
+    }
+
+    uint64_t get_dropped_count() const { return m_dropped.load(std::memory_order_relaxed); }
+    int      get_fd() const { return m_config.fd; }
+
+private:
+    void wake_writer()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeup.notify_one();
+    }
+
+    void report_dropped()
+    {
+        const uint64_t dropped = m_droppedUnreported.exchange(0, std::memory_order_relaxed);
+        if (dropped != 0 && m_config.overflow == overflow_policy::count_dropped) {
+            char                          buffer[128];
+            const abc::format_to_n_result result = abc::format_to_n(
+                buffer, sizeof(buffer), ABC_FORMAT_STRING("[WARNING][abc::log] {} records dropped\n"), dropped);
+            append(buffer, static_cast<size_t>(result.out - buffer));
+        }
+    }
+
+    bool is_binary() const { return m_config.output == output_format::binary; }
+
+    void append(const char* data, size_t size)
+    {
+        if (is_binary()) {
+            append_record(binary::k_textRecordSite, get_timestamp(), data, size - 1);   // without the '\n'
+            return;
+        }
+        if (m_batch.size() + size > k_batchSize) {
+            write_batch();
+        }
+        if (size > k_batchSize) {
+            write_fd(m_config.fd, data, size);
+            return;
+        }
+        m_batch.insert(m_batch.end(), data, data + size);
+    }
+
+    void write_batch()
+    {
+        if (m_batch.empty()) {
+            return;
+        }
+        if (is_binary()) {
+            write_sites();
+            char  range[2 * binary::k_maxVarintSize];
+            char* rangeEnd = binary::write_varint(binary::write_varint(range, m_blockFirst), m_blockLast);
+            const size_t rangeSize = static_cast<size_t>(rangeEnd - range);
+
+            char  header[1 + binary::k_maxVarintSize];
+            char* headerEnd = binary::write_varint(header + 1, rangeSize + m_batch.size());
+            header[0]       = binary::k_blockChunk;
+            write_fd(m_config.fd, header, static_cast<size_t>(headerEnd - header));
+            write_fd(m_config.fd, range, rangeSize);
+        }
+        write_fd(m_config.fd, m_batch.data(), m_batch.size());
+        m_batch.clear();
+    }
+
+    ///@brief: binary output, adds a record to the current block
+    void append_record(uint32_t site, uint64_t timestamp, const char* data, size_t size)
+    {
+        if (!m_batch.empty() && m_batch.size() + size + 3 * binary::k_maxVarintSize > k_batchSize) {
+            write_batch();
+        }
+        if (m_batch.empty()) {
+            m_blockFirst        = timestamp;
+            m_blockLast         = timestamp;
+            m_previousTimestamp = 0;
+        }
+        m_blockFirst = std::min(m_blockFirst, timestamp);
+        m_blockLast  = std::max(m_blockLast, timestamp);
+
+        const int64_t delta = static_cast<int64_t>(timestamp - m_previousTimestamp);
+        char          header[3 * binary::k_maxVarintSize];
+        char*         out = binary::write_varint(header, site);
+        out               = binary::write_varint(out, binary::zigzag_encode(delta));
+        out               = binary::write_varint(out, size);
+        m_batch.insert(m_batch.end(), header, out);
+        m_batch.insert(m_batch.end(), data, data + size);
+        m_previousTimestamp = timestamp;
+    }
+
+    ///@brief: binary output, writes the sites registered since the last call
+    void write_sites()
+    {
+        m_siteChunks.clear();
+        {
+            deferred_registry&          registry = deferred_registry::get();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (; m_sitesWritten < registry.sites.size(); ++m_sitesWritten) {
+                append_site_chunk(
+                    m_siteChunks, static_cast<uint32_t>(m_sitesWritten), registry.sites[m_sitesWritten]);
+            }
+        }
+        write_fd(m_config.fd, m_siteChunks.data(), m_siteChunks.size());
+    }
+
+    static void append_site_chunk(abc::string& out, uint32_t id, const log_site& site)
+    {
+        abc::string payload;
+        binary::append_varint(payload, id);
+        payload.push_back(static_cast<char>(site.lvl));
+        binary::append_varint(payload, static_cast<uint64_t>(site.line));
+        for (const char* text : {site.file, site.format, site.signature}) {
+            const size_t size = std::char_traits<char>::length(text);
+            binary::append_varint(payload, size);
+            payload.append(text, size);
+        }
+        out.push_back(binary::k_siteChunk);
+        binary::append_varint(out, payload.size());
+        out.append(payload);
+    }
+
+    void append_deferred(const deferred_record_header& header, const char* arguments)
+    {
+        const size_t size = header.size - sizeof(deferred_record_header);
+        if (is_binary()) {
+            append_record(header.site + 1, header.timestamp, arguments, size);
+            return;
+        }
+        const log_site* site = find_site(header.site);
+        if (site == nullptr) {
+            return;
+        }
+        m_line.clear();
+        abc::detail::string_sink<abc::string> sink(m_line);
+        abc::detail::format_to_sink(
+            sink, ABC_FORMAT_STRING("[{}][{}:{}] "), get_level_name(site->lvl), site->file, site->line);
+        format_deferred_arguments(m_line, site->format, site->signature, arguments, size);
+        m_line.push_back('\n');
+        append(m_line.data(), m_line.size());
+    }
+
+    ///@brief: the writer formats the summaries itself, pushing them into its own ring could block
+    void report_suppressed(bool force)
+    {
+        if (m_config.suppressedReportMs == 0 && !force) {
+            return;
+        }
+        const uint64_t now = get_timestamp();
+        if (!force && now < m_nextSuppressedReport) {
+            return;
+        }
+        m_nextSuppressedReport = now + uint64_t(m_config.suppressedReportMs) * 1000000;
+
+        rate_limited_site* site = g_rateLimitedSites.load(std::memory_order_acquire);
+        for (; site != nullptr; site = site->next) {
+            const uint64_t suppressed = site->take_suppressed();
+            if (suppressed == 0) {
+                continue;
+            }
+            m_line.clear();
+            abc::detail::string_sink<abc::string> sink(m_line);
+            abc::detail::format_to_sink(sink, ABC_FORMAT_STRING("[{}][{}:{}] suppressed {} messages\n"),
+                get_level_name(site->get_level()), site->get_file(), site->get_line(), suppressed);
+            append(m_line.data(), m_line.size());
+        }
+    }
+
+    bool drain(bool final = false)
+    {
+        bool any = false;
+        while (m_ring.try_pop([this](const char* data, size_t size) { append(data, size); })) {
+            any = true;
+        }
+        any |= deferred_registry::get().drain([this](const deferred_record_header& header, const char* arguments) {
+            append_deferred(header, arguments);
+        });
+        report_dropped();
+        report_suppressed(final);
+        write_batch();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_passes.fetch_add(1, std::memory_order_release);
+        if (m_flushWaiters > 0) {
+            m_flushed.notify_all();
+        }
+        return any;
+    }
+
+    void run()
+    {
+        if (is_binary()) {
+            write_fd(m_config.fd, binary::k_magic, sizeof(binary::k_magic));
+            write_sites();
+        }
+        for (;;) {
+            if (drain()) {
+                continue;
+            }
+            if (m_stop.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_writerSleeping.store(true, std::memory_order_relaxed);
+            if (m_ring.get_pushed() == m_ring.get_consumed() && m_flushWaiters == 0
+                && !m_stop.load(std::memory_order_acquire)) {
+                m_wakeup.wait_for(lock, std::chrono::milliseconds(10));
+            }
+            m_writerSleeping.store(false, std::memory_order_relaxed);
+        }
+        drain(true);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        m_flushed.notify_all();
+    }
+
+    const async_config m_config;
+    record_ring        m_ring;
+    std::vector<char>  m_batch;
+    abc::string        m_line;         // deferred records and summaries are formatted here, then appended
+    abc::string        m_siteChunks;   // write_sites only, it runs from append when a block is full
+    std::thread        m_thread;
+
+    // binary output, the block being built in m_batch
+    uint64_t m_blockFirst        = 0;
+    uint64_t m_blockLast         = 0;
+    uint64_t m_previousTimestamp = 0;
+    size_t   m_sitesWritten      = 0;
+
+    uint64_t m_nextSuppressedReport = 0;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_flushed;
+    size_t                  m_flushWaiters = 0;
+    bool                    m_stopped      = false;
+
+    std::atomic<uint64_t> m_passes{0};   // completed drain passes
+    std::atomic<bool>     m_stop{false};
+    std::atomic<bool>     m_writerSleeping{false};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_droppedUnreported{0};
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+// Producers read the backend without locking, they count themselves in g_backendUsers meanwhile and stop_async
+// destroys a stopped backend once they left. Calls racing with stop_async may lose their record.
+std::atomic<async_backend*> g_backend{nullptr};
+std::atomic<uint32_t>       g_backendUsers{0};
+std::mutex                  g_backendMutex;
+uint64_t                    g_stoppedDropped = 0;   // dropped by the destroyed backends, under g_backendMutex
+
+///@brief: the backend stays alive while it is in scope, it is nullptr when logging is synchronous
+class backend_user {
+public:
+    backend_user()
+    {
+        // sequentially consistent with the exchange in stop_async: either it sees this user or this user sees
+        // nullptr
+        g_backendUsers.fetch_add(1);
+        m_backend = g_backend.load();
+    }
+    ~backend_user() { g_backendUsers.fetch_sub(1, std::memory_order_release); }
+    backend_user(const backend_user&)            = delete;
+    backend_user& operator=(const backend_user&) = delete;
+
+    async_backend* get() const { return m_backend; }
+
+private:
+    async_backend* m_backend;
+};
+
+#if defined(ABC_PLATFORM_POSIX_API)
+const int k_crashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+// handlers installed before ours, sanitizers or crash reporters, they run once the log is flushed
+struct sigaction g_previousActions[sizeof(k_crashSignals) / sizeof(k_crashSignals[0])];
+std::atomic<bool> g_crashHandlersInstalled{false};
+
+void
+crash_signal_handler(int signal, siginfo_t* info, void* context)
+{
+    {
+        const backend_user backend;
+        if (backend.get() != nullptr) {
+            backend.get()->flush_for_crash();
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(k_crashSignals) / sizeof(k_crashSignals[0]); ++i) {
+        if (k_crashSignals[i] != signal) {
+            continue;
+        }
+        const struct sigaction& previous = g_previousActions[i];
+        ::sigaction(signal, &previous, nullptr);
+        if ((previous.sa_flags & SA_SIGINFO) != 0) {
+            previous.sa_sigaction(signal, info, context);
+        } else if (previous.sa_handler == SIG_DFL) {
+            std::raise(signal);   // delivered once this handler returns, the signal is blocked until then
+        } else if (previous.sa_handler != SIG_IGN) {
+            previous.sa_handler(signal);
+        }
+        return;
+    }
+}
+
+void
+install_crash_handlers()
+{
+    if (g_crashHandlersInstalled.exchange(true)) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(k_crashSignals) / sizeof(k_crashSignals[0]); ++i) {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = crash_signal_handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_SIGINFO;
+        ::sigaction(k_crashSignals[i], &action, &g_previousActions[i]);
+    }
+}
+#else
+void
+install_crash_handlers()
+{
+}
+#endif
+
+void
+submit(level lvl, const char* line, size_t size)
+{
+    ABC_UNUSED(lvl);
+    const backend_user backend;
+    if (backend.get() != nullptr) {
+        backend.get()->push(line, size);
+        return;
+    }
+    std::cerr.write(line, static_cast<std::streamsize>(size));
+    std::cerr.flush();
+}
+
+uint32_t
+register_site(level lvl, const char* format, const char* file, int line, const char* signature)
+{
+    deferred_registry&          registry = deferred_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.sites.push_back(log_site{lvl, format, file, line, signature});
+    return static_cast<uint32_t>(registry.sites.size() - 1);
+}
+
+const log_site*
+find_site(uint32_t id)
+{
+    deferred_registry&          registry = deferred_registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    return id < registry.sites.size() ? &registry.sites[id] : nullptr;
+}
+
+deferred_reservation
+reserve_deferred(size_t size)
+{
+    const backend_user backend;
+    if (backend.get() == nullptr) {
+        return deferred_reservation{nullptr, deferred_status::unavailable};
+    }
+    return backend.get()->reserve_deferred(size);
+}
+
+void
+commit_deferred(size_t size)
+{
+    t_deferredBuffer.buffer->commit(size);
+    const backend_user backend;
+    if (backend.get() != nullptr) {
+        backend.get()->notify_pushed();
+    }
+}
+
+namespace {
+// decoded arguments, one member per type code so the format engine sees the original types
+struct decoded_argument {
+    bool               b;
+    char               c;
+    short              h;
+    unsigned short     H;
+    int                i;
+    unsigned           I;
+    long long          l;
+    unsigned long long L;
+    float              f;
+    double             d;
+    abc::string        s;
+};
+
+using decoded_sink_t = abc::detail::string_sink<abc::string>;
+
+template <typename T>
+bool
+read_value(const char*& data, const char* end, T& value)
+{
+    if (static_cast<size_t>(end - data) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+template <typename T>
+bool
+decode_value(const char*& data, const char* end, T& value, abc::detail::format_arg<decoded_sink_t>& arg)
+{
+    arg = abc::detail::make_format_arg<decoded_sink_t>(value);
+    return read_value(data, end, value);
+}
+}   // namespace
+
+bool
+format_deferred_arguments(abc::string& out, const char* format, const char* signature, const char* data, size_t size)
+{
+    using sink_t = decoded_sink_t;
+
+    constexpr size_t                k_maxArguments = 32;
+    decoded_argument                values[k_maxArguments];
+    abc::detail::format_arg<sink_t> args[k_maxArguments];
+    size_t                          count = 0;
+
+    const char* end = data + size;
+    bool        ok  = true;
+    for (const char* code = signature; *code != '\0' && ok; ++code, ++count) {
+        if (count == k_maxArguments) {
+            ok = false;
+            break;
+        }
+        decoded_argument& value = values[count];
+        switch (*code) {
+            case 'b': ok = decode_value(data, end, value.b, args[count]); break;
+            case 'c': ok = decode_value(data, end, value.c, args[count]); break;
+            case 'h': ok = decode_value(data, end, value.h, args[count]); break;
+            case 'H': ok = decode_value(data, end, value.H, args[count]); break;
+            case 'i': ok = decode_value(data, end, value.i, args[count]); break;
+            case 'I': ok = decode_value(data, end, value.I, args[count]); break;
+            case 'l': ok = decode_value(data, end, value.l, args[count]); break;
+            case 'L': ok = decode_value(data, end, value.L, args[count]); break;
+            case 'f': ok = decode_value(data, end, value.f, args[count]); break;
+            case 'd': ok = decode_value(data, end, value.d, args[count]); break;
+            case 's': {
+                uint32_t length = 0;
+                ok = read_value(data, end, length) && static_cast<size_t>(end - data) >= length;
+                if (ok) {
+                    value.s.assign(data, length);
+                    data += length;
+                }
+                args[count] = abc::detail::make_format_arg<sink_t>(value.s);
+                break;
+            }
+            default: ok = false; break;
+        }
+    }
+
+    sink_t sink(out);
+    if (!ok) {
+        abc::detail::format_to_sink(sink, ABC_FORMAT_STRING("###Corrupted record for '{}'"), format);
+        return false;
+    }
+    abc::detail::vformat_to_sink(
+        sink, format, std::char_traits<char>::length(format), abc::detail::format_args<sink_t>{args, count});
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+
+//////////////////////////////////////////////////////////////////////////
+
+bool
+start_async(const async_config& config)
+{
+    std::lock_guard<std::mutex> lock(detail::g_backendMutex);
+    if (detail::g_backend.load(std::memory_order_relaxed) != nullptr) {
+        return false;
+    }
+
+    // constructed before registering stop_async, so it is still alive when it runs at exit
+    detail::deferred_registry::get();
+    static const bool s_atexitRegistered = (std::atexit(stop_async) == 0);
+    ABC_UNUSED(s_atexitRegistered);
+
+    std::cerr.flush();
+    detail::g_backend.store(new detail::async_backend(config));
+    if (config.flushOnCrash) {
+        detail::install_crash_handlers();
+    }
+    return true;
+}
+
+void
+stop_async()
+{
+    std::lock_guard<std::mutex> lock(detail::g_backendMutex);
+    detail::async_backend* backend = detail::g_backend.exchange(nullptr);
+    if (backend == nullptr) {
+        return;
+    }
+    backend->stop();
+    // producers that loaded the backend before the exchange are done with it once they left
+    while (detail::g_backendUsers.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+    detail::g_stoppedDropped += backend->get_dropped_count();
+    delete backend;
+}
+
+bool
+is_async()
+{
+    return detail::g_backend.load(std::memory_order_relaxed) != nullptr;
+}
+
+void
+flush()
+{
+    const detail::backend_user backend;
+    if (backend.get() != nullptr) {
+        backend.get()->flush();
+    } else {
+        std::cerr.flush();
+    }
+}
+
+uint64_t
+get_dropped_count()
+{
+    std::lock_guard<std::mutex> lock(detail::g_backendMutex);
+    detail::async_backend*      backend = detail::g_backend.load(std::memory_order_relaxed);
+    return detail::g_stoppedDropped + (backend != nullptr ? backend->get_dropped_count() : 0);
+}
+
+void
+report_suppressed()
+{
+    detail::rate_limited_site* site = detail::g_rateLimitedSites.load(std::memory_order_acquire);
+    for (; site != nullptr; site = site->next) {
+        site->report();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace log
+}   // namespace abc
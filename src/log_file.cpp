@@ -0,0 +1,216 @@
+#include "abc/log_file.hpp"
+
+#include <cstring>
+
+namespace abc {
+namespace log {
+namespace binary {
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+bool
+read_string(const char*& data, const char* end, abc::string& out)
+{
+    uint64_t size = 0;
+    if (!read_varint(data, end, size) || static_cast<uint64_t>(end - data) < size) {
+        return false;
+    }
+    out.assign(data, static_cast<size_t>(size));
+    data += size;
+    return true;
+}
+}   // namespace
+
+reader::reader(std::FILE* file)
+    : m_file(file)
+{
+}
+
+bool
+reader::open()
+{
+    char magic[sizeof(k_magic)];
+    if (std::fseek(m_file, 0, SEEK_SET) != 0 || std::fread(magic, 1, sizeof(magic), m_file) != sizeof(magic)) {
+        std::clearerr(m_file);
+        return false;
+    }
+    m_offset = static_cast<long>(sizeof(magic));
+    return std::memcmp(magic, k_magic, sizeof(magic)) == 0;
+}
+
+read_status
+reader::next(decoded_record& out)
+{
+    for (;;) {
+        if (m_record != m_blockEnd) {
+            const read_status status = read_record(out);
+            if (status == read_status::record && out.timestamp < m_minTimestamp) {
+                continue;
+            }
+            return status;
+        }
+        const read_status status = read_chunk();
+        if (status != read_status::record) {
+            return status;
+        }
+    }
+}
+
+void
+reader::seek(uint64_t timestamp)
+{
+    m_offset       = static_cast<long>(sizeof(k_magic));
+    m_record       = nullptr;
+    m_blockEnd     = nullptr;
+    m_minTimestamp = timestamp;
+}
+
+const detail::log_site*
+reader::find_site(uint32_t id) const
+{
+    return id < m_sites.size() ? &m_sites[id].site : nullptr;
+}
+
+bool
+reader::read_file_varint(uint64_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        const int byte = std::fgetc(m_file);
+        if (byte == EOF) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+///@return read_status::record once a chunk has been consumed
+read_status
+reader::read_chunk()
+{
+    if (std::fseek(m_file, m_offset, SEEK_SET) != 0) {
+        return read_status::end;
+    }
+    const int tag  = std::fgetc(m_file);
+    uint64_t  size = 0;
+    if (tag == EOF || !read_file_varint(size)) {
+        std::clearerr(m_file);
+        return read_status::end;
+    }
+    const long payload = std::ftell(m_file);
+
+    // blocks ending before the seek target are skipped by their header alone
+    if (tag == k_blockChunk && m_minTimestamp != 0) {
+        uint64_t first = 0;
+        uint64_t last  = 0;
+        if (!read_file_varint(first) || !read_file_varint(last)) {
+            std::clearerr(m_file);
+            return read_status::end;
+        }
+        if (last < m_minTimestamp) {
+            m_offset = payload + static_cast<long>(size);
+            return read_status::record;
+        }
+        std::fseek(m_file, payload, SEEK_SET);
+    }
+
+    m_chunk.resize(static_cast<size_t>(size));
+    if (std::fread(&m_chunk[0], 1, m_chunk.size(), m_file) != m_chunk.size()) {
+        std::clearerr(m_file);
+        return read_status::end;
+    }
+    m_offset = payload + static_cast<long>(size);
+
+    const char* data = m_chunk.data();
+    const char* end  = data + m_chunk.size();
+    switch (tag) {
+        case k_siteChunk: return read_site(data, end) ? read_status::record : read_status::corrupted;
+        case k_blockChunk: {
+            uint64_t first = 0;
+            uint64_t last  = 0;
+            if (!read_varint(data, end, first) || !read_varint(data, end, last)) {
+                return read_status::corrupted;
+            }
+            m_record    = data;
+            m_blockEnd  = end;
+            m_timestamp = 0;
+            return read_status::record;
+        }
+        default: return read_status::record;   // unknown chunks are skipped
+    }
+}
+
+bool
+reader::read_site(const char* data, const char* end)
+{
+    uint64_t id   = 0;
+    uint64_t line = 0;
+    if (!read_varint(data, end, id) || data == end) {
+        return false;
+    }
+    const level lvl = static_cast<level>(*data++);
+    if (!read_varint(data, end, line)) {
+        return false;
+    }
+    if (id < m_sites.size()) {
+        return true;   // already known
+    }
+    if (id != m_sites.size()) {
+        return false;
+    }
+
+    m_sites.emplace_back();
+    site_storage& storage = m_sites.back();
+    if (!read_string(data, end, storage.file) || !read_string(data, end, storage.format)
+        || !read_string(data, end, storage.signature)) {
+        m_sites.pop_back();
+        return false;
+    }
+    storage.site = detail::log_site{
+        lvl, storage.format.c_str(), storage.file.c_str(), static_cast<int>(line), storage.signature.c_str()};
+    return true;
+}
+
+read_status
+reader::read_record(decoded_record& out)
+{
+    uint64_t site  = 0;
+    uint64_t delta = 0;
+    uint64_t size  = 0;
+    if (!read_varint(m_record, m_blockEnd, site) || !read_varint(m_record, m_blockEnd, delta)
+        || !read_varint(m_record, m_blockEnd, size) || static_cast<uint64_t>(m_blockEnd - m_record) < size) {
+        m_record = m_blockEnd;
+        return read_status::corrupted;
+    }
+    const char* data = m_record;
+    m_record += size;
+    m_timestamp += static_cast<uint64_t>(zigzag_decode(delta));
+
+    out.timestamp = m_timestamp;
+    out.text.clear();
+    if (site == k_textRecordSite) {
+        out.site = nullptr;
+        out.text.assign(data, static_cast<size_t>(size));
+        return read_status::record;
+    }
+
+    out.site = find_site(static_cast<uint32_t>(site - 1));
+    if (out.site == nullptr) {
+        return read_status::corrupted;
+    }
+    abc::detail::string_sink<abc::string> sink(out.text);
+    abc::detail::format_to_sink(
+        sink, ABC_FORMAT_STRING("[{}][{}:{}] "), get_level_name(out.site->lvl), out.site->file, out.site->line);
+    detail::format_deferred_arguments(
+        out.text, out.site->format, out.site->signature, data, static_cast<size_t>(size));
+    return read_status::record;
+}
+
+//////////////////////////////////////////////////////////////////////////
+}   // namespace binary
+}   // namespace log
+}   // namespace abc
@@ -1,4 +1,12 @@
 #include "abc/memory_mapped_file.hpp"
+#include "abc/debug.hpp"
+
+#if defined(ABC_PLATFORM_LINUX_FAMILY) || defined(ABC_PLATFORM_OSX_FAMILY)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
 
 namespace abc
 {
@@ -330,311 +338,240 @@ size_t memory_mapped_file::get_page_size() const
 }
 
 // Windows
-#elif defined(ABC_PLATFORM_LINUX_FAMILY)
-// Linux
-// enable large file support on 32 bit systems
-#    ifndef _LARGEFILE64_SOURCE
-#        define _LARGEFILE64_SOURCE
-#    endif
-#    ifdef _FILE_OFFSET_BITS
-#        undef _FILE_OFFSET_BITS
-#    endif
-#    define _FILE_OFFSET_BITS 64
-// and include needed headers
-#    include <sys/stat.h>
-#    include <sys/mman.h>
-#    include <fcntl.h>
-#    include <errno.h>
-#    include <unistd.h>
+#elif defined(ABC_PLATFORM_LINUX_FAMILY) || defined(ABC_PLATFORM_OSX_FAMILY)
+// POSIX
 
 struct memory_mapped_file::pimpl
 {
-    void* m_fileMapping;
-    void* m_fileHandle;
+    int m_file = -1;
 };
 
-/// do nothing, must use open()
 memory_mapped_file::memory_mapped_file()
-    : _filename(),
-      _filesize(0),
-      _hint(Normal),
-      _mappedBytes(0),
-      _file(0),
-#    ifdef _MSC_VER
-      _mappedFile(NULL),
-#    endif
-      _mappedView(NULL)
+    : m_filename(),
+      m_filesize(0),
+      m_access(access_type::read),
+      m_cacheHint(cache_hint::normal),
+
+      m_mappedBytes(0),
+      m_mappedFileView(nullptr),
+      m_impl(new pimpl())
 {
 }
 
 /// open file, mappedBytes = 0 maps the whole file
 memory_mapped_file::memory_mapped_file(const std::string& filename, size_t mappedBytes,
-                                       cache_hint hint)
-    : _filename(filename),
-      _filesize(0),
-      _hint(hint),
-      _mappedBytes(mappedBytes),
-      _file(0),
-#    ifdef _MSC_VER
-      _mappedFile(NULL),
-#    endif
-      _mappedView(NULL)
+                                       access_type access, cache_hint hint)
+    : m_filename(filename),
+      m_filesize(0),
+      m_access(access),
+      m_cacheHint(hint),
+
+      m_mappedBytes(mappedBytes),
+      m_mappedFileView(nullptr),
+      m_impl(new pimpl())
 {
-    open(filename, mappedBytes, hint);
+    auto openResult = open(filename, mappedBytes, access, hint);
+    ABC_ASSERT(openResult == abc::success, "{}", openResult.get_error().message_with_inner());
 }
 
 /// close file (see close() )
-memory_mapped_file::~memory_mapped_file() { close(); }
-
-/// open file
-bool memory_mapped_file::open(const std::string& filename, size_t mappedBytes, cache_hint hint)
+memory_mapped_file::~memory_mapped_file()
 {
-    // already open ?
-    if (isValid())
-        return false;
-
-    _file       = 0;
-    _filesize   = 0;
-    _hint       = hint;
-#    ifdef _MSC_VER
-    _mappedFile = NULL;
-#    endif
-    _mappedView = NULL;
-
-#    ifdef _MSC_VER
-    // Windows
-
-    DWORD winHint = 0;
-    switch (_hint)
-    {
-        case Normal:
-            winHint = FILE_ATTRIBUTE_NORMAL;
-            break;
-        case SequentialScan:
-            winHint = FILE_FLAG_SEQUENTIAL_SCAN;
-            break;
-        case RandomAccess:
-            winHint = FILE_FLAG_RANDOM_ACCESS;
-            break;
-        default:
-            break;
-    }
-
-    // open file
-    _file = ::CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
-                          winHint, NULL);
-    if (!_file)
-        return false;
-
-    // file size
-    LARGE_INTEGER result;
-    if (!GetFileSizeEx(_file, &result))
-        return false;
-    _filesize = static_cast<uint64_t>(result.QuadPart);
-
-    // convert to mapped mode
-    _mappedFile = ::CreateFileMapping(_file, NULL, PAGE_READONLY, 0, 0, NULL);
-    if (!_mappedFile)
-        return false;
+    close();
+    delete m_impl;
+}
 
-#    else
+/// open file, write access creates it and grows it to mappedBytes like CreateFileMapping does
+memory_mapped_file::open_result memory_mapped_file::open(const std::string& filename,
+                                                         size_t mappedBytes, access_type access,
+                                                         cache_hint hint)
+{
+    if (is_open())
+    {
+        return abc::success;
+    }
 
-    // Linux
+    m_filename       = filename;
+    m_filesize       = 0;
+    m_access         = access;
+    m_cacheHint      = hint;
+    m_mappedBytes    = 0;
+    m_mappedFileView = nullptr;
 
-    // open file
-    _file = ::open(filename.c_str(), O_RDONLY | O_LARGEFILE);
-    if (_file == -1)
+    // a shared writable mapping needs a file opened for reading too
+    const int flags = m_access == access_type::read ? O_RDONLY : O_RDWR | O_CREAT;
+    m_impl->m_file  = ::open(m_filename.c_str(), flags, 0644);
+    if (m_impl->m_file < 0)
     {
-        _file = 0;
-        return false;
+        return open_error(OpenErrorCode::FileNotFound,
+                          abc::format("{} file couldn't be opened", m_filename));
     }
 
-    // file size
-    struct stat64 statInfo;
-    if (fstat64(_file, &statInfo) < 0)
-        return false;
-
-    _filesize = statInfo.st_size;
-#    endif
+    struct stat status;
+    if (::fstat(m_impl->m_file, &status) != 0)
+    {
+        close();
+        return open_error(OpenErrorCode::FileNotFound,
+                          abc::format("{} Failed retrieving size", m_filename));
+    }
+    m_filesize = static_cast<size_t>(status.st_size);
 
-    // initial mapping
-    remap(0, mappedBytes);
+    if (m_filesize == 0 && mappedBytes == 0)
+    {
+        close();
+        return open_error(
+            OpenErrorCode::InvalidParameters,
+            abc::format("{} Cannot create an empty mapping. File is empty.", m_filename));
+    }
+    if (m_access != access_type::read && mappedBytes > m_filesize)
+    {
+        if (::ftruncate(m_impl->m_file, static_cast<off_t>(mappedBytes)) != 0)
+        {
+            close();
+            return open_error(OpenErrorCode::InvalidParameters,
+                              abc::format("{} Disk is full", m_filename));
+        }
+        m_filesize = mappedBytes;
+    }
 
-    if (!_mappedView)
-        return false;
+    auto remapResult = remap(0, mappedBytes);
+    if (remapResult != abc::success)
+    {
+        close();
+        return open_error(
+            OpenErrorCode::InvalidParameters,
+            abc::format("{} Failed remapping: {}", m_filename, remapResult.get_error().message()));
+    }
 
-    // everything's fine
-    return true;
+    return abc::success;
 }
 
-/// close file
 void memory_mapped_file::close()
 {
-    // kill pointer
-    if (_mappedView)
-    {
-#    ifdef _MSC_VER
-        ::UnmapViewOfFile(_mappedView);
-#    else
-        ::munmap(_mappedView, _filesize);
-#    endif
-        _mappedView = NULL;
-    }
-
-#    ifdef _MSC_VER
-    if (_mappedFile)
+    if (m_mappedFileView)
     {
-        ::CloseHandle(_mappedFile);
-        _mappedFile = NULL;
+        ::munmap(m_mappedFileView, m_mappedBytes);
+        m_mappedFileView = nullptr;
     }
-#    endif
 
-    // close underlying file
-    if (_file)
+    if (m_impl->m_file >= 0)
     {
-#    ifdef _MSC_VER
-        ::CloseHandle(_file);
-#    else
-        ::close(_file);
-#    endif
-        _file = 0;
+        ::close(m_impl->m_file);
+        m_impl->m_file = -1;
     }
 
-    _filesize = 0;
+    m_mappedBytes = 0;
+    m_filesize    = 0;
 }
 
-/// access position, no range checking (faster)
-unsigned char memory_mapped_file::operator[](size_t offset) const
+uint8_t memory_mapped_file::operator[](size_t offset) const
 {
-    return ((unsigned char*)_mappedView)[offset];
+    return (static_cast<uint8_t*>(m_mappedFileView))[offset];
 }
 
-/// access position, including range checking
-unsigned char memory_mapped_file::at(size_t offset) const
+uint8_t memory_mapped_file::at(size_t offset) const
 {
     // checks
-    if (!_mappedView)
-        throw std::invalid_argument("No view mapped");
-    if (offset >= _filesize)
-        throw std::out_of_range("View is not large enough");
-
+    if (!m_mappedFileView)
+    {
+        ABC_FAIL("No view mapped");
+    }
+    if (offset >= m_mappedBytes)
+    {
+        ABC_FAIL("View is not large enough");
+    }
     return operator[](offset);
 }
 
-/// raw access
-const unsigned char* memory_mapped_file::getData() const
+const uint8_t* memory_mapped_file::getData(size_t offset) const
+{
+    return static_cast<const uint8_t*>(m_mappedFileView) + offset;
+}
+
+uint8_t* memory_mapped_file::getData(size_t offset)
 {
-    return (const unsigned char*)_mappedView;
+    return static_cast<uint8_t*>(m_mappedFileView) + offset;
 }
 
-/// true, if file successfully opened
-bool memory_mapped_file::isValid() const { return _mappedView != NULL; }
+bool memory_mapped_file::is_open() const { return m_mappedFileView != nullptr; }
 
-/// get file size
-size_t memory_mapped_file::size() const { return _filesize; }
+size_t memory_mapped_file::size() const { return m_filesize; }
 
-/// get number of actually mapped bytes
-size_t memory_mapped_file::mappedSize() const { return _mappedBytes; }
+size_t memory_mapped_file::mapped_size() const { return m_mappedBytes; }
 
 /// replace mapping by a new one of the same file, offset MUST be a multiple of the page size
-bool memory_mapped_file::remap(size_t offset, size_t mappedBytes)
+memory_mapped_file::remap_result memory_mapped_file::remap(size_t offset, size_t mappedBytes)
 {
-    if (!_file)
-        return false;
-
-    if (mappedBytes == WholeFile)
-        mappedBytes = _filesize;
-
-    // close old mapping
-    if (_mappedView)
+    if (m_impl->m_file < 0)
     {
-#    ifdef _MSC_VER
-        ::UnmapViewOfFile(_mappedView);
-#    else
-        ::munmap(_mappedView, _mappedBytes);
-#    endif
-        _mappedView = NULL;
+        return remap_error(RemapErrorCode::InvalidParameters, "Invalid file handle");
     }
-
-    // don't go further than end of file
-    if (offset > _filesize)
-        return false;
-    if (offset + mappedBytes > _filesize)
-        mappedBytes = size_t(_filesize - offset);
-
-#    ifdef _MSC_VER
-    // Windows
-
-    DWORD offsetLow  = DWORD(offset & 0xFFFFFFFF);
-    DWORD offsetHigh = DWORD(offset >> 32);
-    _mappedBytes     = mappedBytes;
-
-    // get memory address
-    _mappedView = ::MapViewOfFile(_mappedFile, FILE_MAP_READ, offsetHigh, offsetLow, mappedBytes);
-
-    if (_mappedView == NULL)
+    if (mappedBytes == static_cast<size_t>(map_range::whole))
+    {
+        mappedBytes = m_filesize;
+    }
+    if (m_mappedFileView != nullptr)
     {
-        _mappedBytes = 0;
-        _mappedView  = NULL;
-        return false;
+        ::munmap(m_mappedFileView, m_mappedBytes);
+        m_mappedFileView = nullptr;
     }
 
-    return true;
-
-#    else
-
-    // Linux
-    // new mapping
-    _mappedView = ::mmap64(NULL, mappedBytes, PROT_READ, MAP_SHARED, _file, offset);
-    if (_mappedView == MAP_FAILED)
+    if (offset > m_filesize)
     {
-        _mappedBytes = 0;
-        _mappedView  = NULL;
-        return false;
+        return remap_error(
+            RemapErrorCode::InvalidParameters,
+            abc::format("Invalid parameters: offset({}) is bigger than file size({})", offset,
+                        m_filesize));
+    }
+    if (offset + mappedBytes > m_filesize)
+    {
+        mappedBytes = size_t(m_filesize - offset);
     }
 
-    _mappedBytes = mappedBytes;
-
-    // tweak performance
-    int linuxHint = 0;
-    switch (_hint)
+    const int protection = [&]() -> int {
+        switch (m_access)
+        {
+            case access_type::read:      return PROT_READ;
+            case access_type::write:     return PROT_WRITE;
+            case access_type::readwrite: return PROT_READ | PROT_WRITE;
+            //default:
+        }
+        ABC_FAIL("not supported");
+        return 0;
+    }();
+    void* view = ::mmap(nullptr, mappedBytes, protection, MAP_SHARED, m_impl->m_file,
+                        static_cast<off_t>(offset));
+    if (view == MAP_FAILED)
     {
-        case Normal:
-            linuxHint = MADV_NORMAL;
-            break;
-        case SequentialScan:
-            linuxHint = MADV_SEQUENTIAL;
-            break;
-        case RandomAccess:
-            linuxHint = MADV_RANDOM;
-            break;
-        default:
-            break;
+        m_mappedBytes = 0;
+        return remap_error(RemapErrorCode::InvalidParameters,
+                           abc::format("Couldn't create the map view of the file"));
     }
-    // assume that file will be accessed soon
-    // linuxHint |= MADV_WILLNEED;
-    // assume that file will be large
-    // linuxHint |= MADV_HUGEPAGE;
+    m_mappedFileView = view;
+    m_mappedBytes    = mappedBytes;
 
-    ::madvise(_mappedView, _mappedBytes, linuxHint);
+    const int advice = [&]() -> int {
+        switch (m_cacheHint)
+        {
+            case cache_hint::normal:     return MADV_NORMAL;
+            case cache_hint::sequential: return MADV_SEQUENTIAL;
+            case cache_hint::random:     return MADV_RANDOM;
+            //default:
+        }
+        ABC_FAIL("not supported");
+        return 0;
+    }();
+    ::madvise(m_mappedFileView, m_mappedBytes, advice);
 
-    return true;
-#    endif
+    return abc::success;
 }
 
-/// get OS page size (for remap)
-size_t memory_mapped_file::get_page_size()
+size_t memory_mapped_file::get_page_size() const
 {
-#    ifdef _MSC_VER
-    SYSTEM_INFO sysInfo;
-    GetSystemInfo(&sysInfo);
-    return sysInfo.dwAllocationGranularity;
-#    else
-    return sysconf(_SC_PAGESIZE);  //::getpagesize();
-#    endif
+    return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
 }
 
-// Linux
+// POSIX
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,185 @@
+#include "abc/perf_counters.hpp"
+
+#include "abc/core.hpp"
+
+#if defined(ABC_PLATFORM_LINUX_FAMILY) || defined(ABC_PLATFORM_ANDROID_FAMILY)
+#    define ABC_PERF_EVENTS_SUPPORTED
+#    include <linux/perf_event.h>
+#    include <sys/ioctl.h>
+#    include <sys/mman.h>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+
+#    include <cerrno>
+#    include <cstring>
+#endif
+
+namespace abc {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+const char*
+get_perf_counter_name(perf_counter counter)
+{
+    switch (counter) {
+        case perf_counter::cycles: return "cycles";
+        case perf_counter::instructions: return "instructions";
+        case perf_counter::cache_misses: return "llc-misses";
+        case perf_counter::branch_misses: return "branch-misses";
+        default: return "unknown";
+    }
+}
+
+#if defined(ABC_PERF_EVENTS_SUPPORTED)
+namespace {
+int
+open_counter(uint64_t config, int groupFd)
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size           = sizeof(attributes);
+    attributes.type           = PERF_TYPE_HARDWARE;
+    attributes.config         = config;
+    attributes.disabled       = groupFd < 0 ? 1 : 0;   // the leader starts the whole group
+    attributes.exclude_kernel = 1;                     // allowed up to perf_event_paranoid 2
+    attributes.exclude_hv     = 1;
+    attributes.read_format    = PERF_FORMAT_GROUP;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, groupFd, 0));
+}
+
+#    if defined(ABC_PLATFORM_ARCHITECTURE_AMD64) || defined(ABC_PLATFORM_ARCHITECTURE_X86)
+inline uint64_t
+read_pmc(uint32_t counter)
+{
+    uint32_t low  = 0;
+    uint32_t high = 0;
+    __asm__ __volatile__("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+#    endif
+}   // namespace
+#endif
+
+std::unique_ptr<perf_counter_group>
+perf_counter_group::open()
+{
+#if defined(ABC_PERF_EVENTS_SUPPORTED)
+    static const uint64_t k_configs[k_perfCounterCount] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    std::unique_ptr<perf_counter_group> group(new perf_counter_group());
+    group->m_fds[0] = open_counter(k_configs[0], -1);
+    if (group->m_fds[0] < 0) {
+        return nullptr;   // errno tells why
+    }
+    for (size_t i = 1; i < k_perfCounterCount; ++i) {
+        group->m_fds[i] = open_counter(k_configs[i], group->m_fds[0]);
+    }
+
+    // user space reads only need the counter index the kernel publishes in each event's first page
+    const long pageSize = ::sysconf(_SC_PAGESIZE);
+    group->m_rdpmc      = true;
+    for (size_t i = 0; i < k_perfCounterCount; ++i) {
+        if (group->m_fds[i] < 0) {
+            continue;
+        }
+        void* page = ::mmap(nullptr, static_cast<size_t>(pageSize), PROT_READ, MAP_SHARED, group->m_fds[i], 0);
+        if (page == MAP_FAILED) {
+            group->m_rdpmc = false;
+            continue;
+        }
+        group->m_pages[i] = page;
+        group->m_rdpmc    = group->m_rdpmc && static_cast<const perf_event_mmap_page*>(page)->cap_user_rdpmc;
+    }
+#    if !defined(ABC_PLATFORM_ARCHITECTURE_AMD64) && !defined(ABC_PLATFORM_ARCHITECTURE_X86)
+    group->m_rdpmc = false;
+#    endif
+
+    ::ioctl(group->m_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    if (::ioctl(group->m_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) != 0) {
+        return nullptr;
+    }
+    return group;
+#else
+    return nullptr;
+#endif
+}
+
+perf_counter_group::~perf_counter_group()
+{
+#if defined(ABC_PERF_EVENTS_SUPPORTED)
+    const long pageSize = ::sysconf(_SC_PAGESIZE);
+    for (size_t i = k_perfCounterCount; i-- > 0;) {   // members before their leader
+        if (m_pages[i] != nullptr) {
+            ::munmap(m_pages[i], static_cast<size_t>(pageSize));
+        }
+        if (m_fds[i] >= 0) {
+            ::close(m_fds[i]);
+        }
+    }
+#endif
+}
+
+bool
+perf_counter_group::read(values& out) const
+{
+#if defined(ABC_PERF_EVENTS_SUPPORTED)
+    if (m_rdpmc && read_rdpmc(out)) {
+        return true;
+    }
+
+    // PERF_FORMAT_GROUP: nr, then the values in the order the counters joined the group
+    uint64_t      buffer[1 + k_perfCounterCount] = {};
+    const ssize_t size                           = ::read(m_fds[0], buffer, sizeof(buffer));
+    if (size < static_cast<ssize_t>(sizeof(uint64_t))) {
+        return false;
+    }
+    size_t value = 1;
+    for (size_t i = 0; i < k_perfCounterCount; ++i) {
+        out.counts[i] = m_fds[i] >= 0 && value <= buffer[0] ? buffer[value++] : 0;
+    }
+    return true;
+#else
+    ABC_UNUSED(out);
+    return false;
+#endif
+}
+
+bool
+perf_counter_group::read_rdpmc(values& out) const
+{
+#if defined(ABC_PERF_EVENTS_SUPPORTED) \
+    && (defined(ABC_PLATFORM_ARCHITECTURE_AMD64) || defined(ABC_PLATFORM_ARCHITECTURE_X86))
+    for (size_t i = 0; i < k_perfCounterCount; ++i) {
+        if (m_pages[i] == nullptr) {
+            out.counts[i] = 0;
+            continue;
+        }
+        // the page is a seqlock updated by the kernel whenever the event is scheduled
+        const volatile perf_event_mmap_page* page = static_cast<const volatile perf_event_mmap_page*>(m_pages[i]);
+        uint32_t                             sequence = 0;
+        uint64_t                             count    = 0;
+        do {
+            sequence = page->lock;
+            __asm__ __volatile__("" ::: "memory");
+            const uint32_t index = page->index;
+            if (!page->cap_user_rdpmc || index == 0) {
+                return false;   // not running on a hardware counter right now, read() knows the total
+            }
+            const unsigned shift = 64u - page->pmc_width;
+            const int64_t  pmc   = static_cast<int64_t>(read_pmc(index - 1) << shift) >> shift;
+            count                = static_cast<uint64_t>(page->offset + pmc);
+            __asm__ __volatile__("" ::: "memory");
+        } while (page->lock != sequence);
+        out.counts[i] = count;
+    }
+    return true;
+#else
+    ABC_UNUSED(out);
+    return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace abc
@@ -0,0 +1,801 @@
+#include "abc/profiler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace abc {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+///@brief: merges the thread's samples into the profiler when the thread exits
+struct thread_samples_holder {
+    profiler::thread_samples* samples = nullptr;
+
+    ~thread_samples_holder()
+    {
+        if (samples != nullptr) {
+            profiler::GetInstance().release_thread_samples(samples);
+        }
+    }
+};
+
+namespace {
+thread_local thread_samples_holder t_samplesHolder;
+
+abc::string
+format_duration(const abc::chrono::duration& duration)
+{
+    if (duration >= abc::chrono::seconds(1)) {
+        return ABC_FORMAT("{} s", std::chrono::duration_cast<abc::chrono::secondsf>(duration).count());
+    } else if (duration >= abc::chrono::milliseconds(1)) {
+        return ABC_FORMAT("{} ms", std::chrono::duration_cast<abc::chrono::millisecondsf>(duration).count());
+    } else {
+        return ABC_FORMAT("{} us", std::chrono::duration_cast<abc::chrono::microsecondsf>(duration).count());
+    }
+}
+}   // namespace
+
+profiler::trace_ring::trace_ring(size_t capacity, uint32_t threadIndex)
+    : m_threadIndex(threadIndex)
+{
+    size_t powerOfTwo = 16;
+    while (powerOfTwo < capacity) {
+        powerOfTwo <<= 1;
+    }
+    m_events = std::vector<event>(powerOfTwo);
+    m_mask   = powerOfTwo - 1;
+}
+
+profiler::thread_samples::thread_samples(uint32_t threadIndex)
+    : m_threadIndex(threadIndex)
+{
+    // scopes only allocate when a thread's call paths outgrow the first pool
+    m_nodes[0].store(new call_node[k_nodeChunkSize], std::memory_order_release);
+}
+
+profiler::thread_samples::~thread_samples()
+{
+    for (std::atomic<tag_stats*>& chunk : m_chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+    for (std::atomic<call_node*>& chunk : m_nodes) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+profiler::trace_ring&
+profiler::thread_samples::allocate_trace(size_t capacity)
+{
+    m_traceOwner = std::make_shared<trace_ring>(capacity, m_threadIndex);
+    m_trace.store(m_traceOwner.get(), std::memory_order_release);
+    return *m_traceOwner;
+}
+
+profiler::tag_stats*
+profiler::thread_samples::allocate_chunk(size_t index)
+{
+    const internal_scope internal(*this);   // add_locked_time gets its stats outside of a zone
+    tag_stats*           chunk = new tag_stats[k_chunkSize];
+    m_chunks[index].store(chunk, std::memory_order_release);
+    return chunk;
+}
+
+uint32_t
+profiler::thread_samples::create_node(tag_id id)
+{
+    const uint32_t index = m_nodeCount;
+    const size_t   chunk = index / k_nodeChunkSize;
+    if (chunk >= k_maxNodeChunks) {
+        return call_node::k_none;
+    }
+    if (m_nodes[chunk].load(std::memory_order_relaxed) == nullptr) {
+        m_nodes[chunk].store(new call_node[k_nodeChunkSize], std::memory_order_release);
+    }
+    ++m_nodeCount;
+
+    const uint32_t current = m_current.load(std::memory_order_relaxed);
+    call_node&     child   = node(index);
+    call_node&     parent  = node(current);
+    child.tag              = id;
+    child.parent           = current;
+    child.nextSibling.store(parent.firstChild.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    parent.firstChild.store(index, std::memory_order_release);
+    return index;
+}
+
+void
+profiler::thread_samples::reset(tag_id id)
+{
+    tag_stats* chunk = m_chunks[id / k_chunkSize].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        return;
+    }
+    tag_stats& stats = chunk[id % k_chunkSize];
+    stats.accum.store(0, std::memory_order_relaxed);
+    stats.min.store(std::numeric_limits<duration::rep>::max(), std::memory_order_relaxed);
+    stats.max.store(0, std::memory_order_relaxed);
+    stats.locked.store(0, std::memory_order_relaxed);
+    stats.samples.store(0, std::memory_order_relaxed);
+    stats.locks.store(0, std::memory_order_relaxed);
+    stats.allocations.store(0, std::memory_order_relaxed);
+    stats.allocatedBytes.store(0, std::memory_order_relaxed);
+    stats.deallocations.store(0, std::memory_order_relaxed);
+    log_linear_histogram* histogram = stats.histogram.load(std::memory_order_relaxed);
+    if (histogram != nullptr) {
+        histogram->reset();
+    }
+    rolling_window* window = stats.window.load(std::memory_order_relaxed);
+    if (window != nullptr) {
+        window->reset();
+    }
+    counter_stats* counters = stats.counters.load(std::memory_order_relaxed);
+    if (counters != nullptr) {
+        for (std::atomic<uint64_t>& sum : counters->sums) {
+            sum.store(0, std::memory_order_relaxed);
+        }
+        counters->samples.store(0, std::memory_order_relaxed);
+    }
+}
+
+void
+profiler::thread_samples::reset_child(tag_id id)
+{
+    call_node& current = node(m_current.load(std::memory_order_relaxed));
+    for (uint32_t index = current.firstChild.load(std::memory_order_relaxed); index != call_node::k_none;
+         index = node(index).nextSibling.load(std::memory_order_relaxed)) {
+        call_node& child = node(index);
+        if (child.tag != id) {
+            continue;
+        }
+        add_relaxed(current.children, -child.inclusive.load(std::memory_order_relaxed));
+        child.inclusive.store(0, std::memory_order_relaxed);
+        child.children.store(0, std::memory_order_relaxed);
+        child.calls.store(0, std::memory_order_relaxed);
+        child.sampled.store(0, std::memory_order_relaxed);
+        child.allocations.store(0, std::memory_order_relaxed);
+        child.allocatedBytes.store(0, std::memory_order_relaxed);
+        child.deallocations.store(0, std::memory_order_relaxed);
+        return;
+    }
+}
+
+profiler::thread_samples&
+profiler::create_thread_samples()
+{
+    thread_samples* samples = nullptr;
+    {
+        profiler&                   instance = GetInstance();
+        std::lock_guard<std::mutex> lock(instance.m_mutex);
+        samples = new thread_samples(instance.m_threadCount++);
+        instance.m_threads.push_back(samples);
+        instance.attach_sampler(*samples);
+    }
+    profiler_tls<thread_samples>::value = samples;
+    t_samplesHolder.samples             = samples;
+    return *samples;
+}
+
+void
+profiler::release_thread_samples(thread_samples* samples)
+{
+    // runs on the exiting thread, a sampler signal still pending for it must not find the samples anymore
+    profiler_tls<thread_samples>::value = nullptr;
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (tag_id id = 0; id < m_samples.size(); ++id) {
+            const tag_stats* stats = samples->find(id);
+            if (stats != nullptr && is_current(*stats, id)) {
+                m_samples[id].merge(*stats);
+            }
+        }
+        detach_sampler(*samples);
+        merge_call_tree(m_callTree, *samples, 0);
+        std::shared_ptr<trace_ring> trace = samples->release_trace();
+        if (trace != nullptr) {
+            m_traces.push_back(std::move(trace));
+        }
+        while (m_traces.size() > m_traceExitedThreads.load(std::memory_order_relaxed)) {
+            m_traces.pop_front();   // a ring is megabytes, threads that come and go must not accumulate them
+        }
+        m_threads.erase(std::remove(m_threads.begin(), m_threads.end(), samples), m_threads.end());
+    }
+    delete samples;
+}
+
+profiler::ProfilingData::ProfilingData(const ProfilingData& other)
+    : tag(other.tag)
+    , accumDuration(other.accumDuration)
+    , minDuration(other.minDuration)
+    , maxDuration(other.maxDuration)
+    , samples(other.samples)
+    , mt_lockedTime(other.mt_lockedTime)
+    , locks(other.locks)
+    , histogram(other.histogram != nullptr ? new log_linear_histogram(*other.histogram) : nullptr)
+    , counterSamples(other.counterSamples)
+    , allocations(other.allocations)
+    , window(other.window != nullptr ? new rolling_window(*other.window) : nullptr)
+{
+    std::copy(other.counters, other.counters + k_perfCounterCount, counters);
+}
+
+profiler::ProfilingData&
+profiler::ProfilingData::operator=(const ProfilingData& other)
+{
+    if (this != &other) {
+        ProfilingData copy(other);
+        tag           = std::move(copy.tag);
+        accumDuration = copy.accumDuration;
+        minDuration   = copy.minDuration;
+        maxDuration   = copy.maxDuration;
+        samples       = copy.samples;
+        mt_lockedTime = copy.mt_lockedTime;
+        locks         = copy.locks;
+        histogram     = std::move(copy.histogram);
+        std::copy(copy.counters, copy.counters + k_perfCounterCount, counters);
+        counterSamples = copy.counterSamples;
+        allocations    = copy.allocations;
+        window         = std::move(copy.window);
+    }
+    return *this;
+}
+
+void
+profiler::ProfilingData::merge(const tag_stats& stats)
+{
+    const size_t count     = static_cast<size_t>(stats.samples.load(std::memory_order_relaxed));
+    const size_t lockCount = static_cast<size_t>(stats.locks.load(std::memory_order_relaxed));
+    if (count == 0 && lockCount == 0) {
+        return;
+    }
+    accumDuration += duration(stats.accum.load(std::memory_order_relaxed));
+    minDuration = std::min(minDuration, duration(stats.min.load(std::memory_order_relaxed)));
+    maxDuration = std::max(maxDuration, duration(stats.max.load(std::memory_order_relaxed)));
+    mt_lockedTime += duration(stats.locked.load(std::memory_order_relaxed));
+    samples += count;
+    locks += lockCount;
+    allocations.allocations += stats.allocations.load(std::memory_order_relaxed);
+    allocations.bytes += stats.allocatedBytes.load(std::memory_order_relaxed);
+    allocations.deallocations += stats.deallocations.load(std::memory_order_relaxed);
+
+    const log_linear_histogram* statsHistogram = stats.histogram.load(std::memory_order_acquire);
+    if (statsHistogram != nullptr) {
+        if (histogram == nullptr) {
+            histogram.reset(new log_linear_histogram());
+        }
+        histogram->merge(*statsHistogram);
+    }
+
+    const rolling_window* statsWindow = stats.window.load(std::memory_order_acquire);
+    if (statsWindow != nullptr) {
+        if (window == nullptr) {
+            window.reset(new rolling_window());
+        }
+        window->merge(*statsWindow);
+    }
+
+    const counter_stats* statsCounters = stats.counters.load(std::memory_order_acquire);
+    if (statsCounters != nullptr) {
+        for (size_t i = 0; i < k_perfCounterCount; ++i) {
+            counters[i] += statsCounters->sums[i].load(std::memory_order_relaxed);
+        }
+        counterSamples += statsCounters->samples.load(std::memory_order_relaxed);
+    }
+}
+
+profiler::sample_container_t
+profiler::collect()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sample_container_t          result = m_samples;
+    for (const thread_samples* samples : m_threads) {
+        fold_backtraces(*samples);   // before the sampler's ring wraps, the summaries and publishes are periodic
+        for (tag_id id = 0; id < result.size(); ++id) {
+            const tag_stats* stats = samples->find(id);
+            if (stats != nullptr && is_current(*stats, id)) {
+                result[id].merge(*stats);
+            }
+        }
+    }
+    return result;
+}
+
+void
+profiler::merge_call_tree(call_tree& tree, const thread_samples& samples, uint32_t index)
+{
+    const call_node& node = samples.node(index);
+    tree.inclusive += duration(node.inclusive.load(std::memory_order_relaxed));
+    tree.children += duration(node.children.load(std::memory_order_relaxed));
+    tree.calls += node.calls.load(std::memory_order_relaxed);
+    tree.sampled += node.sampled.load(std::memory_order_relaxed);
+    tree.allocations.allocations += node.allocations.load(std::memory_order_relaxed);
+    tree.allocations.bytes += node.allocatedBytes.load(std::memory_order_relaxed);
+    tree.allocations.deallocations += node.deallocations.load(std::memory_order_relaxed);
+
+    for (uint32_t child = node.firstChild.load(std::memory_order_acquire); child != call_node::k_none;
+         child = samples.node(child).nextSibling.load(std::memory_order_relaxed)) {
+        const tag_id tag = samples.node(child).tag;
+        auto         it  = std::find_if(
+            tree.nodes.begin(), tree.nodes.end(), [tag](const call_tree& node) { return node.tag == tag; });
+        if (it == tree.nodes.end()) {
+            tree.nodes.emplace_back();
+            it      = tree.nodes.end() - 1;
+            it->tag = tag;
+        }
+        merge_call_tree(*it, samples, child);
+    }
+}
+
+profiler::call_tree
+profiler::collect_call_tree()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    call_tree                   result = m_callTree;
+    for (const thread_samples* samples : m_threads) {
+        merge_call_tree(result, *samples, 0);
+    }
+    return result;
+}
+
+void
+profiler::print_call_tree(const call_tree& tree, const sample_container_t& samples, size_t depth) const
+{
+    std::vector<const call_tree*> nodes;
+    for (const call_tree& node : tree.nodes) {
+        nodes.push_back(&node);
+    }
+    std::sort(nodes.begin(), nodes.end(),
+        [](const call_tree* lhs, const call_tree* rhs) { return lhs->inclusive > rhs->inclusive; });
+
+    for (const call_tree* node : nodes) {
+        // a thread still in its first call, or a tag registered after the samples were collected
+        if (node->calls == 0 || node->tag >= samples.size()) {
+            continue;
+        }
+        const abc::string allocations = node->allocations.allocations != 0
+            ? ABC_FORMAT(" allocs({}) bytes({})", node->allocations.allocations, node->allocations.bytes)
+            : abc::string();
+        std::cout << ABC_FORMAT("{}{} : incl({}) excl({}){}#[{}]", abc::string(depth * 2, ' '),
+            samples[node->tag].tag, format_duration(node->inclusive), format_duration(node->inclusive - node->children),
+            allocations, node->calls)
+                  << std::endl;
+        print_call_tree(*node, samples, depth + 1);
+    }
+}
+
+namespace {
+///@brief: trace_event timestamps are microseconds, the fraction keeps the nanoseconds
+void
+append_microseconds(abc::string& out, abc::chrono::duration duration)
+{
+    const int64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    out += ABC_FORMAT("{}.{:03}", nanoseconds / 1000, nanoseconds % 1000);
+}
+}   // namespace
+
+bool
+profiler::write_trace(const abc::string& path)
+{
+    // the rings are shared rather than copied, the lock is only held to list them: a ring dropped or released
+    // by its exiting thread meanwhile stays alive until written, and the thread keeps recording into its own
+    std::vector<std::shared_ptr<const trace_ring>> rings;
+    std::vector<abc::string>                       tags;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        rings.assign(m_traces.begin(), m_traces.end());
+        for (const thread_samples* samples : m_threads) {
+            std::shared_ptr<const trace_ring> trace = samples->share_trace();
+            if (trace != nullptr) {
+                rings.push_back(std::move(trace));
+            }
+        }
+        tags.reserve(m_samples.size());
+        for (const ProfilingData& data : m_samples) {
+            tags.push_back(data.tag);
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    // events are formatted into a small buffer flushed as it fills, the trace is never held in memory
+    constexpr size_t k_flushSize = 64 * 1024;
+    abc::string      buffer;
+    bool             ok        = true;
+    bool             separator = false;
+    const auto       flush     = [&]() {
+        ok = ok && std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        buffer.clear();
+    };
+
+    buffer += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (const std::shared_ptr<const trace_ring>& trace : rings) {
+        const uint32_t tid = trace->get_thread_index();
+        buffer += ABC_FORMAT("{}\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},"
+                             "\"args\":{{\"name\":\"thread {}\"}}}",
+            separator ? "," : "", tid, tid);
+        separator = true;
+        trace->for_each([&](tag_id id, time_point begin, time_point end, uint64_t allocations, uint64_t bytes) {
+            buffer += ",\n{\"name\":";
+            append_json_string(buffer, id < tags.size() ? tags[id] : abc::string());
+            buffer += ABC_FORMAT(",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":", tid);
+            append_microseconds(buffer, begin.time_since_epoch());
+            buffer += ",\"dur\":";
+            append_microseconds(buffer, end - begin);
+            if (allocations != 0) {
+                buffer += ABC_FORMAT(",\"args\":{{\"allocations\":{},\"bytes\":{}}}", allocations, bytes);
+            }
+            buffer += '}';
+            if (buffer.size() >= k_flushSize) {
+                flush();
+            }
+        });
+    }
+    buffer += "\n]}\n";
+    flush();
+
+    return std::fclose(file) == 0 && ok;
+}
+
+bool
+profiler::enable_counters()
+{
+    if (get_thread_samples().get_perf_counters() == nullptr) {
+        ABC_LOG_WARNING("Hardware counters are not available ({}), perf events may be restricted by "
+                        "perf_event_paranoid, seccomp or a virtual machine without PMU",
+            std::strerror(errno));
+        return false;
+    }
+    m_countersEnabled.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void
+profiler::add_counters(
+    tag_stats& stats, const perf_counter_group::values& begin, const perf_counter_group::values& end)
+{
+    counter_stats* counters = stats.counters.load(std::memory_order_relaxed);
+    if (counters == nullptr) {
+        counters = new counter_stats();
+        stats.counters.store(counters, std::memory_order_release);
+    }
+    for (size_t i = 0; i < k_perfCounterCount; ++i) {
+        counters->sums[i].store(counters->sums[i].load(std::memory_order_relaxed) + (end.counts[i] - begin.counts[i]),
+            std::memory_order_relaxed);
+    }
+    counters->samples.store(counters->samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+bool
+profiler::get_histogram(const abc::string& tag, log_linear_histogram& histogram)
+{
+    tag_id id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto                  it = m_tagIds.find(tag);
+        if (it == m_tagIds.end()) {
+            return false;
+        }
+        id = it->second;
+    }
+    const sample_container_t samples = collect();
+    if (!m_histogramTags[id].load(std::memory_order_relaxed)) {
+        return false;
+    }
+    histogram.reset();
+    if (samples[id].histogram != nullptr) {
+        histogram.merge(*samples[id].histogram);
+    }
+    return true;
+}
+
+bool
+profiler::get_window(const abc::string& tag, std::chrono::seconds seconds, rolling_window::stats& stats)
+{
+    tag_id id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto                  it = m_tagIds.find(tag);
+        if (it == m_tagIds.end()) {
+            return false;
+        }
+        id = it->second;
+    }
+    if (!m_windowTags[id].load(std::memory_order_relaxed)) {
+        return false;
+    }
+    const sample_container_t samples = collect();
+    stats                            = rolling_window::stats();
+    if (samples[id].window != nullptr && seconds.count() > 0) {
+        samples[id].window->collect(get_window_second(clock::now()), static_cast<size_t>(seconds.count()), stats);
+    }
+    return true;
+}
+
+profiler::tag_id
+profiler::register_tag(const abc::string& tag)
+{
+    std::lock_guard<std::mutex> mutexLock(m_mutex);
+    return internal_register(tag);
+}
+
+profiler::tag_id
+profiler::register_tag(const char* tag)
+{
+    // call sites register on their first run, which must not be charged to the zone they are nested in
+    thread_samples* samples = profiler_tls<thread_samples>::value;
+    if (samples != nullptr) {
+        const thread_samples::internal_scope internal(*samples);
+        return register_tag(abc::string(tag));
+    }
+    return register_tag(abc::string(tag));
+}
+
+profiler::tag_id
+profiler::cache_tag(thread_samples& samples, const abc::string& tag)
+{
+    // ids are never reused, the cache stays valid for the thread's lifetime
+    const thread_samples::internal_scope internal(samples);
+    const tag_id                         id = register_tag(tag);
+    samples.get_tag_cache().emplace(tag, id);
+    return id;
+}
+
+profiler::tag_id
+profiler::internal_register(const abc::string& tag)
+{
+    const auto it = m_tagIds.find(tag);
+    if (it != m_tagIds.end()) {
+        return it->second;
+    }
+    const tag_id id = static_cast<tag_id>(m_samples.size());
+    m_samples.emplace_back(tag);
+    m_tagIds.emplace(tag, id);
+    return id;
+}
+
+void
+profiler::declare(const abc::string& tag, bool reset)
+{
+    std::lock_guard<std::mutex> mutexLock(m_mutex);
+    const auto                  it = m_tagIds.find(tag);
+    if (it == m_tagIds.end()) {
+        internal_register(tag);
+    } else {
+        if (reset) {
+            // only the owner writes its samples, running threads clear theirs on their next record
+            m_samples[it->second] = ProfilingData(tag);
+            m_resetGenerations[it->second].fetch_add(1, std::memory_order_release);
+        } else {
+            ABC_LOG_DEBUG("Call to profiler::declare({}) failed because the tag is already registered", tag);
+        }
+    }
+}
+
+namespace {
+constexpr size_t k_calibrationRounds = 15;
+constexpr size_t k_calibrationZones  = 256;   // per round
+
+profiler::duration::rep
+get_median(std::vector<profiler::duration::rep>& values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+}   // namespace
+
+void
+profiler::calibrate()
+{
+    const tag_id    zoneId        = register_tag("abc_profiler_calibration_zone");
+    const tag_id    scopeId       = register_tag("abc_profiler_calibration_scope");
+    const bool      compensating  = m_compensateOverhead.exchange(false, std::memory_order_relaxed);
+    const size_t    traceCapacity = m_traceCapacity.exchange(0, std::memory_order_relaxed);
+    thread_samples& samples       = get_thread_samples();
+
+    // rounds of back to back empty zones: what they measured themselves, and what timing the whole round saw.
+    // The median round ignores the ones a preemption or an interrupt landed in.
+    std::vector<duration::rep> zone, zoneNested, scope, scopeNested;
+    const duration::rep        count = static_cast<duration::rep>(k_calibrationZones);
+    for (size_t round = 0; round <= k_calibrationRounds; ++round) {   // round 0 allocates the statistics
+        const tag_stats&    zoneStats  = samples.get(zoneId);
+        const duration::rep zoneAccum  = zoneStats.accum.load(std::memory_order_relaxed);
+        const time_point    zoneStart  = clock::now();
+        for (size_t i = 0; i < k_calibrationZones; ++i) {
+            tick(zoneId);
+            tock(zoneId);
+        }
+        const duration::rep zoneTotal  = (clock::now() - zoneStart).count();
+        const tag_stats&    scopeStats = samples.get(scopeId);
+        const duration::rep scopeAccum = scopeStats.accum.load(std::memory_order_relaxed);
+        const time_point    scopeStart = clock::now();
+        for (size_t i = 0; i < k_calibrationZones; ++i) {
+            const profile_scope empty(scopeId);
+        }
+        const duration::rep scopeTotal = (clock::now() - scopeStart).count();
+        if (round != 0) {
+            zone.push_back((zoneStats.accum.load(std::memory_order_relaxed) - zoneAccum) / count);
+            zoneNested.push_back(zoneTotal / count);
+            scope.push_back((scopeStats.accum.load(std::memory_order_relaxed) - scopeAccum) / count);
+            scopeNested.push_back(scopeTotal / count);
+        }
+    }
+    m_zoneOverhead.store(get_median(zone), std::memory_order_relaxed);
+    m_zoneNestedOverhead.store(get_median(zoneNested), std::memory_order_relaxed);
+    m_scopeOverhead.store(get_median(scope), std::memory_order_relaxed);
+    m_scopeNestedOverhead.store(get_median(scopeNested), std::memory_order_relaxed);
+
+    {
+        const thread_samples::internal_scope internal(samples);
+        samples.reset(zoneId);
+        samples.reset(scopeId);
+        samples.reset_child(scopeId);
+    }
+    m_traceCapacity.store(traceCapacity, std::memory_order_relaxed);
+    m_compensateOverhead.store(compensating, std::memory_order_relaxed);
+}
+
+profiler::overhead
+profiler::get_overhead() const
+{
+    overhead result;
+    result.zone        = duration(m_zoneOverhead.load(std::memory_order_relaxed));
+    result.zoneNested  = duration(m_zoneNestedOverhead.load(std::memory_order_relaxed));
+    result.scope       = duration(m_scopeOverhead.load(std::memory_order_relaxed));
+    result.scopeNested = duration(m_scopeNestedOverhead.load(std::memory_order_relaxed));
+    return result;
+}
+
+void
+profiler::print_summary(const std::vector<abc::string>& tagFilter)
+{
+    std::cout << "-----------------------------------------------------------------" << std::endl;
+    std::cout << "-- Profiling summary" << std::endl;
+    const overhead cost = get_overhead();
+    if (cost.zoneNested != duration(0)) {
+        // what a zone measures of itself, and in parentheses what it adds to the zones enclosing it
+        std::cout << ABC_FORMAT("-- Overhead per zone: tick/tock {} ({} nested) scope {} ({} nested){}",
+            format_duration(cost.zone), format_duration(cost.zoneNested), format_duration(cost.scope),
+            format_duration(cost.scopeNested),
+            m_compensateOverhead.load(std::memory_order_relaxed) ? ", compensated" : "")
+                  << std::endl;
+    }
+    std::cout << "-----------------------------------------------------------------" << std::endl;
+
+    const auto processSample = [](const ProfilingData& data) {
+        if (data.samples <= 0) {
+            if (data.locks > 0) {   // only used by ABC_PROFILE_LOCK_GUARD
+                std::cout << ABC_FORMAT("{} : lckd({})#[{}]", data.tag,
+                    format_duration(data.mt_lockedTime / data.locks), data.locks)
+                          << std::endl;
+            }
+            return;
+        }
+
+        const auto avgTime = data.accumDuration / data.samples;
+        if (data.samples > 1) {
+            if (data.mt_lockedTime > duration(0)) {
+                const auto lockedTime = data.mt_lockedTime / data.samples;
+                const auto avgTimeMT  = avgTime - lockedTime;
+
+                std::cout << ABC_FORMAT("{} : avg({})lckd({}) min/max({}/{})#[{}]", data.tag,
+                    format_duration(avgTimeMT), format_duration(lockedTime), format_duration(data.minDuration),
+                    format_duration(data.maxDuration), data.samples)
+                          << std::endl;
+            } else {
+                std::cout << ABC_FORMAT("{} : avg({}) min/max({}/{})#[{}]", data.tag, format_duration(avgTime),
+                    format_duration(data.minDuration), format_duration(data.maxDuration), data.samples)
+                          << std::endl;
+            }
+        } else {
+            if (data.mt_lockedTime > duration(0)) {
+                const auto& lockedTime = data.mt_lockedTime;
+                const auto  avgTimeMT  = avgTime - lockedTime;
+                std::cout << ABC_FORMAT(
+                    "{} : {} (locked: {})", data.tag, format_duration(avgTimeMT), format_duration(lockedTime))
+                          << std::endl;
+            } else {
+                std::cout << ABC_FORMAT("{} : {}", data.tag, format_duration(avgTime)) << std::endl;
+            }
+        }
+    };
+
+    const auto processHistogram = [](const ProfilingData& data) {
+        if (data.histogram == nullptr || data.histogram->get_count() == 0) {
+            return;
+        }
+        const auto percentile = [&data](double value) {
+            return format_duration(std::chrono::nanoseconds(data.histogram->get_percentile(value)));
+        };
+        std::cout << ABC_FORMAT("{} : p50({}) p90({}) p99({}) p99.9({}) max({})", data.tag, percentile(50.0),
+            percentile(90.0), percentile(99.0), percentile(99.9),
+            format_duration(std::chrono::nanoseconds(data.histogram->get_max())))
+                  << std::endl;
+    };
+
+    const auto processCounters = [](const ProfilingData& data) {
+        if (data.counterSamples == 0) {
+            return;
+        }
+        const auto perCall = [&data](perf_counter counter) {
+            return data.counters[static_cast<size_t>(counter)] / data.counterSamples;
+        };
+        const uint64_t cycles = data.counters[static_cast<size_t>(perf_counter::cycles)];
+        const double   ipc    = cycles != 0
+            ? static_cast<double>(data.counters[static_cast<size_t>(perf_counter::instructions)]) / cycles
+            : 0.0;
+        std::cout << ABC_FORMAT("{} : ipc({:.2f}) {}({}) {}({}) {}({}) {}({}) per call", data.tag, ipc,
+            get_perf_counter_name(perf_counter::cycles), perCall(perf_counter::cycles),
+            get_perf_counter_name(perf_counter::instructions), perCall(perf_counter::instructions),
+            get_perf_counter_name(perf_counter::cache_misses), perCall(perf_counter::cache_misses),
+            get_perf_counter_name(perf_counter::branch_misses), perCall(perf_counter::branch_misses))
+                  << std::endl;
+    };
+
+    const auto processAllocations = [](const ProfilingData& data) {
+        if (data.samples == 0 || (data.allocations.allocations == 0 && data.allocations.deallocations == 0)) {
+            return;
+        }
+        const double calls = static_cast<double>(data.samples);
+        std::cout << ABC_FORMAT("{} : allocs({:.2f}) frees({:.2f}) bytes({}) per call", data.tag,
+            data.allocations.allocations / calls, data.allocations.deallocations / calls,
+            data.allocations.bytes / data.samples)
+                  << std::endl;
+    };
+
+    const uint64_t now           = get_window_second(clock::now());
+    const auto     processWindow = [now](const ProfilingData& data) {
+        if (data.window == nullptr) {
+            return;
+        }
+        // rates and p99 of the last complete seconds, a regression shows here long before in the averages
+        abc::string line = data.tag + " :";
+        for (const size_t seconds : {1, 10, 60}) {
+            rolling_window::stats stats;
+            data.window->collect(now, seconds, stats);
+            line += ABC_FORMAT(" {}s({:.1f}/s p99 {})", seconds, static_cast<double>(stats.count) / seconds,
+                format_duration(std::chrono::nanoseconds(stats.values.get_percentile(99.0))));
+        }
+        std::cout << line << std::endl;
+    };
+
+    const sample_container_t samples = collect();
+    if (tagFilter.empty()) {
+        for (const auto& data : samples) {
+            processSample(data);
+            processHistogram(data);
+            processCounters(data);
+            processAllocations(data);
+            processWindow(data);
+        }
+
+        const call_tree tree = collect_call_tree();
+        if (!tree.nodes.empty()) {
+            std::cout << "-----------------------------------------------------------------" << std::endl;
+            std::cout << "-- Call tree" << std::endl;
+            std::cout << "-----------------------------------------------------------------" << std::endl;
+            print_call_tree(tree, samples, 0);
+        }
+    } else {
+        std::lock_guard<std::mutex> mutexLock(m_mutex);
+        for (const auto& tag : tagFilter) {
+            const auto it = m_tagIds.find(tag);
+            if (it != m_tagIds.end() && it->second < samples.size()) {
+                processSample(samples[it->second]);
+                processHistogram(samples[it->second]);
+                processCounters(samples[it->second]);
+                processAllocations(samples[it->second]);
+                processWindow(samples[it->second]);
+            }
+        }
+    }
+    std::cout << "-----------------------------------------------------------------" << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace abc
@@ -0,0 +1,466 @@
+#include "abc/profiler.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#if defined(ABC_PLATFORM_LINUX_FAMILY)
+#    define ABC_PROFILER_SAMPLING_SUPPORTED
+#    include <cxxabi.h>
+#    include <dlfcn.h>
+#    include <pthread.h>
+#    include <signal.h>
+#    include <sys/syscall.h>
+#    include <time.h>
+#    include <ucontext.h>
+#    include <unistd.h>
+
+#    include <cerrno>
+#    include <cstdlib>
+#endif
+
+namespace abc {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(ABC_PROFILER_SAMPLING_SUPPORTED)
+
+///@brief: sampler state of one thread. The backtraces are written by the thread's signal handler only,
+///        every slot is a small seqlock so they are read while the thread keeps running.
+struct profiler::sampler_thread {
+    static constexpr size_t k_capacity  = 1024;   // most recent backtraces kept per thread
+    static constexpr size_t k_maxFrames = 32;
+
+    struct backtrace {
+        std::atomic<uint64_t>  sequence{0};   // index + 1 once written, 0 while being written
+        std::atomic<uint32_t>  node{0};
+        std::atomic<uint32_t>  count{0};
+        std::atomic<uintptr_t> frames[k_maxFrames] = {};
+    };
+
+    pid_t                   tid;
+    pthread_t               thread;
+    uintptr_t               stackLow  = 0;
+    uintptr_t               stackHigh = 0;
+    timer_t                 timer;
+    bool                    armed = false;
+    std::atomic<backtrace*> backtraces{nullptr};   // k_capacity slots, allocated when sampling with backtraces
+    std::atomic<uint64_t>   head{0};               // backtraces pushed, written by the signal handler only
+    uint64_t                folded = 0;            // backtraces folded or dropped, under the profiler mutex
+
+    ~sampler_thread() { delete[] backtraces.load(std::memory_order_relaxed); }
+
+    void allocate_backtraces()
+    {
+        if (backtraces.load(std::memory_order_relaxed) == nullptr) {
+            backtraces.store(new backtrace[k_capacity], std::memory_order_release);
+        }
+    }
+
+    void push(uint32_t node, const uintptr_t* frames, uint32_t count)
+    {
+        backtrace* slots = backtraces.load(std::memory_order_acquire);
+        if (slots == nullptr) {
+            return;
+        }
+        const uint64_t index = head.load(std::memory_order_relaxed);
+        backtrace&     slot  = slots[index % k_capacity];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.node.store(node, std::memory_order_relaxed);
+        slot.count.store(count, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < count; ++i) {
+            slot.frames[i].store(frames[i], std::memory_order_relaxed);
+        }
+        slot.sequence.store(index + 1, std::memory_order_release);
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    ///@brief: calls func(node, frames, count) for the backtraces of the ring pushed in [first, last)
+    template <typename Func> void for_each(uint64_t first, uint64_t last, Func&& func) const
+    {
+        const backtrace* slots = backtraces.load(std::memory_order_acquire);
+        if (slots == nullptr) {
+            return;
+        }
+        uintptr_t frames[k_maxFrames];
+        for (size_t i = 0; i < k_capacity; ++i) {
+            const uint64_t sequence = slots[i].sequence.load(std::memory_order_acquire);
+            const uint32_t node     = slots[i].node.load(std::memory_order_relaxed);
+            const uint32_t count    = slots[i].count.load(std::memory_order_relaxed);
+            for (uint32_t frame = 0; frame < count && frame < k_maxFrames; ++frame) {
+                frames[frame] = slots[i].frames[frame].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const bool     stable   = slots[i].sequence.load(std::memory_order_relaxed) == sequence;
+            if (sequence > first && sequence <= last && count <= k_maxFrames && stable) {
+                func(node, frames, count);
+            }
+        }
+    }
+
+    bool arm(unsigned frequencyHz)
+    {
+        clockid_t clock;
+        if (pthread_getcpuclockid(thread, &clock) != 0) {
+            return false;
+        }
+        sigevent event{};
+        event.sigev_notify   = SIGEV_THREAD_ID;
+        event.sigev_signo    = SIGPROF;
+#    if defined(sigev_notify_thread_id)
+        event.sigev_notify_thread_id = tid;
+#    else
+        event._sigev_un._tid = tid;   // older glibc headers do not name the member of SIGEV_THREAD_ID
+#    endif
+        if (timer_create(clock, &event, &timer) != 0) {
+            return false;
+        }
+        const long       period   = 1000000000L / static_cast<long>(frequencyHz);
+        const timespec   interval = {period / 1000000000L, period % 1000000000L};
+        const itimerspec spec     = {interval, interval};
+        armed                     = true;
+        return timer_settime(timer, 0, &spec, nullptr) == 0;
+    }
+    void disarm()
+    {
+        if (armed) {
+            timer_delete(timer);
+            armed = false;
+        }
+    }
+};
+
+namespace {
+void
+handle_sampling_signal(int, siginfo_t*, void* context)
+{
+    const int                 savedErrno = errno;
+    profiler::thread_samples* samples    = profiler_tls<profiler::thread_samples>::value;
+    if (samples != nullptr) {
+        samples->sample(context);
+    }
+    errno = savedErrno;
+}
+
+bool
+install_sampling_handler()
+{
+    // installed once and kept: a signal still pending after stop_sampling must not terminate the process
+    static const bool installed = []() {
+        struct sigaction action {};
+        action.sa_sigaction = &handle_sampling_signal;
+        action.sa_flags     = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        return sigaction(SIGPROF, &action, nullptr) == 0;
+    }();
+    return installed;
+}
+
+///@brief: frame pointer walk from the interrupted context. Code built without frame pointers uses the register
+///        for anything, so a frame is only followed when it lies between the interrupted stack pointer and the top
+///        of the thread's stack, is aligned like a frame and is above the previous one.
+uint32_t
+capture_backtrace(void* context, uintptr_t stackLow, uintptr_t stackHigh, uintptr_t* frames, uint32_t maxFrames)
+{
+    const ucontext_t* userContext = static_cast<const ucontext_t*>(context);
+#    if defined(ABC_PLATFORM_ARCHITECTURE_AMD64)
+    uintptr_t pc = static_cast<uintptr_t>(userContext->uc_mcontext.gregs[REG_RIP]);
+    uintptr_t sp = static_cast<uintptr_t>(userContext->uc_mcontext.gregs[REG_RSP]);
+    uintptr_t fp = static_cast<uintptr_t>(userContext->uc_mcontext.gregs[REG_RBP]);
+#    elif defined(ABC_PLATFORM_ARCHITECTURE_ARM64)
+    uintptr_t pc = static_cast<uintptr_t>(userContext->uc_mcontext.pc);
+    uintptr_t sp = static_cast<uintptr_t>(userContext->uc_mcontext.sp);
+    uintptr_t fp = static_cast<uintptr_t>(userContext->uc_mcontext.regs[29]);
+#    else
+    ABC_UNUSED(userContext);
+    uintptr_t pc = 0;
+    uintptr_t sp = 0;
+    uintptr_t fp = 0;
+#    endif
+    constexpr uintptr_t k_frameSize = 2 * sizeof(uintptr_t);   // saved frame pointer and return address
+    uint32_t            count       = 0;
+    if (pc == 0) {
+        return 0;
+    }
+    frames[count++] = pc;
+    if (sp < stackLow || sp >= stackHigh) {
+        return count;   // running on another stack, i.e. sigaltstack or a coroutine
+    }
+    // the stack below sp may not be mapped, the ABIs keep frames 16-byte aligned
+    uintptr_t low = sp;
+    while (count < maxFrames && fp >= low && fp + k_frameSize <= stackHigh && fp % k_frameSize == 0) {
+        const uintptr_t* frame        = reinterpret_cast<const uintptr_t*>(fp);
+        const uintptr_t  next         = frame[0];
+        const uintptr_t  returnAdress = frame[1];
+        if (returnAdress == 0) {
+            break;
+        }
+        frames[count++] = returnAdress;
+        // frames grow towards higher addresses, anything else is not a frame pointer
+        low = fp + k_frameSize;
+        fp  = next;
+    }
+    return count;
+}
+
+abc::string
+get_symbol_name(uintptr_t address, bool returnAddress)
+{
+    // a return address points after the call, which may already be the next function
+    const uintptr_t lookup = returnAddress ? address - 1 : address;
+    Dl_info         info;
+    if (dladdr(reinterpret_cast<void*>(lookup), &info) == 0) {
+        return ABC_FORMAT("0x{:x}", address);
+    }
+    if (info.dli_sname != nullptr) {
+        int         status    = 0;
+        char*       demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        abc::string name      = status == 0 && demangled != nullptr ? demangled : info.dli_sname;
+        std::free(demangled);
+        return name;
+    }
+    // symbols of executables are only exported with -rdynamic, module+offset still resolves with addr2line
+    const char* module = info.dli_fname != nullptr ? std::strrchr(info.dli_fname, '/') : nullptr;
+    return ABC_FORMAT("{}+0x{:x}", module != nullptr ? module + 1 : info.dli_fname,
+        lookup - reinterpret_cast<uintptr_t>(info.dli_fbase));
+}
+}   // namespace
+
+void
+profiler::thread_samples::sample(void* signalContext)
+{
+    const uint32_t current = m_current.load(std::memory_order_relaxed);
+    add_relaxed(node(current).sampled, 1);
+
+    if (m_sampler != nullptr && m_sampler->backtraces.load(std::memory_order_relaxed) != nullptr) {
+        uintptr_t      frames[sampler_thread::k_maxFrames];
+        const uint32_t count = capture_backtrace(
+            signalContext, m_sampler->stackLow, m_sampler->stackHigh, frames, sampler_thread::k_maxFrames);
+        m_sampler->push(current, frames, count);
+    }
+}
+
+bool
+profiler::start_sampling(unsigned frequencyHz, bool backtraces)
+{
+    if (frequencyHz == 0 || !install_sampling_handler()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_samplingHz         = frequencyHz;
+    m_samplingBacktraces = backtraces;
+    bool armed           = true;
+    for (thread_samples* samples : m_threads) {
+        sampler_thread* sampler = samples->get_sampler();
+        sampler->disarm();
+        if (backtraces) {
+            sampler->allocate_backtraces();
+        }
+        armed = sampler->arm(frequencyHz) && armed;
+    }
+    return armed;
+}
+
+void
+profiler::stop_sampling()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (thread_samples* samples : m_threads) {
+        samples->get_sampler()->disarm();
+        fold_backtraces(*samples);
+    }
+    m_samplingHz = 0;
+}
+
+void
+profiler::attach_sampler(thread_samples& samples)
+{
+    sampler_thread* sampler = new sampler_thread();
+    sampler->tid            = static_cast<pid_t>(::syscall(SYS_gettid));
+    sampler->thread         = pthread_self();
+
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(sampler->thread, &attributes) == 0) {
+        void*  stack     = nullptr;
+        size_t stackSize = 0;
+        if (pthread_attr_getstack(&attributes, &stack, &stackSize) == 0) {
+            sampler->stackLow  = reinterpret_cast<uintptr_t>(stack);
+            sampler->stackHigh = sampler->stackLow + stackSize;
+        }
+        pthread_attr_destroy(&attributes);
+    }
+
+    if (m_samplingHz != 0) {
+        if (m_samplingBacktraces) {
+            sampler->allocate_backtraces();
+        }
+        sampler->arm(m_samplingHz);
+    }
+    samples.set_sampler(sampler);
+}
+
+void
+profiler::detach_sampler(thread_samples& samples)
+{
+    sampler_thread* sampler = samples.get_sampler();
+    if (sampler == nullptr) {
+        return;
+    }
+    sampler->disarm();
+    fold_backtraces(samples);
+    samples.set_sampler(nullptr);
+    delete sampler;
+}
+
+void
+profiler::fold_backtraces(const thread_samples& samples)
+{
+    sampler_thread* sampler = samples.get_sampler();
+    if (sampler == nullptr) {
+        return;
+    }
+    const uint64_t head   = sampler->head.load(std::memory_order_acquire);
+    uint64_t       folded = 0;
+    sampler->for_each(sampler->folded, head, [&](uint32_t node, const uintptr_t* frames, uint32_t count) {
+        // zones from the outermost, then the frames from the outermost
+        abc::string zones;
+        for (uint32_t index = node; index != 0; index = samples.node(index).parent) {
+            const tag_id tag  = samples.node(index).tag;
+            abc::string  name = tag < m_samples.size() ? m_samples[tag].tag : abc::string("?");
+            zones             = zones.empty() ? name : name + ";" + zones;
+        }
+        abc::string stack = zones;
+        for (uint32_t frame = count; frame-- > 0;) {
+            stack += stack.empty() ? "" : ";";
+            stack += get_cached_symbol_name(frames[frame], frame != 0);
+        }
+        ++m_foldedBacktraces[stack.empty() ? abc::string("[no zone]") : stack];
+        ++folded;
+    });
+    // overwritten before this fold, or being written while it ran
+    m_droppedBacktraces += head - sampler->folded - folded;
+    sampler->folded = head;
+}
+
+const abc::string&
+profiler::get_cached_symbol_name(uintptr_t address, bool returnAddress)
+{
+    // user space addresses leave the top bit free for the kind of address
+    const uintptr_t key = (address << 1) | (returnAddress ? 1 : 0);
+    auto            it  = m_symbolNames.find(key);
+    if (it == m_symbolNames.end()) {
+        it = m_symbolNames.emplace(key, get_symbol_name(address, returnAddress)).first;
+    }
+    return it->second;
+}
+
+#else
+
+struct profiler::sampler_thread {
+};
+
+void
+profiler::thread_samples::sample(void*)
+{
+}
+
+bool
+profiler::start_sampling(unsigned, bool)
+{
+    return false;
+}
+
+void
+profiler::stop_sampling()
+{
+}
+
+void
+profiler::attach_sampler(thread_samples&)
+{
+}
+
+void
+profiler::detach_sampler(thread_samples&)
+{
+}
+
+void
+profiler::fold_backtraces(const thread_samples&)
+{
+}
+
+const abc::string&
+profiler::get_cached_symbol_name(uintptr_t, bool)
+{
+    return m_symbolNames[0];
+}
+
+#endif
+
+uint64_t
+profiler::get_dropped_backtraces()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const thread_samples* samples : m_threads) {
+        fold_backtraces(*samples);
+    }
+    return m_droppedBacktraces;
+}
+
+void
+profiler::fold_call_tree(
+    const call_tree& tree, const abc::string& prefix, std::unordered_map<abc::string, uint64_t>& folded) const
+{
+    for (const call_tree& node : tree.nodes) {
+        const abc::string name = node.tag < m_samples.size() ? m_samples[node.tag].tag : abc::string("?");
+        const abc::string path = prefix.empty() ? name : prefix + ";" + name;
+        if (node.sampled != 0) {
+            folded[path] += node.sampled;
+        }
+        fold_call_tree(node, path, folded);
+    }
+}
+
+bool
+profiler::write_folded_stacks(const abc::string& path)
+{
+    std::map<abc::string, uint64_t> folded;
+    const call_tree                  tree = collect_call_tree();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_samplingBacktraces) {
+            for (const thread_samples* samples : m_threads) {
+                fold_backtraces(*samples);
+            }
+            folded.insert(m_foldedBacktraces.begin(), m_foldedBacktraces.end());
+            if (m_droppedBacktraces != 0) {
+                // keeps the total weight, the dropped samples are spread like the others
+                folded["[dropped backtraces]"] = m_droppedBacktraces;
+            }
+        } else {
+            std::unordered_map<abc::string, uint64_t> paths;
+            fold_call_tree(tree, abc::string(), paths);
+            folded.insert(paths.begin(), paths.end());
+            if (tree.sampled != 0) {
+                folded["[no zone]"] += tree.sampled;
+            }
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = true;
+    for (const auto& stack : folded) {
+        const abc::string line = ABC_FORMAT("{} {}\n", stack.first, stack.second);
+        ok                     = ok && std::fwrite(line.data(), 1, line.size(), file) == line.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace abc
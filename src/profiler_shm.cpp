@@ -0,0 +1,296 @@
+#include "abc/profiler.hpp"
+#include "abc/profiler_shm.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <thread>
+
+#if defined(ABC_PLATFORM_LINUX_FAMILY) || defined(ABC_PLATFORM_OSX_FAMILY)
+#    define ABC_PROFILER_SHM_SUPPORTED
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace abc {
+namespace detail {
+///////////////////////////////////////////////////////////////////////////////
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the segment is shared between processes");
+
+abc::string
+profiler_shm::get_default_name(int64_t pid)
+{
+    return ABC_FORMAT("/abc_profiler_{}", pid);
+}
+
+#if defined(ABC_PROFILER_SHM_SUPPORTED)
+
+struct profiler::publisher {
+    abc::string               name;
+    std::chrono::milliseconds interval;
+    profiler_shm::header*     segment = nullptr;
+    std::thread               thread;
+    std::mutex                mutex;
+    std::condition_variable   wakeup;
+    bool                      stopping = false;
+
+    ~publisher()
+    {
+        if (segment != nullptr) {
+            ::munmap(segment, sizeof(profiler_shm::header));
+            ::shm_unlink(name.c_str());
+        }
+    }
+
+    bool create()
+    {
+        const int fd = ::shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        // ftruncate zero fills, the atomics need no further construction
+        void* memory = ::ftruncate(fd, sizeof(profiler_shm::header)) == 0
+            ? ::mmap(nullptr, sizeof(profiler_shm::header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+            : MAP_FAILED;
+        ::close(fd);
+        if (memory == MAP_FAILED) {
+            ::shm_unlink(name.c_str());
+            return false;
+        }
+        segment             = static_cast<profiler_shm::header*>(memory);
+        segment->version    = profiler_shm::k_version;
+        segment->capacity   = static_cast<uint32_t>(profiler_shm::k_maxTags);
+        segment->pid        = static_cast<int64_t>(::getpid());
+        segment->intervalMs = static_cast<uint64_t>(interval.count());
+        segment->magic.store(profiler_shm::k_magic, std::memory_order_release);
+        return true;
+    }
+
+    void publish(const sample_container_t& samples)
+    {
+        const auto store = [](std::atomic<uint64_t>& field, uint64_t value) {
+            field.store(value, std::memory_order_relaxed);
+        };
+        const auto toNs = [](duration value) {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(value).count();
+            return ns > 0 ? static_cast<uint64_t>(ns) : uint64_t(0);
+        };
+
+        // names are written before they are counted, the seqlock only covers the statistics
+        const size_t count = std::min(samples.size(), profiler_shm::k_maxTags);
+        for (size_t i = segment->tagCount.load(std::memory_order_relaxed); i < count; ++i) {
+            const size_t length = std::min(samples[i].tag.size(), profiler_shm::k_nameSize - 1);
+            std::memcpy(segment->tags[i].name, samples[i].tag.data(), length);
+            segment->tags[i].name[length] = '\0';
+        }
+
+        const uint64_t sequence = segment->sequence.load(std::memory_order_relaxed);
+        segment->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < count; ++i) {
+            const ProfilingData& data = samples[i];
+            profiler_shm::tag&   tag  = segment->tags[i];
+            store(tag.calls, data.samples);
+            store(tag.totalNs, toNs(data.accumDuration));
+            store(tag.minNs, data.samples != 0 ? toNs(data.minDuration) : 0);
+            store(tag.maxNs, toNs(data.maxDuration));
+            store(tag.lockedNs, toNs(data.mt_lockedTime));
+            store(tag.p50Ns, data.histogram != nullptr ? data.histogram->get_percentile(50.0) : 0);
+            store(tag.p90Ns, data.histogram != nullptr ? data.histogram->get_percentile(90.0) : 0);
+            store(tag.p99Ns, data.histogram != nullptr ? data.histogram->get_percentile(99.0) : 0);
+            store(tag.p999Ns, data.histogram != nullptr ? data.histogram->get_percentile(99.9) : 0);
+            store(tag.allocations, data.allocations.allocations);
+            store(tag.allocatedBytes, data.allocations.bytes);
+        }
+        const auto now = std::chrono::system_clock::now().time_since_epoch();
+        segment->timestampNs.store(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), std::memory_order_relaxed);
+        segment->publishes.store(segment->publishes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        segment->tagCount.store(count, std::memory_order_release);
+        segment->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    void run(profiler& instance)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            lock.unlock();
+            publish(instance.collect());
+            lock.lock();
+            wakeup.wait_for(lock, interval, [this]() { return stopping; });
+        }
+        lock.unlock();
+        publish(instance.collect());
+    }
+};
+
+profiler::~profiler()
+{
+    stop_publishing();
+}
+
+bool
+profiler::start_publishing(const abc::string& name, std::chrono::milliseconds interval)
+{
+    stop_publishing();
+
+    std::unique_ptr<publisher> created(new publisher());
+    created->name     = name.empty() ? profiler_shm::get_default_name(static_cast<int64_t>(::getpid())) : name;
+    created->interval = interval.count() > 0 ? interval : std::chrono::milliseconds(1);
+    if (!created->create()) {
+        ABC_LOG_WARNING("Cannot publish the profiler statistics to {} ({})", created->name, std::strerror(errno));
+        return false;
+    }
+    publisher& started = *created;
+    started.thread     = std::thread([this, &started]() { started.run(*this); });
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_publisher = created.release();
+    return true;
+}
+
+void
+profiler::stop_publishing()
+{
+    std::unique_ptr<publisher> stopped;
+    {
+        // the publisher collects under m_mutex, it is joined after releasing it
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stopped.reset(m_publisher);
+        m_publisher = nullptr;
+    }
+    if (stopped == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stopped->mutex);
+        stopped->stopping = true;
+    }
+    stopped->wakeup.notify_one();
+    stopped->thread.join();
+}
+
+bool
+profiler_shm_reader::open(const abc::string& name)
+{
+    close();
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+    // a segment of another version may be smaller
+    struct stat status;
+    const bool  complete = ::fstat(fd, &status) == 0 && status.st_size >= off_t(sizeof(profiler_shm::header));
+    void*       memory   = complete ? ::mmap(nullptr, sizeof(profiler_shm::header), PROT_READ, MAP_SHARED, fd, 0)
+                                    : MAP_FAILED;
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    m_header = static_cast<const profiler_shm::header*>(memory);
+    m_size   = sizeof(profiler_shm::header);
+    if (m_header->magic.load(std::memory_order_acquire) != profiler_shm::k_magic
+        || m_header->version != profiler_shm::k_version) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void
+profiler_shm_reader::close()
+{
+    if (m_header != nullptr) {
+        ::munmap(const_cast<profiler_shm::header*>(m_header), m_size);
+        m_header = nullptr;
+    }
+}
+
+bool
+profiler_shm_reader::read(profiler_snapshot& out) const
+{
+    if (m_header == nullptr) {
+        return false;
+    }
+    const auto load = [](const std::atomic<uint64_t>& field) { return field.load(std::memory_order_relaxed); };
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const uint64_t sequence = m_header->sequence.load(std::memory_order_acquire);
+        if (sequence % 2 != 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        const size_t count = static_cast<size_t>(
+            std::min<uint64_t>(m_header->tagCount.load(std::memory_order_acquire), profiler_shm::k_maxTags));
+        out.pid         = m_header->pid;
+        out.intervalMs  = m_header->intervalMs;
+        out.publishes   = load(m_header->publishes);
+        out.timestampNs = m_header->timestampNs.load(std::memory_order_relaxed);
+        out.tags.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            const profiler_shm::tag& tag   = m_header->tags[i];
+            profiler_snapshot::tag&  entry = out.tags[i];
+            entry.name.assign(tag.name, strnlen(tag.name, profiler_shm::k_nameSize));
+            entry.calls          = load(tag.calls);
+            entry.totalNs        = load(tag.totalNs);
+            entry.minNs          = load(tag.minNs);
+            entry.maxNs          = load(tag.maxNs);
+            entry.lockedNs       = load(tag.lockedNs);
+            entry.p50Ns          = load(tag.p50Ns);
+            entry.p90Ns          = load(tag.p90Ns);
+            entry.p99Ns          = load(tag.p99Ns);
+            entry.p999Ns         = load(tag.p999Ns);
+            entry.allocations    = load(tag.allocations);
+            entry.allocatedBytes = load(tag.allocatedBytes);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_header->sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#else
+
+struct profiler::publisher {
+};
+
+profiler::~profiler() = default;
+
+bool
+profiler::start_publishing(const abc::string&, std::chrono::milliseconds)
+{
+    return false;
+}
+
+void
+profiler::stop_publishing()
+{
+}
+
+bool
+profiler_shm_reader::open(const abc::string&)
+{
+    return false;
+}
+
+void
+profiler_shm_reader::close()
+{
+}
+
+bool
+profiler_shm_reader::read(profiler_snapshot&) const
+{
+    return false;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+}   // namespace detail
+}   // namespace abc
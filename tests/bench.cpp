@@ -0,0 +1,98 @@
+#include "doctest/doctest.h"
+
+#include "abc/bench.hpp"
+
+#include <cstdio>
+
+TEST_CASE("abc - bench - statistics")
+{
+    abc::bench::result result;
+    abc::bench::compute_statistics({10.0, 12.0, 11.0, 100.0, 9.0}, result);
+    CHECK(result.medianNs == doctest::Approx(11.0));
+    CHECK(result.madNs == doctest::Approx(1.0));   // the outlier does not move the median nor the deviation
+    CHECK(result.minNs == doctest::Approx(9.0));
+    CHECK(result.maxNs == doctest::Approx(100.0));
+
+    abc::bench::compute_statistics({4.0, 1.0, 3.0, 2.0}, result);
+    CHECK(result.medianNs == doctest::Approx(2.5));
+    CHECK(result.madNs == doctest::Approx(1.0));
+}
+
+TEST_CASE("abc - bench - run")
+{
+    unsigned                    setups = 0;
+    const abc::bench::benchmark sum{"sum", [&setups](abc::bench::state& state) {
+        uint64_t total = 0;
+        for (auto _ : state) {
+            state.pause_timing();
+            ++setups;
+            state.resume_timing();
+            total += setups;
+            abc::bench::do_not_optimize(total);
+        }
+        abc::bench::clobber_memory();
+        state.set_counter("setups", static_cast<double>(setups));
+    }};
+
+    abc::bench::options options;
+    options.repetitions  = 3;
+    options.minBatchTime = abc::chrono::milliseconds(1);
+    options.warmupTime   = abc::chrono::milliseconds(1);
+    setups               = 0;
+    const abc::bench::result result = abc::bench::run(sum, options);
+    CHECK(result.name == "sum");
+    CHECK(result.repetitions == 3);
+    CHECK(result.iterations > 1);
+    CHECK(setups >= result.iterations * 3);
+    CHECK(result.medianNs > 0.0);
+    CHECK(result.minNs <= result.medianNs);
+    CHECK(result.medianNs <= result.maxNs);
+    REQUIRE(result.counters.size() == 1);
+    CHECK(result.counters[0].name == "setups");
+    CHECK(result.counters[0].value == doctest::Approx(static_cast<double>(setups)));
+}
+
+TEST_CASE("abc - bench - baseline")
+{
+    std::vector<abc::bench::result> baseline(3);
+    baseline[0].name     = "stable \"quoted\"\t";
+    baseline[0].medianNs = 100.0;
+    baseline[0].madNs    = 1.0;
+    baseline[1].name     = "slower";
+    baseline[1].medianNs = 100.0;
+    baseline[1].madNs    = 1.0;
+    baseline[2].name     = "noisy";
+    baseline[2].medianNs = 100.0;
+    baseline[2].madNs    = 10.0;
+
+    std::vector<abc::bench::result> current = baseline;
+    current[0].medianNs                     = 102.0;
+    current[1].medianNs                     = 120.0;
+    current[2].medianNs                     = 120.0;
+
+    // json and csv round trip
+    for (const auto format : {abc::bench::output_format::json, abc::bench::output_format::csv}) {
+        const char* path = "abc_bench_baseline.tmp";
+        std::FILE*  file = std::fopen(path, "wb");
+        REQUIRE(file != nullptr);
+        const abc::string content = abc::bench::format_results(baseline, format);
+        std::fwrite(content.data(), 1, content.size(), file);
+        std::fclose(file);
+
+        std::vector<abc::bench::result> read;
+        REQUIRE(abc::bench::read_results(path, read));
+        std::remove(path);
+        REQUIRE(read.size() == 3);
+        CHECK(read[0].name == baseline[0].name);
+        CHECK(read[2].name == "noisy");
+        CHECK(read[2].medianNs == doctest::Approx(100.0));
+        CHECK(read[2].madNs == doctest::Approx(10.0));
+    }
+
+    const std::vector<abc::bench::comparison> comparisons = abc::bench::compare(baseline, current, 0.05);
+    REQUIRE(comparisons.size() == 3);
+    CHECK_FALSE(comparisons[0].regression);   // under the threshold
+    CHECK(comparisons[1].regression);
+    CHECK(comparisons[1].change == doctest::Approx(0.2));
+    CHECK_FALSE(comparisons[2].regression);   // within the noise
+}
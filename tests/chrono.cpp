@@ -0,0 +1,39 @@
+#include "doctest/doctest.h"
+
+#include "abc/timer.hpp"
+
+#include <thread>
+
+TEST_CASE("abc - chrono - tsc clock")
+{
+    using namespace abc::chrono;
+
+    // calibrated or not, the clock follows the steady clock
+    tsc_clock::now();   // calibrates
+    const auto steady0 = std::chrono::steady_clock::now();
+    const auto tsc0    = tsc_clock::now();
+    std::this_thread::sleep_for(milliseconds(20));
+    const auto tsc1    = tsc_clock::now();
+    const auto steady1 = std::chrono::steady_clock::now();
+
+    const auto tscElapsed    = std::chrono::duration_cast<microseconds>(tsc1 - tsc0).count();
+    const auto steadyElapsed = std::chrono::duration_cast<microseconds>(steady1 - steady0).count();
+    CHECK(tscElapsed > 0);
+    CHECK(tscElapsed <= steadyElapsed + steadyElapsed / 20);
+    CHECK(tscElapsed >= steadyElapsed - steadyElapsed / 20 - 1000);
+
+    // monotonic on a thread
+    auto previous = tsc_clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        const auto current = tsc_clock::now();
+        CHECK(current >= previous);
+        previous = current;
+    }
+
+    CHECK((tsc_clock::is_invariant() ? tsc_clock::get_frequency() > 0.0 : tsc_clock::get_frequency() == 0.0));
+    MESSAGE("invariant counter: " << tsc_clock::is_invariant() << ", ticks/ns: " << tsc_clock::get_frequency());
+
+    tsc_timer timer;
+    std::this_thread::sleep_for(milliseconds(1));
+    CHECK(timer.get_elapsed_time_as<microseconds>().count() >= 900);
+}
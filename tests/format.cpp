@@ -1,9 +1,39 @@
 #include "doctest/doctest.h"
 
+#include "abc/charconv.hpp"
 #include "abc/format.hpp"
 #include "abc/enum.hpp"
 #include "abc/string.hpp"
 
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace {
+struct render_counter
+{
+    int value;
+};
+int g_renderCount = 0;
+}  // namespace
+
+namespace abc {
+namespace detail {
+template <>
+struct to_string_impl<render_counter>
+{
+    static abc::string impl(const render_counter &i_value)
+    {
+        ++g_renderCount;
+        return abc::format("rc{}", i_value.value);
+    }
+};
+}  // namespace detail
+}  // namespace abc
+
 TEST_CASE("abc - format - to_string")
 {
     using namespace abc;
@@ -20,6 +50,96 @@ TEST_CASE("abc - format - from_string")
     CHECK(from_string<char>("1") == '1');
     CHECK(from_string<int>("12") == 12);
     CHECK(from_string<float>("1.2f") == 1.2f);
+
+    CHECK(from_string<int>(" -42") == -42);
+    CHECK(from_string<uint64_t>("18446744073709551615") == std::numeric_limits<uint64_t>::max());
+    CHECK(!from_string<uint64_t>("18446744073709551616").has_value());
+    CHECK(!from_string<int8_t>("128").has_value());
+    CHECK(!from_string<int>("abc").has_value());
+    CHECK(from_string<int>("abc", 7) == 7);
+    CHECK(from_string<double>("1e3") == 1000.0);
+    CHECK(from_string<double>("0.30000000000000004") == 0.1 + 0.2);
+    CHECK(from_string<bool>("1") == true);
+}
+
+TEST_CASE("abc - format - numeric conversion")
+{
+    using namespace abc;
+
+    CHECK(to_string(int64_t(-9223372036854775807LL - 1)) == "-9223372036854775808");
+    CHECK(to_string(uint64_t(10000000000000000000ULL)) == "10000000000000000000");
+    CHECK(to_string(0.1 + 0.2) == "0.30000000000000004");
+    CHECK(to_string(1e21) == "1e+21");
+    CHECK(to_string(1e-7) == "1e-07");
+    CHECK(to_string(0.0001) == "0.0001");
+    CHECK(to_string(-0.0) == "-0");
+    CHECK(to_string(std::numeric_limits<double>::infinity()) == "inf");
+    CHECK(to_string(1234567.0f) == "1.234567e+06");
+
+    char                  small[3];
+    const to_chars_result tooLarge = to_chars(small, small + sizeof(small), 1234);
+    CHECK(tooLarge.ec == std::errc::value_too_large);
+
+    std::mt19937_64 rng(1234);
+    for (int i = 0; i < 10000; ++i)
+    {
+        const uint64_t bits = rng();
+        double         value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (value != value)
+        {
+            continue;
+        }
+
+        char                  buffer[64];
+        const to_chars_result written = to_chars(buffer, buffer + sizeof(buffer), value);
+        double                parsed  = 0;
+        from_chars(buffer, written.ptr, parsed);
+        CHECK(std::memcmp(&parsed, &value, sizeof(value)) == 0);
+    }
+
+    // the printf layouts at a precision, which must match in the "C" locale
+    const chars_format formats[]       = {chars_format::scientific, chars_format::fixed, chars_format::general};
+    const char *const  printfFormats[] = {"%.*e", "%.*f", "%.*g"};
+    for (int i = 0; i < 10000; ++i)
+    {
+        const uint64_t bits = rng();
+        double         value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (value != value)
+        {
+            continue;
+        }
+        const size_t format    = static_cast<size_t>(rng() % 3);
+        const int    precision = format == 1 && std::fabs(value) > 1e30 ? 2 : static_cast<int>(rng() % 25);
+
+        char      expected[512];
+        const int size = std::snprintf(expected, sizeof(expected), printfFormats[format], precision, value);
+
+        char                  buffer[512];
+        const to_chars_result written = to_chars(buffer, buffer + sizeof(buffer), value, formats[format], precision);
+        CHECK(string(buffer, written.ptr) == string(expected, static_cast<size_t>(size)));
+    }
+    CHECK(to_chars(small, small + sizeof(small), 1.5, chars_format::fixed, 2).ec == std::errc::value_too_large);
+
+    // just above the halfway point between 1 and the next double, only the exact slow path rounds it up, and
+    // must do so whatever the decimal separator of the global locale
+    const string nearHalfway    = "1.00000000000000011102230246251565404236316680908203125001";
+    const char  *numericLocale  = std::setlocale(LC_NUMERIC, nullptr);
+    const string previousLocale = numericLocale != nullptr ? numericLocale : "C";
+    for (const char *locale : {"C", "de_DE.UTF-8", "fr_FR.UTF-8"})
+    {
+        if (std::setlocale(LC_NUMERIC, locale) == nullptr)
+        {
+            continue;
+        }
+        const char *const       last   = nearHalfway.data() + nearHalfway.size();
+        double                  parsed = 0;
+        const from_chars_result result = from_chars(nearHalfway.data(), last, parsed);
+        CHECK(result.ptr == last);
+        CHECK(parsed == std::nextafter(1.0, 2.0));
+    }
+    std::setlocale(LC_NUMERIC, previousLocale.c_str());
 }
 
 TEST_CASE("abc - format")
@@ -50,3 +170,144 @@ TEST_CASE("abc - format - to_string int performance")
         CHECK(format("{}", to_string(i)) == to_string(i));
     }
 }
+
+TEST_CASE("abc - format - compiled format string")
+{
+    using namespace abc;
+
+    CHECK(format(ABC_FORMAT_STRING("{}"), 'h') == "h");
+    CHECK(format(ABC_FORMAT_STRING("{}.{}"), 1, 1.5f) == "1.1.5");
+    CHECK(format(ABC_FORMAT_STRING("[{}:{}] %s"), "file", 12, string("msg")) == "[file:12] msg");
+    CHECK(format(ABC_FORMAT_STRING("no placeholders")) == "no placeholders");
+    CHECK(ABC_FORMAT("{{{}}} 100%% {}}}", 1, "done") == "{1} 100% done}");
+
+    // both paths share the same parser
+    CHECK(format("{{{}}} 100%% {}}}", 1, "done") == ABC_FORMAT("{{{}}} 100%% {}}}", 1, "done"));
+    CHECK(format("%x {}", 1) == ABC_FORMAT("%x {}", 1));
+
+    static_assert(detail::count_format_segments("a{}b%sc", 7, detail::format_segment::kind::placeholder) == 2,
+                  "placeholders are counted at compile time");
+}
+
+TEST_CASE("abc - format - format_to")
+{
+    using namespace abc;
+
+    string str = "> ";
+    format_to(std::back_inserter(str), "{} + {} = {}", 1, 2, 3);
+    CHECK(str == "> 1 + 2 = 3");
+    format_to(std::back_inserter(str), ABC_FORMAT_STRING(" [{}]"), "ok");
+    CHECK(str == "> 1 + 2 = 3 [ok]");
+
+    char  buffer[32] = {};
+    char *end        = format_to(buffer, "{}:{}", "file", -12);
+    CHECK(string(buffer, end) == "file:-12");
+
+    const format_to_n_result result = format_to_n(buffer, 4, "{}-{}", 123, 456);
+    CHECK(result.size == 7);
+    CHECK(result.out == buffer + 4);
+    CHECK(string(buffer, result.out) == "123-");
+
+    CHECK(formatted_size("{}-{}", 123, 456) == 7);
+    CHECK(formatted_size(ABC_FORMAT_STRING("{}{}"), "ab", string("cd")) == 4);
+    CHECK(format("{} {}", int64_t(-9223372036854775807LL - 1), uint64_t(18446744073709551615ULL))
+          == "-9223372036854775808 18446744073709551615");
+}
+
+TEST_CASE("abc - format - lazy arguments")
+{
+    using namespace abc;
+
+    g_renderCount = 0;
+    CHECK(format("{} {}", render_counter{1}, render_counter{2}) == "rc1 rc2");
+    CHECK(g_renderCount == 2);
+
+    // arguments without a placeholder are never rendered
+    g_renderCount = 0;
+    CHECK(format("{}", 1, render_counter{3}) == "1");
+    CHECK(g_renderCount == 0);
+
+    // the store references its arguments, they have to outlive it
+    const render_counter counter{4};
+    const int            number = 12;
+    auto                 store  = detail::make_format_args<detail::counting_sink>(counter, number, "ab");
+    const detail::format_args<detail::counting_sink> args = store;
+    detail::counting_sink                            sink;
+    CHECK(args.size == 3);
+    CHECK(args.write(sink, 1, detail::format_spec()));
+    CHECK(sink.size() == 2);
+    CHECK(!args.write(sink, 3, detail::format_spec()));
+    CHECK(g_renderCount == 0);
+}
+
+TEST_CASE("abc - format - format spec")
+{
+    using namespace abc;
+
+    CHECK(format("{:08x}", 255) == "000000ff");
+    CHECK(format("{:#x} {:#X} {:#b} {:#o}", 255, 255, 5, 8) == "0xff 0XFF 0b101 010");
+    CHECK(format("{:+d} {: d} {:05d}", 12, 12, -42) == "+12  12 -0042");
+    CHECK(format("{:x}", int64_t(-255)) == "-ff");
+    CHECK(format("{:x}", uint64_t(18446744073709551615ULL)) == "ffffffffffffffff");
+    CHECK(format("{}", size_t(42)) == "42");
+
+    CHECK(format("{:.3f}", 3.14159) == "3.142");
+    CHECK(format("{:e}", 1234.5) == "1.234500e+03");
+    CHECK(format("{:.2E}", 0.000123) == "1.23E-04");
+    CHECK(format("{:g}", 0.0001) == "0.0001");
+    CHECK(format("{:08.2f}", -3.14159) == "-0003.14");
+    CHECK(format("{:+}", 1.5f) == "+1.5");
+    CHECK(format("{:.1f}", 1e30).size() == 33);
+    // exact binary values, rounded half to even
+    CHECK(format("{:.0f} {:.0f} {:.0f} {:.2f}", 0.5, 1.5, 2.5, 0.125) == "0 2 2 0.12");
+    CHECK(format("{:.1f}", 1e30) == "1000000000000000019884624838656.0");
+    CHECK(format("{:.2f} {:.3e} {:.3g}", 9.999, 9.9995, 99.95) == "10.00 9.999e+00 100");
+    CHECK(format("{:#.0f} {:#.0e} {:#g} {:g}", 3.0, 3.0, 1.5, 100000.0) == "3. 3.e+00 1.50000 100000");
+    CHECK(format("{:g} {:G} {:.3F}", 1e-5, 1e20, -std::numeric_limits<double>::infinity()) == "1e-05 1E+20 -INF");
+    CHECK(format("{:.5f}", -0.0) == "-0.00000");
+
+    CHECK(format("[{:>6}]", "ab") == "[    ab]");
+    CHECK(format("[{:<6}]", 12) == "[12    ]");
+    CHECK(format("[{:*^7}]", "mid") == "[**mid**]");
+    CHECK(format("[{:6}]", 12) == "[    12]");
+    CHECK(format("[{:6}]", "ab") == "[ab    ]");
+    CHECK(format("[{:.2}]", string("abcdef")) == "[ab]");
+    CHECK(format("[{:3}] [{:5}]", 'c', true) == "[c  ] [1    ]");
+    CHECK(format("{:s} {:d}", false, true) == "false 1");
+    CHECK(format("{:d} {:x}", 'A', 'A') == "65 41");
+    CHECK(format("{:>5}", render_counter{7}) == "  rc7");
+    CHECK(format("{0:>3}|{name:<3}|", 1, 2) == "  1|2  |");
+
+    // the compiled path parses and validates the specs at compile time
+    CHECK(ABC_FORMAT("{:08x}|{:.3f}|{:>12}|{:e}", 255, 3.14159, "right", 1234.5)
+          == format("{:08x}|{:.3f}|{:>12}|{:e}", 255, 3.14159, "right", 1234.5));
+    static_assert(detail::parse_format_spec(":*^+#012.5x", 11).valid, "full spec");
+    static_assert(detail::parse_format_spec(":*^+#012.5x", 11).spec.width == 12, "width");
+    static_assert(!detail::parse_format_spec(":.x", 3).valid, "precision without digits");
+    static_assert(!detail::parse_format_spec(":5q", 3).valid, "unknown type");
+    static_assert(!detail::format_spec_accepts(detail::format_category::string,
+                                               detail::parse_format_spec(":x", 2).spec),
+                  "hex does not apply to strings");
+    static_assert(!detail::format_spec_accepts(detail::format_category::integer,
+                                               detail::parse_format_spec(":.2", 3).spec),
+                  "precision does not apply to integers");
+}
+
+TEST_CASE("abc - format - prepared format")
+{
+    using namespace abc;
+
+    const prepared_format line(string("[{}:{:04d}] {:>6} 100%% {{{}}}"));
+    CHECK(line.placeholders_count() == 4);
+    CHECK(line("file", 12, "msg", 1.5) == "[file:0012]    msg 100% {1.5}");
+    CHECK(line("other", -3, string("x"), 'c') == "[other:-003]      x 100% {c}");
+    CHECK(line("file", 12, "msg", 1.5) == format(line.str(), "file", 12, "msg", 1.5));
+
+    string str = "> ";
+    line.format_to(std::back_inserter(str), "a", 1, "b", 2);
+    CHECK(str == "> [a:0001]      b 100% {2}");
+
+    const prepared_format printfStyle(string("%s=%d"));
+    CHECK(printfStyle("key", 42) == "key=42");
+    CHECK(prepared_format(string("no placeholders"))() == "no placeholders");
+}
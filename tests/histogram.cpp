@@ -0,0 +1,71 @@
+#include "doctest/doctest.h"
+
+#include "abc/histogram.hpp"
+
+#include <cmath>
+
+TEST_CASE("abc - histogram - buckets")
+{
+    using histogram = abc::log_linear_histogram;
+
+    // indices are contiguous and every value falls inside its bucket
+    size_t previous = 0;
+    for (uint64_t value = 0; value < (uint64_t(1) << 20); value += 1 + value / 97) {
+        const size_t index = histogram::get_bucket_index(value);
+        CHECK(index >= previous);
+        CHECK(index <= previous + 1);
+        CHECK(value <= histogram::get_bucket_upper_bound(index));
+        if (index > 0) {
+            CHECK(value > histogram::get_bucket_upper_bound(index - 1));
+        }
+        previous = index;
+    }
+    CHECK(histogram::get_bucket_index(~uint64_t(0)) == histogram::k_bucketCount - 1);
+    CHECK(histogram::get_bucket_upper_bound(histogram::k_bucketCount - 1)
+          == (uint64_t(1) << histogram::k_maxValueBits) - 1);
+}
+
+TEST_CASE("abc - histogram - percentiles")
+{
+    abc::log_linear_histogram histogram;
+    CHECK(histogram.get_percentile(50.0) == 0);
+
+    for (uint64_t value = 1; value <= 100000; ++value) {
+        histogram.record(value);
+    }
+    CHECK(histogram.get_count() == 100000);
+    CHECK(histogram.get_max() == 100000);
+
+    const auto withinPrecision = [](uint64_t value, double expected) {
+        return std::fabs(static_cast<double>(value) - expected) <= expected / 32.0;
+    };
+    CHECK(withinPrecision(histogram.get_percentile(50.0), 50000.0));
+    CHECK(withinPrecision(histogram.get_percentile(90.0), 90000.0));
+    CHECK(withinPrecision(histogram.get_percentile(99.0), 99000.0));
+    CHECK(withinPrecision(histogram.get_percentile(99.9), 99900.0));
+    CHECK(histogram.get_percentile(100.0) == 100000);
+    CHECK(histogram.get_percentile(0.0) == 1);
+
+    // a single outlier is the max but not the p99
+    abc::log_linear_histogram tail;
+    for (int i = 0; i < 999; ++i) {
+        tail.record(1000);
+    }
+    tail.record(5000000);
+    CHECK(withinPrecision(tail.get_percentile(99.0), 1000.0));
+    CHECK(withinPrecision(tail.get_percentile(99.95), 5000000.0));
+    CHECK(tail.get_max() == 5000000);
+
+    // merging is the same as recording everything in one histogram
+    abc::log_linear_histogram merged(histogram);
+    merged.merge(tail);
+    CHECK(merged.get_count() == 101000);
+    CHECK(merged.get_max() == 5000000);
+    CHECK(withinPrecision(merged.get_percentile(50.0), 49501.0));   // 999 more values below it
+
+    merged = tail;
+    CHECK(merged.get_count() == 1000);
+    merged.reset();
+    CHECK(merged.get_count() == 0);
+    CHECK(merged.get_max() == 0);
+}
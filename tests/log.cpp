@@ -0,0 +1,457 @@
+#include "doctest/doctest.h"
+
+#include "abc/debug.hpp"
+#include "abc/log.hpp"
+#include "abc/timer.hpp"
+
+#include <csetjmp>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+abc::string
+read_file(FILE* file)
+{
+    abc::string content;
+    std::rewind(file);
+    char   buffer[4096];
+    size_t size = 0;
+    while ((size = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, size);
+    }
+    return content;
+}
+
+size_t
+count_lines(const abc::string& content, const char* prefix)
+{
+    size_t             count = 0;
+    std::istringstream stream(content);
+    abc::string        line;
+    while (std::getline(stream, line)) {
+        count += line.compare(0, std::char_traits<char>::length(prefix), prefix) == 0 ? 1 : 0;
+    }
+    return count;
+}
+}   // namespace
+
+TEST_CASE("abc - log - synchronous")
+{
+    REQUIRE(!abc::log::is_async());
+
+    std::ostringstream stream;
+    std::streambuf*    cerrBuffer = std::cerr.rdbuf(stream.rdbuf());
+    const int          line       = __LINE__ + 1;
+    ABC_LOG_ERROR("value {} {:>3}", 1, "x");
+    ABC_LOG_WARNING("no arguments");
+    std::cerr.rdbuf(cerrBuffer);
+
+    CHECK(stream.str()
+          == abc::format("[ERROR][{}:{}] value 1   x\n[WARNING][{}:{}] no arguments\n", __FILE__, line, __FILE__,
+                         line + 1));
+}
+
+TEST_CASE("abc - log - asynchronous")
+{
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    abc::log::async_config config;
+    config.fd           = fileno(file);
+    config.flushOnCrash = false;
+    REQUIRE(abc::log::start_async(config));
+    CHECK(abc::log::is_async());
+    CHECK(!abc::log::start_async(config));
+
+    constexpr int            k_threads = 4;
+    constexpr int            k_lines   = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_threads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < k_lines; ++i) {
+                ABC_LOG_INFO("thread {} line {}", t, i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    // longer than a ring slot, goes through the heap
+    ABC_LOG_WARNING("{}", abc::string(1000, 'w'));
+
+    abc::log::flush();
+    CHECK(count_lines(read_file(file), "[INFO]") == k_threads * k_lines);
+
+    abc::log::stop_async();
+    CHECK(!abc::log::is_async());
+
+    const abc::string content = read_file(file);
+    CHECK(count_lines(content, "[WARNING]") == 1);
+    CHECK(content.find(abc::string(1000, 'w') + "\n") != abc::string::npos);
+    std::fclose(file);
+}
+
+TEST_CASE("abc - log - overflow policy")
+{
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    abc::log::async_config config;
+    config.fd           = fileno(file);
+    config.capacity     = 16;
+    config.overflow     = abc::log::overflow_policy::count_dropped;
+    config.flushOnCrash = false;
+
+    const uint64_t droppedBefore = abc::log::get_dropped_count();
+    REQUIRE(abc::log::start_async(config));
+    constexpr size_t k_lines = 20000;
+    for (size_t i = 0; i < k_lines; ++i) {
+        ABC_LOG_INFO("line {}", i);
+    }
+    abc::log::stop_async();
+
+    const abc::string content = read_file(file);
+    const uint64_t    dropped = abc::log::get_dropped_count() - droppedBefore;
+    CHECK(count_lines(content, "[INFO]") + dropped == k_lines);
+    if (dropped > 0) {
+        CHECK(content.find("records dropped") != abc::string::npos);
+    }
+    std::fclose(file);
+}
+
+namespace {
+enum class deferred_state {
+    idle,
+    busy
+};
+}   // namespace
+
+namespace abc {
+namespace detail {
+template <> struct to_string_impl<deferred_state> {
+    static abc::string impl(deferred_state state) { return state == deferred_state::idle ? "idle" : "busy"; }
+};
+}   // namespace detail
+}   // namespace abc
+
+TEST_CASE("abc - log - deferred")
+{
+    // without the async backend deferred calls format synchronously, like the regular macros
+    std::ostringstream stream;
+    std::streambuf*    cerrBuffer = std::cerr.rdbuf(stream.rdbuf());
+    const int          line       = __LINE__ + 1;
+    ABC_LOG_DEFERRED_WARNING("sync {} {}", 1, "x");
+    std::cerr.rdbuf(cerrBuffer);
+    CHECK(stream.str() == abc::format("[WARNING][{}:{}] sync 1 x\n", __FILE__, line));
+
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    abc::log::async_config config;
+    config.fd           = fileno(file);
+    config.flushOnCrash = false;
+    REQUIRE(abc::log::start_async(config));
+
+    constexpr int            k_threads = 4;
+    constexpr int            k_lines   = 5000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_threads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < k_lines; ++i) {
+                ABC_LOG_DEFERRED_INFO("thread {} line {}", t, i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    const abc::string text    = "text";
+    char              chars[] = "chars";
+    const int         first   = __LINE__ + 1;
+    ABC_LOG_DEFERRED_ERROR("{} {} {} {} {:.2f} {:>6}|{:08x} {}", true, 'c', -12, uint64_t(1) << 40, 2.5, text, 255u,
+                           deferred_state::busy);
+    ABC_LOG_DEFERRED_INFO("{}{} no {{args}}", chars, static_cast<const char*>("!"));
+    ABC_LOG_DEFERRED_INFO("empty");
+    abc::log::stop_async();
+
+    const abc::string content = read_file(file);
+    CHECK(count_lines(content, "[INFO]") == k_threads * k_lines + 2);
+    CHECK(content.find(abc::format("[ERROR][{}:{}] 1 c -12 1099511627776 2.50   text|000000ff busy\n", __FILE__, first))
+          != abc::string::npos);
+    CHECK(content.find(abc::format("[INFO][{}:{}] chars! no {{args}}\n", __FILE__, first + 2)) != abc::string::npos);
+    CHECK(content.find(abc::format("[INFO][{}:{}] empty\n", __FILE__, first + 3)) != abc::string::npos);
+    for (int t = 0; t < k_threads; ++t) {
+        CHECK(content.find(abc::format("] thread {} line {}\n", t, k_lines - 1)) != abc::string::npos);
+    }
+    std::fclose(file);
+}
+
+TEST_CASE("abc - log - deferred buffer wrap around")
+{
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    abc::log::async_config config;
+    config.fd                 = fileno(file);
+    config.flushOnCrash       = false;
+    config.deferredBufferSize = 1024;
+    REQUIRE(abc::log::start_async(config));
+
+    // a new thread gets a buffer of the configured size, a 20 bytes record followed by 32 bytes ones
+    // reaches 8 bytes before the end of the ring unless records are padded to the header size
+    constexpr int k_lines = 200;
+    std::thread   thread([] {
+        ABC_LOG_DEFERRED_INFO("first {}", 1);
+        for (int64_t i = 0; i < k_lines; ++i) {
+            ABC_LOG_DEFERRED_INFO("wrap {} {}", i, -i);
+        }
+    });
+    thread.join();
+    abc::log::stop_async();
+
+    const abc::string content = read_file(file);
+    CHECK(count_lines(content, "[INFO]") == k_lines + 1);
+    CHECK(content.find("] first 1\n") != abc::string::npos);
+    for (int i = 0; i < k_lines; ++i) {
+        CHECK(content.find(abc::format("] wrap {} {}\n", i, -i)) != abc::string::npos);
+    }
+    std::fclose(file);
+}
+
+TEST_CASE("abc - log - deferred buffer of an earlier backend")
+{
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    // the thread keeps the small buffer of the first backend, a record only the second one fits must not
+    // wait forever for space in it
+    std::thread thread([file] {
+        abc::log::async_config config;
+        config.fd                 = fileno(file);
+        config.flushOnCrash       = false;
+        config.deferredBufferSize = 1024;
+        REQUIRE(abc::log::start_async(config));
+        ABC_LOG_DEFERRED_INFO("small {}", 1);
+        abc::log::stop_async();
+
+        config.deferredBufferSize = 64 * 1024;
+        REQUIRE(abc::log::start_async(config));
+        ABC_LOG_DEFERRED_INFO("large {}", abc::string(4000, 'x'));
+        abc::log::stop_async();
+    });
+    thread.join();
+
+    const abc::string content = read_file(file);
+    CHECK(content.find("] small 1\n") != abc::string::npos);
+    CHECK(content.find("] large " + abc::string(4000, 'x') + "\n") != abc::string::npos);
+    std::fclose(file);
+}
+
+TEST_CASE("abc - log - deferred and text records")
+{
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+
+    abc::log::async_config config;
+    config.fd                 = fileno(file);
+    config.flushOnCrash       = false;
+    config.deferredBufferSize = 1 << 20;
+    REQUIRE(abc::log::start_async(config));
+
+    // both kinds are interleaved through the same writer, log_deferred and log_async_text in abc_bench time them
+    constexpr int k_calls = 10000;
+    for (int i = 0; i < k_calls; ++i) {
+        ABC_LOG_DEFERRED_INFO("iteration {} value {}", i, i * 0.5);
+        ABC_LOG_INFO("iteration {} value {}", i, i * 0.5);
+    }
+    abc::log::stop_async();
+
+    CHECK(count_lines(read_file(file), "[INFO]") == 2 * k_calls);
+    std::fclose(file);
+}
+
+namespace {
+abc::log::channel g_netChannel("net");
+abc::log::channel g_httpChannel("net.http");
+abc::log::channel g_networkChannel("network");   // not a child of "net"
+
+int g_evaluations = 0;
+int
+evaluate()
+{
+    return ++g_evaluations;
+}
+}   // namespace
+
+TEST_CASE("abc - log - channels")
+{
+    using abc::log::level;
+
+    CHECK(g_netChannel.is_enabled(level::debug));
+    CHECK(abc::log::get_root_channel().is_enabled(level::debug));
+
+    REQUIRE(abc::log::configure_levels("info,net=warning"));
+    CHECK(!abc::log::get_root_channel().is_enabled(level::debug));
+    CHECK(abc::log::get_root_channel().is_enabled(level::info));
+    CHECK(g_netChannel.get_level() == level::warning);
+    CHECK(g_httpChannel.get_level() == level::warning);
+    CHECK(g_networkChannel.get_level() == level::info);
+
+    abc::log::set_level("net.http", level::debug);
+    CHECK(g_netChannel.get_level() == level::warning);
+    CHECK(g_httpChannel.get_level() == level::debug);
+    {
+        // channels defined later pick up the levels already set
+        abc::log::channel grpc("net.grpc");
+        CHECK(grpc.get_level() == level::warning);
+        abc::log::channel deep("net.http.client");
+        CHECK(deep.get_level() == level::debug);
+    }
+
+    CHECK(!abc::log::configure_levels("net=loud"));
+    CHECK(!abc::log::configure_levels("error,net=warning,=debug,http=noise"));
+    CHECK(g_netChannel.get_level() == level::warning);
+    CHECK(abc::log::configure_levels("NET=Off,,"));
+    CHECK(abc::log::configure_levels(""));
+
+    // disabled calls do not evaluate their arguments
+    abc::log::set_level("net", level::off);
+    std::ostringstream stream;
+    std::streambuf*    cerrBuffer = std::cerr.rdbuf(stream.rdbuf());
+    ABC_LOG_CHANNEL_ERROR(g_netChannel, "{}", evaluate());
+    ABC_LOG_CHANNEL_INFO(g_networkChannel, "{}", evaluate());
+    ABC_LOG_CHANNEL_DEBUG(g_networkChannel, "{}", evaluate());
+    ABC_LOG_INFO("root {}", evaluate());
+    ABC_LOG_DEFERRED_INFO("root deferred {}", 1);
+    abc::log::set_level(level::warning);
+    ABC_LOG_INFO("root {}", evaluate());
+    ABC_LOG_DEFERRED_INFO("root deferred {}", 2);
+    std::cerr.rdbuf(cerrBuffer);
+
+    CHECK(g_evaluations == 2);
+    CHECK(stream.str().find("] 1\n") != abc::string::npos);
+    CHECK(stream.str().find("root 2") != abc::string::npos);
+    CHECK(stream.str().find("root deferred 1") != abc::string::npos);
+    CHECK(stream.str().find("root 3") == abc::string::npos);
+    CHECK(stream.str().find("root deferred 2") == abc::string::npos);
+
+    abc::log::reset_levels();
+    CHECK(g_netChannel.get_level() == level::debug);
+    CHECK(abc::log::get_root_channel().is_enabled(level::debug));
+}
+
+TEST_CASE("abc - log - rate limited")
+{
+    g_evaluations = 0;
+
+    std::ostringstream stream;
+    std::streambuf*    cerrBuffer = std::cerr.rdbuf(stream.rdbuf());
+    const int          line       = __LINE__ + 2;
+    for (int i = 0; i < 25; ++i) {
+        ABC_LOG_EVERY_N(warning, 10, "every n {} {}", i, evaluate());
+    }
+    for (int i = 0; i < 25; ++i) {
+        ABC_LOG_FIRST_N(info, 3, "first n {}", i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ABC_LOG_EVERY_MS(error, 60000, "every ms {}", i);
+        ABC_LOG_RATE_LIMITED(info, 0.001, 5, "bucket {}", i);
+    }
+    for (int i = 0; i < 10; ++i) {
+        ABC_LOG_RATE_LIMITED(info, 0.0, 5, "no rate {}", i);   // never goes through
+    }
+    abc::log::report_suppressed();
+    abc::log::report_suppressed();   // nothing new to report
+    std::cerr.rdbuf(cerrBuffer);
+
+    const abc::string output = stream.str();
+    CHECK(g_evaluations == 3);
+    const auto expect = [](const char* lvl, int site, const char* message) {
+        return abc::format("[{}][{}:{}] {}\n", lvl, __FILE__, site, message);
+    };
+    CHECK(output
+          == expect("WARNING", line, "every n 0 1") + expect("WARNING", line, "suppressed 9 messages")
+                 + expect("WARNING", line, "every n 10 2") + expect("WARNING", line, "suppressed 9 messages")
+                 + expect("WARNING", line, "every n 20 3") + expect("INFO", line + 3, "first n 0")
+                 + expect("INFO", line + 3, "first n 1") + expect("INFO", line + 3, "first n 2")
+                 + expect("ERROR", line + 6, "every ms 0") + expect("INFO", line + 7, "bucket 0")
+                 + expect("INFO", line + 7, "bucket 1") + expect("INFO", line + 7, "bucket 2")
+                 + expect("INFO", line + 7, "bucket 3") + expect("INFO", line + 7, "bucket 4")
+                 // report_suppressed walks the most recently registered sites first
+                 + expect("INFO", line + 10, "suppressed 10 messages")
+                 + expect("INFO", line + 7, "suppressed 995 messages")
+                 + expect("ERROR", line + 6, "suppressed 999 messages")
+                 + expect("INFO", line + 3, "suppressed 22 messages")
+                 + expect("WARNING", line, "suppressed 4 messages"));
+
+    // the async writer reports on its own
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    abc::log::async_config config;
+    config.fd                 = fileno(file);
+    config.flushOnCrash       = false;
+    config.suppressedReportMs = 10;
+    REQUIRE(abc::log::start_async(config));
+    const abc::chrono::timer timer;
+    while (timer.get_elapsed_time_as<abc::chrono::milliseconds>().count() < 50) {
+        ABC_LOG_FIRST_N(info, 1, "async first");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    const abc::string content = read_file(file);
+    abc::log::stop_async();
+
+    CHECK(count_lines(content, "[INFO]") >= 2);
+    CHECK(content.find("async first\n") != abc::string::npos);
+    CHECK(content.find("suppressed") != abc::string::npos);
+    std::fclose(file);
+}
+
+#if defined(ABC_PLATFORM_POSIX_API)
+namespace {
+sigjmp_buf       g_crashJump;
+volatile int     g_previousSignal = 0;
+struct sigaction g_originalAction;
+
+void
+previous_crash_handler(int signal, siginfo_t*, void*)
+{
+    g_previousSignal = signal;
+    siglongjmp(g_crashJump, 1);
+}
+}   // namespace
+
+TEST_CASE("abc - log - crash handler chaining")
+{
+    // a handler installed before start_async, like a sanitizer or a crash reporter
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_sigaction = previous_crash_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_SIGINFO;
+    REQUIRE(::sigaction(SIGFPE, &action, &g_originalAction) == 0);
+
+    FILE* file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    abc::log::async_config config;
+    config.fd = fileno(file);
+    REQUIRE(abc::log::start_async(config));
+    ABC_LOG_ERROR("before the crash");
+    if (sigsetjmp(g_crashJump, 1) == 0) {
+        std::raise(SIGFPE);
+    }
+    // the log was flushed before the previous handler ran
+    const abc::string content = read_file(file);
+    abc::log::stop_async();
+    ::sigaction(SIGFPE, &g_originalAction, nullptr);
+
+    CHECK(g_previousSignal == SIGFPE);
+    CHECK(content.find("before the crash\n") != abc::string::npos);
+    std::fclose(file);
+}
+#endif
@@ -0,0 +1,194 @@
+#include "doctest/doctest.h"
+
+#include "abc/debug.hpp"
+#include "abc/log_file.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+std::vector<abc::log::binary::decoded_record>
+read_records(abc::log::binary::reader& reader)
+{
+    std::vector<abc::log::binary::decoded_record> records;
+    abc::log::binary::decoded_record              record;
+    abc::log::binary::read_status                 status;
+    while ((status = reader.next(record)) == abc::log::binary::read_status::record) {
+        records.push_back(record);
+    }
+    CHECK(status == abc::log::binary::read_status::end);
+    return records;
+}
+
+long
+get_file_size(FILE* file)
+{
+    std::fseek(file, 0, SEEK_END);
+    return std::ftell(file);
+}
+}   // namespace
+
+TEST_CASE("abc - log file - varint")
+{
+    const uint64_t values[] = {0, 1, 127, 128, 300, 1ull << 35, UINT64_MAX};
+    for (const uint64_t value : values) {
+        char        buffer[abc::log::binary::k_maxVarintSize];
+        const char* end  = abc::log::binary::write_varint(buffer, value);
+        const char* data = buffer;
+        uint64_t    read = 0;
+        CHECK(abc::log::binary::read_varint(data, end, read));
+        CHECK(data == end);
+        CHECK(read == value);
+
+        data = buffer;
+        CHECK((end - buffer == 1 || !abc::log::binary::read_varint(data, end - 1, read)));
+    }
+
+    const int64_t deltas[] = {0, -1, 1, -64, 64, INT64_MIN, INT64_MAX};
+    for (const int64_t delta : deltas) {
+        CHECK(abc::log::binary::zigzag_decode(abc::log::binary::zigzag_encode(delta)) == delta);
+    }
+    CHECK(abc::log::binary::zigzag_encode(-1) == 1);
+    CHECK(abc::log::binary::zigzag_encode(1) == 2);
+}
+
+TEST_CASE("abc - log file - binary output")
+{
+    FILE* textFile   = std::tmpfile();
+    FILE* binaryFile = std::tmpfile();
+    REQUIRE(textFile != nullptr);
+    REQUIRE(binaryFile != nullptr);
+
+    constexpr int k_lines = 2000;
+    const auto    log_all = [] {
+        for (int i = 0; i < k_lines; ++i) {
+            ABC_LOG_DEFERRED_INFO("request {} took {:.3f}ms status {}", i, i * 0.25, "ok");
+        }
+        ABC_LOG_WARNING("text {}", 42);
+        ABC_LOG_DEFERRED_ERROR("last {}", abc::string("one"));
+    };
+
+    abc::log::async_config config;
+    config.flushOnCrash = false;
+    config.fd           = fileno(textFile);
+    REQUIRE(abc::log::start_async(config));
+    log_all();
+    abc::log::stop_async();
+
+    config.fd     = fileno(binaryFile);
+    config.output = abc::log::output_format::binary;
+    REQUIRE(abc::log::start_async(config));
+    const uint64_t start = abc::log::detail::get_timestamp();
+    log_all();
+    abc::log::stop_async();
+
+    std::fflush(binaryFile);
+    const long textSize   = get_file_size(textFile);
+    const long binarySize = get_file_size(binaryFile);
+    MESSAGE(abc::format("text {} bytes, binary {} bytes", textSize, binarySize));
+    CHECK(binarySize * 3 < textSize);
+
+    abc::log::binary::reader reader(binaryFile);
+    REQUIRE(reader.open());
+    const std::vector<abc::log::binary::decoded_record> records = read_records(reader);
+    REQUIRE(records.size() == k_lines + 2);
+
+    // decoded lines match the text backend output, text and deferred records may interleave differently
+    std::vector<abc::string> decoded;
+    for (const abc::log::binary::decoded_record& record : records) {
+        decoded.push_back(record.text);
+        CHECK(record.timestamp >= start);
+    }
+    std::vector<abc::string> lines;
+    std::rewind(textFile);
+    char buffer[1024];
+    while (std::fgets(buffer, sizeof(buffer), textFile) != nullptr) {
+        lines.emplace_back(buffer, std::strlen(buffer) - 1);
+    }
+    std::sort(decoded.begin(), decoded.end());
+    std::sort(lines.begin(), lines.end());
+    CHECK(decoded == lines);
+
+    // the writer takes text records before deferred ones, the file does not start with a given kind
+    const auto first = std::find_if(records.begin(), records.end(), [](const abc::log::binary::decoded_record& record) {
+        return record.text.find("] request 0 took") != abc::string::npos;
+    });
+    REQUIRE(first != records.end());
+    REQUIRE(first->site != nullptr);
+    CHECK(first->site->lvl == abc::log::level::info);
+    size_t textRecords = 0;
+    for (const abc::log::binary::decoded_record& record : records) {
+        if (record.site == nullptr) {
+            ++textRecords;
+            CHECK(record.text.find("] text 42") != abc::string::npos);
+        }
+    }
+    CHECK(textRecords == 1);
+
+    // seek past the first half, only later records come back
+    const uint64_t middle = records[k_lines / 2].timestamp;
+    reader.seek(middle);
+    const std::vector<abc::log::binary::decoded_record> tail = read_records(reader);
+    REQUIRE(!tail.empty());
+    CHECK(tail.size() <= records.size() - k_lines / 2 + 1);
+    for (const abc::log::binary::decoded_record& record : tail) {
+        CHECK(record.timestamp >= middle);
+    }
+    CHECK(tail.back().text == records.back().text);
+
+    std::fclose(textFile);
+    std::fclose(binaryFile);
+}
+
+TEST_CASE("abc - log file - growing file")
+{
+    FILE* source = std::tmpfile();
+    REQUIRE(source != nullptr);
+
+    abc::log::async_config config;
+    config.flushOnCrash = false;
+    config.fd           = fileno(source);
+    config.output       = abc::log::output_format::binary;
+    REQUIRE(abc::log::start_async(config));
+    ABC_LOG_DEFERRED_INFO("first {}", 1);
+    abc::log::flush();
+    ABC_LOG_DEFERRED_INFO("second {}", 2.5);
+    abc::log::stop_async();
+
+    const long  size = get_file_size(source);
+    abc::string content(static_cast<size_t>(size), '\0');
+    std::rewind(source);
+    REQUIRE(std::fread(&content[0], 1, content.size(), source) == content.size());
+    std::fclose(source);
+
+    // the reader follows a copy written a few bytes at a time
+    FILE* copy = std::tmpfile();
+    REQUIRE(copy != nullptr);
+    abc::log::binary::reader reader(copy);
+    CHECK(!reader.open());
+
+    std::vector<abc::string>         lines;
+    abc::log::binary::decoded_record record;
+    bool                             opened = false;
+    for (size_t offset = 0; offset < content.size(); offset += 5) {
+        std::fseek(copy, 0, SEEK_END);
+        std::fwrite(content.data() + offset, 1, std::min<size_t>(5, content.size() - offset), copy);
+        std::fflush(copy);
+
+        opened = opened || reader.open();
+        if (!opened) {
+            continue;
+        }
+        abc::log::binary::read_status status;
+        while ((status = reader.next(record)) == abc::log::binary::read_status::record) {
+            lines.push_back(record.text);
+        }
+        REQUIRE(status == abc::log::binary::read_status::end);
+    }
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0].find("] first 1") != abc::string::npos);
+    CHECK(lines[1].find("] second 2.5") != abc::string::npos);
+    std::fclose(copy);
+}
@@ -1,6 +1,19 @@
 #include "doctest/doctest.h"
 
 #include "abc/profiler.hpp"
+#include "abc/profiler_shm.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// counts the allocations of the whole test program, the zones of the other tests do not allocate
+ABC_PROFILE_ALLOCATION_HOOKS()
 
 TEST_CASE("abc - error")
 {
@@ -10,3 +23,507 @@ TEST_CASE("abc - error")
     abc::chrono::timer timer;
     ABC_PROFILE_END("TEST");
 }
+
+namespace {
+abc::string
+capture_summary(const std::vector<abc::string>& filter = std::vector<abc::string>())
+{
+    std::ostringstream stream;
+    std::streambuf*    coutBuffer = std::cout.rdbuf(stream.rdbuf());
+    abc::detail::profiler::GetInstance().print_summary(filter);
+    std::cout.rdbuf(coutBuffer);
+    return stream.str();
+}
+}   // namespace
+
+TEST_CASE("abc - profiler - tag registry")
+{
+    abc::detail::profiler& profiler = abc::detail::profiler::GetInstance();
+
+    const abc::detail::profiler::tag_id first  = profiler.register_tag("registry_first");
+    const abc::detail::profiler::tag_id second = profiler.register_tag("registry_second");
+    CHECK(first != second);
+    CHECK(profiler.register_tag("registry_first") == first);
+    CHECK(second == first + 1);
+
+    // BEGIN and END are different call sites resolving to the same id
+    for (int i = 0; i < 3; ++i) {
+        ABC_PROFILE_BEGIN(registry_zone);
+        ABC_PROFILE_END(registry_zone);
+    }
+    ABC_PROFILE_SECTION(registry_section, { ABC_PROFILE_BEGIN_MT(registry_mt); ABC_PROFILE_END_MT(registry_mt); });
+
+    // the string interface shares the ids
+    profiler.tick("registry_zone");
+    profiler.tock(profiler.register_tag("registry_zone"));
+    // names are resolved once per thread, later calls hit its cache
+    CHECK(profiler.resolve_tag("registry_zone") == profiler.register_tag("registry_zone"));
+    CHECK(profiler.resolve_tag("registry_by_name") == profiler.resolve_tag("registry_by_name"));
+    CHECK(profiler.register_tag("registry_by_name") == profiler.resolve_tag("registry_by_name"));
+
+    const abc::string summary = capture_summary({"registry_zone", "registry_section", "registry_mt", "unknown"});
+    CHECK(summary.find("registry_zone : avg(") != abc::string::npos);
+    CHECK(summary.find("#[4]") != abc::string::npos);
+    CHECK(summary.find("registry_section : ") != abc::string::npos);
+    CHECK(summary.find("registry_mt : ") != abc::string::npos);
+    CHECK(summary.find("unknown") == abc::string::npos);
+
+    profiler.declare("registry_zone", true);
+    CHECK(capture_summary({"registry_zone"}).find("registry_zone") == abc::string::npos);
+    CHECK(profiler.register_tag("registry_zone") == profiler.register_tag("registry_zone"));
+}
+
+TEST_CASE("abc - profiler - reset from another thread")
+{
+    abc::detail::profiler& profiler = abc::detail::profiler::GetInstance();
+
+    // the recording thread is still running when the tag is reset
+    std::atomic<int> step{0};
+    std::thread      thread([&step]() {
+        for (int i = 0; i < 5; ++i) {
+            ABC_PROFILE_SCOPE(reset_other_thread);
+        }
+        step.store(1);
+        while (step.load() != 2) {
+            std::this_thread::yield();
+        }
+        ABC_PROFILE_SCOPE(reset_other_thread);
+    });
+    while (step.load() != 1) {
+        std::this_thread::yield();
+    }
+    CHECK(capture_summary({"reset_other_thread"}).find("#[5]") != abc::string::npos);
+
+    profiler.declare("reset_other_thread", true);
+    CHECK(capture_summary({"reset_other_thread"}).find("reset_other_thread") == abc::string::npos);
+
+    // the next record starts from scratch, and so does what the thread leaves at exit
+    step.store(2);
+    thread.join();
+    const abc::string summary = capture_summary({"reset_other_thread"});
+    CHECK(summary.find("reset_other_thread : ") != abc::string::npos);
+    CHECK(summary.find("#[") == abc::string::npos);   // a single call has no average
+}
+
+TEST_CASE("abc - profiler - per thread samples")
+{
+    constexpr int k_threads    = 4;
+    constexpr int k_iterations = 1000;
+
+    std::mutex               mutex;
+    std::atomic<int>         ready{0};
+    std::atomic<bool>        release{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < k_threads; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < k_iterations; ++i) {
+                ABC_PROFILE_BEGIN_MT(thread_zone);
+                {
+                    ABC_PROFILE_LOCK_GUARD(thread_lock, mutex);
+                }
+                ABC_PROFILE_END_MT(thread_zone);
+            }
+            ++ready;
+            while (!release.load()) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (ready.load() != k_threads) {
+        std::this_thread::yield();
+    }
+
+    // running threads are read without stopping them
+    const abc::string live = capture_summary({"thread_zone", "thread_lock"});
+    CHECK(live.find("thread_zone : avg(") != abc::string::npos);
+    CHECK(live.find(ABC_FORMAT("#[{}]", k_threads * k_iterations)) != abc::string::npos);
+    CHECK(live.find("thread_lock : lckd(") != abc::string::npos);
+
+    release = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // exited threads are merged into the profiler
+    const abc::string merged = capture_summary({"thread_zone", "thread_lock"});
+    CHECK(merged == live);
+}
+
+namespace {
+void
+tree_leaf()
+{
+    ABC_PROFILE_SCOPE(tree_leaf);
+}
+
+void
+tree_request()
+{
+    ABC_PROFILE_SCOPE(tree_request);
+    for (int i = 0; i < 2; ++i) {
+        ABC_PROFILE_SCOPE(tree_parse);
+        tree_leaf();
+    }
+    tree_leaf();
+}
+}   // namespace
+
+TEST_CASE("abc - profiler - call tree")
+{
+    for (int i = 0; i < 3; ++i) {
+        tree_request();
+    }
+    std::thread([]() { tree_request(); }).join();
+
+    const abc::string summary = capture_summary();
+    CHECK(summary.find("-- Call tree") != abc::string::npos);
+    // paths are merged across threads, leaves are counted per parent
+    CHECK(summary.find("\ntree_request : incl(") != abc::string::npos);
+    CHECK(summary.find("#[4]\n  tree_parse : incl(") != abc::string::npos);
+    CHECK(summary.find("#[8]\n    tree_leaf : incl(") != abc::string::npos);
+    CHECK(summary.find("\n  tree_leaf : incl(") != abc::string::npos);
+    // the flat summary still counts every scope
+    CHECK(summary.find("\ntree_leaf : avg(") != abc::string::npos);
+    CHECK(summary.find("#[12]") != abc::string::npos);
+}
+
+TEST_CASE("abc - profiler - trace export")
+{
+    ABC_PROFILE_TRACE_START(4);   // rounded up to the minimum ring size of 16 events
+    for (int i = 0; i < 20; ++i) {
+        ABC_PROFILE_SCOPE("trace_scope");
+    }
+    std::thread([]() { ABC_PROFILE_SECTION(trace_thread, {}); }).join();
+    ABC_PROFILE_TRACE_STOP();
+    ABC_PROFILE_SECTION(trace_stopped, {});
+
+    const abc::string path = "abc_profiler_trace.json";
+    REQUIRE(ABC_PROFILE_TRACE_WRITE(path));
+    std::ifstream     file(path.c_str());
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+
+    const auto count = [&json](const char* text) {
+        size_t result = 0;
+        for (size_t pos = json.find(text); pos != std::string::npos; pos = json.find(text, pos + 1)) {
+            ++result;
+        }
+        return result;
+    };
+    CHECK(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+    CHECK(json.substr(json.size() - 4) == "\n]}\n");
+    // the oldest events were overwritten, tag names are escaped
+    CHECK(count("\"name\":\"\\\"trace_scope\\\"\",\"ph\":\"X\"") == 16);
+    CHECK(count("\"name\":\"trace_thread\",\"ph\":\"X\"") == 1);
+    CHECK(count("trace_stopped") == 0);
+    CHECK(count("\"ph\":\"M\"") >= 2);
+    CHECK(count("\"dur\":") == count("\"ph\":\"X\""));
+}
+
+TEST_CASE("abc - profiler - trace export keeps the last exited threads")
+{
+    ABC_PROFILE_TRACE_START(16, 1);
+    std::thread([]() { ABC_PROFILE_SECTION(trace_exited_first, {}); }).join();
+    std::thread([]() { ABC_PROFILE_SECTION(trace_exited_second, {}); }).join();
+    ABC_PROFILE_TRACE_STOP();
+
+    const abc::string path = "abc_profiler_trace_exited.json";
+    REQUIRE(ABC_PROFILE_TRACE_WRITE(path));
+    std::ifstream     file(path.c_str());
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+
+    CHECK(json.find("trace_exited_first") == std::string::npos);
+    CHECK(json.find("trace_exited_second") != std::string::npos);
+}
+
+TEST_CASE("abc - profiler - histograms")
+{
+    ABC_PROFILE_HISTOGRAM(histogram_zone);
+    for (int i = 0; i < 100; ++i) {
+        ABC_PROFILE_SCOPE(histogram_zone);
+    }
+    std::thread([]() { ABC_PROFILE_SECTION(histogram_zone, {}); }).join();
+    for (int i = 0; i < 10; ++i) {
+        ABC_PROFILE_SCOPE(histogram_none);
+    }
+
+    abc::log_linear_histogram histogram;
+    REQUIRE(abc::detail::profiler::GetInstance().get_histogram("histogram_zone", histogram));
+    CHECK(histogram.get_count() == 101);
+    CHECK(histogram.get_percentile(50.0) <= histogram.get_percentile(99.9));
+    CHECK(histogram.get_percentile(99.9) <= histogram.get_max());
+    CHECK(!abc::detail::profiler::GetInstance().get_histogram("histogram_none", histogram));
+
+    const abc::string summary = capture_summary({"histogram_zone", "histogram_none"});
+    CHECK(summary.find("histogram_zone : p50(") != abc::string::npos);
+    CHECK(summary.find(") p99.9(") != abc::string::npos);
+    CHECK(summary.find("histogram_none : p50(") == abc::string::npos);
+}
+
+TEST_CASE("abc - profiler - hardware counters")
+{
+    abc::detail::profiler& profiler = abc::detail::profiler::GetInstance();
+
+    // perf events are often not permitted (containers, virtual machines), profiling carries on without them
+    const bool available = ABC_PROFILE_COUNTERS();
+    MESSAGE("hardware counters available: " << available);
+    for (int i = 0; i < 10; ++i) {
+        ABC_PROFILE_SCOPE(counters_zone);
+        volatile int sum = 0;
+        for (int j = 0; j < 1000; ++j) {
+            sum = sum + j;
+        }
+    }
+    ABC_PROFILE_SECTION(counters_section, {});
+
+    const abc::string summary = capture_summary({"counters_zone", "counters_section"});
+    CHECK(summary.find("counters_zone : avg(") != abc::string::npos);
+    CHECK((summary.find("counters_zone : ipc(") != abc::string::npos) == available);
+    CHECK((summary.find("counters_section : ipc(") != abc::string::npos) == available);
+    if (available) {
+        CHECK(summary.find(" instructions(0)") == abc::string::npos);
+    }
+    profiler.disable_counters();
+}
+
+namespace {
+void
+sampled_spin(std::chrono::milliseconds duration)
+{
+    ABC_PROFILE_SCOPE(sampled_outer);
+    ABC_PROFILE_SCOPE(sampled_inner);
+    const auto   end = std::chrono::steady_clock::now() + duration;
+    volatile int sum = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        sum = sum + 1;
+    }
+}
+
+std::string
+read_folded_stacks()
+{
+    const abc::string path = "abc_profiler_folded.txt";
+    REQUIRE(ABC_PROFILE_SAMPLING_WRITE(path));
+    std::ifstream     file(path.c_str());
+    const std::string folded((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+    return folded;
+}
+}   // namespace
+
+TEST_CASE("abc - profiler - sampling")
+{
+    // CPU time timers and SIGPROF, only on Linux
+    if (!ABC_PROFILE_SAMPLING_START(1000)) {
+        MESSAGE("sampling not supported");
+        return;
+    }
+    std::thread([]() { sampled_spin(std::chrono::milliseconds(200)); }).join();
+    ABC_PROFILE_SAMPLING_STOP();
+
+    const std::string folded = read_folded_stacks();
+    const size_t      line   = folded.find("sampled_outer;sampled_inner ");
+    REQUIRE(line != std::string::npos);
+    CHECK((line == 0 || folded[line - 1] == '\n'));
+    CHECK(std::stoul(folded.substr(line + std::strlen("sampled_outer;sampled_inner "))) > 0);
+
+    // backtraces follow the zones, the innermost frame last
+    REQUIRE(ABC_PROFILE_SAMPLING_START(1000, true));
+    std::thread([]() { sampled_spin(std::chrono::milliseconds(100)); }).join();
+    ABC_PROFILE_SAMPLING_STOP();
+    CHECK(read_folded_stacks().find("sampled_outer;sampled_inner;") != std::string::npos);
+}
+
+namespace {
+uint64_t
+count_sampled_backtraces()
+{
+    uint64_t           count = 0;
+    std::istringstream lines(read_folded_stacks());
+    for (std::string line; std::getline(lines, line);) {
+        if (line.compare(0, std::strlen("sampled_outer;sampled_inner;"), "sampled_outer;sampled_inner;") == 0) {
+            count += std::stoul(line.substr(line.rfind(' ') + 1));
+        }
+    }
+    return count;
+}
+}   // namespace
+
+TEST_CASE("abc - profiler - sampling folds a running thread")
+{
+    // the backtraces ring of a running thread is folded incrementally, once each
+    abc::detail::profiler& profiler = abc::detail::profiler::GetInstance();
+    if (!ABC_PROFILE_SAMPLING_START(1000, true)) {
+        MESSAGE("sampling not supported");
+        return;
+    }
+    const uint64_t before  = count_sampled_backtraces();
+    const uint64_t dropped = profiler.get_dropped_backtraces();
+    uint64_t       running = 0;
+    std::thread([&]() {
+        for (int i = 0; i < 3; ++i) {
+            sampled_spin(std::chrono::milliseconds(100));
+            profiler.get_dropped_backtraces();
+        }
+        running = count_sampled_backtraces();
+        ABC_PROFILE_SAMPLING_STOP();
+    }).join();
+    CHECK(profiler.get_dropped_backtraces() == dropped);
+
+    const uint64_t after = count_sampled_backtraces();
+    CHECK(running > before);
+    CHECK(after >= running);
+    CHECK(count_sampled_backtraces() == after);
+}
+
+TEST_CASE("abc - profiler - allocations")
+{
+    ABC_PROFILE_TRACE_START();
+    std::thread([]() {
+        ABC_PROFILE_SCOPE(allocating_zone);
+        for (int i = 0; i < 10; ++i) {
+            delete new int(i);
+        }
+        {
+            ABC_PROFILE_SCOPE(allocating_child);
+            std::vector<char> buffer(100);
+        }
+    }).join();
+    ABC_PROFILE_TRACE_STOP();
+
+    // the summary counts the nested zones, the call tree what each zone did itself
+    const abc::string summary = capture_summary();
+    CHECK(summary.find("allocating_zone : allocs(11.00) frees(11.00) bytes(" + std::to_string(10 * sizeof(int) + 100)
+              + ") per call")
+          != abc::string::npos);
+    CHECK(summary.find("allocating_child : allocs(1.00) frees(1.00) bytes(100) per call") != abc::string::npos);
+    CHECK(summary.find(" allocs(10) bytes(" + std::to_string(10 * sizeof(int)) + ")#[1]\n  allocating_child : incl(")
+          != abc::string::npos);
+
+    const abc::string path = "abc_profiler_allocations.json";
+    REQUIRE(ABC_PROFILE_TRACE_WRITE(path));
+    std::ifstream     file(path.c_str());
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::remove(path.c_str());
+    CHECK(json.find("\"args\":{\"allocations\":1,\"bytes\":100}") != std::string::npos);
+    CHECK(json.find("\"args\":{\"allocations\":11,\"bytes\":") != std::string::npos);
+}
+
+TEST_CASE("abc - profiler - shared memory publishing")
+{
+    const abc::string name = "/abc_profiler_test";
+    if (!ABC_PROFILE_PUBLISH_START(name, std::chrono::milliseconds(5))) {
+        MESSAGE("shared memory publishing not supported");
+        return;
+    }
+    ABC_PROFILE_HISTOGRAM(published_zone);
+    for (int i = 0; i < 3; ++i) {
+        ABC_PROFILE_SECTION(published_zone, {});
+    }
+
+    abc::detail::profiler_shm_reader reader;
+    REQUIRE(reader.open(name));
+    abc::detail::profiler_snapshot snapshot;
+    const abc::detail::profiler_snapshot::tag* published = nullptr;
+    for (int attempt = 0; attempt < 200 && published == nullptr; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        REQUIRE(reader.read(snapshot));
+        for (const abc::detail::profiler_snapshot::tag& tag : snapshot.tags) {
+            if (tag.name == "published_zone" && tag.calls == 3) {
+                published = &tag;
+            }
+        }
+    }
+    REQUIRE(published != nullptr);
+    CHECK(snapshot.intervalMs == 5);
+    CHECK(snapshot.publishes > 0);
+    CHECK(published->minNs <= published->maxNs);
+    CHECK(published->totalNs >= published->maxNs);
+    CHECK(published->p50Ns != 0);
+    CHECK(published->p50Ns <= published->p90Ns);
+    CHECK(published->p90Ns <= published->p99Ns);
+    CHECK(published->p99Ns <= published->p999Ns);
+
+    ABC_PROFILE_PUBLISH_STOP();
+    abc::detail::profiler_shm_reader stopped;
+    CHECK(!stopped.open(name));
+}
+
+TEST_CASE("abc - profiler - rolling windows")
+{
+    abc::detail::profiler&             profiler = abc::detail::profiler::GetInstance();
+    abc::rolling_window::stats stats;
+    CHECK(!profiler.get_window("window_zone", std::chrono::seconds(10), stats));
+
+    ABC_PROFILE_WINDOW(window_zone);
+    for (int i = 0; i < 5; ++i) {
+        ABC_PROFILE_SCOPE(window_zone);
+    }
+    std::thread([]() { ABC_PROFILE_SECTION(window_zone, {}); }).join();
+
+    // the records of the running second are reported once it is complete
+    REQUIRE(profiler.get_window("window_zone", std::chrono::seconds(60), stats));
+    CHECK(stats.count <= 6);
+    CHECK(stats.values.get_count() == stats.count);
+
+    const abc::string summary = capture_summary({"window_zone"});
+    CHECK(summary.find("window_zone : 1s(") != abc::string::npos);
+    CHECK(summary.find(" 10s(") != abc::string::npos);
+    CHECK(summary.find(" 60s(") != abc::string::npos);
+}
+
+namespace {
+void
+overhead_parent(int children)
+{
+    ABC_PROFILE_SCOPE(overhead_parent);
+    for (int i = 0; i < children; ++i) {
+        ABC_PROFILE_SCOPE(overhead_child);
+    }
+}
+}   // namespace
+
+TEST_CASE("abc - profiler - overhead compensation")
+{
+    constexpr int          k_children = 50;
+    abc::detail::profiler& profiler   = abc::detail::profiler::GetInstance();
+    ABC_PROFILE_INIT();
+    const abc::detail::profiler::overhead overhead = profiler.get_overhead();
+    CHECK(overhead.zoneNested > abc::detail::profiler::duration(0));
+    CHECK(overhead.scopeNested >= overhead.scope);
+    CHECK(overhead.zoneNested >= overhead.zone);
+    CHECK(capture_summary({"overhead_parent"}).find("-- Overhead per zone: tick/tock ") != abc::string::npos);
+
+    // an empty parent of empty children measures only their overhead, compensated it is left with its loop
+    ABC_PROFILE_HISTOGRAM(overhead_parent);
+    ABC_PROFILE_HISTOGRAM(overhead_child);
+    for (int i = 0; i < 21; ++i) {
+        overhead_parent(k_children);
+    }
+    abc::log_linear_histogram measured;
+    REQUIRE(profiler.get_histogram("overhead_parent", measured));
+
+    profiler.set_overhead_compensation(true);
+    profiler.declare("overhead_parent", true);
+    profiler.declare("overhead_child", true);
+    for (int i = 0; i < 21; ++i) {
+        overhead_parent(k_children);
+    }
+    profiler.set_overhead_compensation(false);
+    abc::log_linear_histogram parent;
+    abc::log_linear_histogram child;
+    REQUIRE(profiler.get_histogram("overhead_parent", parent));
+    REQUIRE(profiler.get_histogram("overhead_child", child));
+
+    const uint64_t nestedNs = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(overhead.scopeNested).count());
+    CHECK(measured.get_percentile(50.0) >= k_children * nestedNs / 2);
+    CHECK(parent.get_percentile(50.0) < k_children * nestedNs / 2);
+    CHECK(child.get_percentile(50.0) < nestedNs);
+    CHECK(capture_summary().find(", compensated") == abc::string::npos);
+}
@@ -0,0 +1,66 @@
+#include "doctest/doctest.h"
+
+#include "abc/rolling_window.hpp"
+
+TEST_CASE("abc - rolling window - seconds")
+{
+    abc::rolling_window window;
+    for (uint64_t second = 100; second < 110; ++second) {
+        for (uint64_t value = 1; value <= second - 99; ++value) {
+            window.record(second, value * 1000);
+        }
+    }
+
+    // only complete seconds are reported, the current one is still being recorded
+    abc::rolling_window::stats last;
+    window.collect(110, 1, last);
+    CHECK(last.count == 10);
+    CHECK(last.max == 10000);
+    CHECK(last.total == 55000);
+
+    abc::rolling_window::stats running;
+    window.collect(109, 1, running);
+    CHECK(running.count == 9);
+
+    abc::rolling_window::stats all;
+    window.collect(110, 60, all);
+    CHECK(all.count == 55);
+    CHECK(all.values.get_count() == 55);
+    CHECK(all.values.get_max() == 10000);
+    CHECK(all.values.get_percentile(50.0) >= 4000);   // 1000 is recorded 10 times, 10000 once
+    CHECK(all.values.get_percentile(50.0) <= 4500);
+
+    // seconds older than the window are gone even though their slots were never recycled
+    abc::rolling_window::stats later;
+    window.collect(200, 60, later);
+    CHECK(later.count == 0);
+}
+
+TEST_CASE("abc - rolling window - recycling and merge")
+{
+    abc::rolling_window window;
+    window.record(5, 1);
+    window.record(5 + abc::rolling_window::k_slotCount, 2);   // same slot, a minute later
+
+    abc::rolling_window::stats stats;
+    window.collect(6 + abc::rolling_window::k_slotCount, abc::rolling_window::k_slotCount, stats);
+    CHECK(stats.count == 1);
+    CHECK(stats.total == 2);
+
+    abc::rolling_window other;
+    other.record(5, 100);                                       // older than the slot, dropped
+    other.record(5 + abc::rolling_window::k_slotCount, 10);
+    other.record(7 + abc::rolling_window::k_slotCount, 20);
+    window.merge(other);
+
+    abc::rolling_window::stats merged;
+    window.collect(8 + abc::rolling_window::k_slotCount, abc::rolling_window::k_slotCount, merged);
+    CHECK(merged.count == 3);
+    CHECK(merged.total == 32);
+    CHECK(merged.max == 20);
+
+    const abc::rolling_window copy(window);
+    abc::rolling_window::stats copied;
+    copy.collect(8 + abc::rolling_window::k_slotCount, abc::rolling_window::k_slotCount, copied);
+    CHECK(copied.count == 3);
+}
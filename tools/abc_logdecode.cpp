@@ -0,0 +1,109 @@
+// Expands binary logs written with abc::log::output_format::binary back to text.
+//
+//   abc_logdecode [--follow] [--since <ns>] [--until <ns>] [--timestamps] <file>
+//
+//   --follow      keep reading as the file grows, like tail -f
+//   --since/until only records in [since, until], nanoseconds since the clock epoch; --since skips whole blocks
+//   --timestamps  prefixes every line with its timestamp
+
+#include "abc/charconv.hpp"
+#include "abc/log_file.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+int
+print_usage()
+{
+    std::fputs("usage: abc_logdecode [--follow] [--since <ns>] [--until <ns>] [--timestamps] <file>\n", stderr);
+    return 2;
+}
+
+bool
+parse_timestamp(const char* text, uint64_t& value)
+{
+    const char*                  last   = text + std::strlen(text);
+    const abc::from_chars_result result = abc::from_chars(text, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+}
+}   // namespace
+
+int
+main(int argc, char** argv)
+{
+    bool        follow     = false;
+    bool        timestamps = false;
+    uint64_t    since      = 0;
+    uint64_t    until      = UINT64_MAX;
+    const char* path       = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--follow") == 0) {
+            follow = true;
+        } else if (std::strcmp(argv[i], "--timestamps") == 0) {
+            timestamps = true;
+        } else if (std::strcmp(argv[i], "--since") == 0 && i + 1 < argc) {
+            if (!parse_timestamp(argv[++i], since)) {
+                return print_usage();
+            }
+        } else if (std::strcmp(argv[i], "--until") == 0 && i + 1 < argc) {
+            if (!parse_timestamp(argv[++i], until)) {
+                return print_usage();
+            }
+        } else if (path == nullptr && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            return print_usage();
+        }
+    }
+    if (path == nullptr) {
+        return print_usage();
+    }
+
+    std::FILE* file = std::fopen(path, "rb");
+    if (file == nullptr) {
+        std::fprintf(stderr, "abc_logdecode: cannot open '%s'\n", path);
+        return 1;
+    }
+
+    abc::log::binary::reader reader(file);
+    while (!reader.open()) {
+        if (!follow) {
+            std::fprintf(stderr, "abc_logdecode: '%s' is not a binary log\n", path);
+            std::fclose(file);
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (since != 0) {
+        reader.seek(since);
+    }
+
+    int                              result = 0;
+    abc::log::binary::decoded_record record;
+    for (;;) {
+        const abc::log::binary::read_status status = reader.next(record);
+        if (status == abc::log::binary::read_status::record) {
+            if (record.timestamp > until) {
+                continue;
+            }
+            if (timestamps) {
+                std::fprintf(stdout, "%llu ", static_cast<unsigned long long>(record.timestamp));
+            }
+            std::fwrite(record.text.data(), 1, record.text.size(), stdout);
+            std::fputc('\n', stdout);
+        } else if (status == abc::log::binary::read_status::corrupted) {
+            std::fputs("abc_logdecode: corrupted record skipped\n", stderr);
+            result = 1;
+        } else if (follow) {
+            std::fflush(stdout);
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        } else {
+            break;
+        }
+    }
+    std::fclose(file);
+    return result;
+}
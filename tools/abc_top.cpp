@@ -0,0 +1,174 @@
+// Shows the live statistics a process publishes with ABC_PROFILE_PUBLISH_START, without stopping it.
+//
+//   abc_top [--once] [--interval <ms>] [--count <tags>] <pid|segment>
+//
+//   --once      prints the totals since the process started and exits
+//   --interval  refresh period, 1000 ms by default; rates are computed between two refreshes
+//   --count     number of tags shown, the busiest first (20 by default)
+//
+// A pid selects the segment "/abc_profiler_<pid>", anything else is used as the segment name.
+
+#include "abc/charconv.hpp"
+#include "abc/format.hpp"
+#include "abc/profiler_shm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+int
+print_usage()
+{
+    std::fputs("usage: abc_top [--once] [--interval <ms>] [--count <tags>] <pid|segment>\n", stderr);
+    return 2;
+}
+
+bool
+parse_number(const char* text, uint64_t& value)
+{
+    const char*                  last   = text + std::strlen(text);
+    const abc::from_chars_result result = abc::from_chars(text, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+///@brief: counters only grow, unless the tag was reset in between, then they restarted from 0
+uint64_t
+get_delta(uint64_t current, uint64_t previous)
+{
+    return current >= previous ? current - previous : current;
+}
+
+struct row {
+    const abc::detail::profiler_snapshot::tag* tag;
+    double                                     calls;         // per second, or total with --once
+    double                                     busyNs;        // time spent in the tag over the interval
+    double                                     averageNs;
+    double                                     allocations;   // per call
+};
+
+void
+print(const abc::detail::profiler_snapshot& snapshot, const abc::detail::profiler_snapshot* previous,
+    size_t count)
+{
+    std::unordered_map<abc::string, const abc::detail::profiler_snapshot::tag*> before;
+    if (previous != nullptr) {
+        for (const abc::detail::profiler_snapshot::tag& tag : previous->tags) {
+            before[tag.name] = &tag;
+        }
+    }
+    const double seconds =
+        previous != nullptr ? static_cast<double>(snapshot.timestampNs - previous->timestampNs) / 1e9 : 0.0;
+
+    std::vector<row> rows;
+    for (const abc::detail::profiler_snapshot::tag& tag : snapshot.tags) {
+        const auto     it          = before.find(tag.name);
+        const uint64_t calls       = it != before.end() ? get_delta(tag.calls, it->second->calls) : tag.calls;
+        const uint64_t totalNs     = it != before.end() ? get_delta(tag.totalNs, it->second->totalNs) : tag.totalNs;
+        const uint64_t allocations =
+            it != before.end() ? get_delta(tag.allocations, it->second->allocations) : tag.allocations;
+        if (tag.calls == 0) {
+            continue;
+        }
+        row entry;
+        entry.tag         = &tag;
+        entry.calls       = seconds > 0.0 ? static_cast<double>(calls) / seconds : static_cast<double>(calls);
+        entry.busyNs      = static_cast<double>(totalNs);
+        entry.averageNs   = calls != 0 ? static_cast<double>(totalNs) / static_cast<double>(calls) : 0.0;
+        entry.allocations = calls != 0 ? static_cast<double>(allocations) / static_cast<double>(calls) : 0.0;
+        rows.push_back(entry);
+    }
+    std::sort(rows.begin(), rows.end(), [](const row& lhs, const row& rhs) { return lhs.busyNs > rhs.busyNs; });
+
+    std::printf("pid %lld - %zu tags - publish #%llu every %llu ms\n\n", static_cast<long long>(snapshot.pid),
+        snapshot.tags.size(), static_cast<unsigned long long>(snapshot.publishes),
+        static_cast<unsigned long long>(snapshot.intervalMs));
+    std::printf("%-32s %12s %11s %11s %11s %11s %11s %11s %9s\n", "tag", seconds > 0.0 ? "calls/s" : "calls", "avg",
+        "p50", "p90", "p99", "p99.9", "max", "allocs");
+    const auto percentile = [](uint64_t nanoseconds) {
+        return nanoseconds != 0 ? abc::format_nanoseconds(static_cast<double>(nanoseconds)) : abc::string("-");
+    };
+    for (size_t i = 0; i < rows.size() && i < count; ++i) {
+        const row& entry = rows[i];
+        // percentiles and max are since the start, percentiles need ABC_PROFILE_HISTOGRAM
+        std::printf("%-32.32s %12.1f %11s %11s %11s %11s %11s %11s %9.2f\n", entry.tag->name.c_str(), entry.calls,
+            entry.averageNs != 0.0 ? abc::format_nanoseconds(entry.averageNs).c_str() : "-",
+            percentile(entry.tag->p50Ns).c_str(), percentile(entry.tag->p90Ns).c_str(),
+            percentile(entry.tag->p99Ns).c_str(), percentile(entry.tag->p999Ns).c_str(),
+            abc::format_nanoseconds(static_cast<double>(entry.tag->maxNs)).c_str(), entry.allocations);
+    }
+    std::fflush(stdout);
+}
+}   // namespace
+
+int
+main(int argc, char** argv)
+{
+    bool        once       = false;
+    uint64_t    intervalMs = 1000;
+    uint64_t    count      = 20;
+    const char* target     = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            if (!parse_number(argv[++i], intervalMs) || intervalMs == 0) {
+                return print_usage();
+            }
+        } else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            if (!parse_number(argv[++i], count)) {
+                return print_usage();
+            }
+        } else if (target == nullptr && argv[i][0] != '-') {
+            target = argv[i];
+        } else {
+            return print_usage();
+        }
+    }
+    if (target == nullptr) {
+        return print_usage();
+    }
+
+    uint64_t          pid  = 0;
+    const abc::string name = parse_number(target, pid)
+        ? abc::detail::profiler_shm::get_default_name(static_cast<int64_t>(pid))
+        : abc::string(target);
+    abc::detail::profiler_shm_reader reader;
+    if (!reader.open(name)) {
+        std::fprintf(stderr, "abc_top: no profiler statistics published as '%s'\n", name.c_str());
+        return 1;
+    }
+
+    abc::detail::profiler_snapshot previous;
+    abc::detail::profiler_snapshot snapshot;
+    bool                           hasPrevious = false;
+    for (;;) {
+        if (!reader.read(snapshot)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (once) {
+            print(snapshot, nullptr, static_cast<size_t>(count));
+            return 0;
+        }
+        if (hasPrevious && snapshot.publishes == previous.publishes) {
+            // the process stopped publishing or exited when its segment is gone
+            abc::detail::profiler_shm_reader probe;
+            if (!probe.open(name)) {
+                std::fputs("abc_top: the process stopped publishing\n", stderr);
+                return 0;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            continue;
+        }
+        std::fputs("\x1b[H\x1b[2J", stdout);   // home and clear, like top
+        print(snapshot, hasPrevious ? &previous : nullptr, static_cast<size_t>(count));
+        std::swap(previous, snapshot);
+        hasPrevious = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+    }
+}